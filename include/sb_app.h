@@ -5,21 +5,55 @@
 #include "sb_transfer_buffer.h"
 #include "sb_texture.h"
 #include "sb_mesh.h"
+#include "sb_pack.h"
+#include "sb_asset_cache.h"
+#include "sb_texture_file.h"
 
 #define SB_MAX_DRAW_COUNT 65535 //2^16 = 1, min limit by vulkan sppec
-
+#define SB_MAX_GPU_TIMERS 16U
+#define SB_MAX_SAMPLERS 32U
+#define SB_MAX_CULL_VIEWS 4U
+#define SB_CULL_GROUP_SIZE 64U // local_size_x of the cull shaders
+#define SB_MAX_SHADER_BINS 4U // every sb_draw_info.shader_id under this gets its own range of a list's commands
+#define SB_SHADER_BIN_COMMAND_COUNT (SB_MAX_DRAW_COUNT / SB_MAX_SHADER_BINS)
+#define SB_SHADER_ID_CONSTANT_ID 16U // where a graphics pipeline's shader id lands, past any stage's addresses
+#define SB_MAX_MATERIALS 1024U // distinct materials per frame
+#define SB_MATERIAL_SLOT_COUNT (SB_MAX_MATERIALS * 2)
+#define SB_MAX_GENERAL_TRANSFORMS 4096U // draws per frame whose transform doesn't fit the compact encoding
+
+typedef uint32_t sb_gpu_timer_id;
+
+// what the vertex stages and the cull passes read per draw. the transform is a position, a rotation and a uniform
+// scale, expanded by the cull pass. anything else is a full matrix in transform_buffer with
+// SB_DRAW_FLAG_GENERAL_TRANSFORM set, sb_draw_transformed picks whichever fits
 typedef struct
 {
-	sb_mat4 transform;
+    sb_vec3 position;
+    float scale;
+    uint32_t rotation[2]; // a unit quaternion as snorm16, x | y << 16 then z | w << 16
 
 	uint32_t mesh_id;
+	uint32_t material_id; // set by sb_draw, an index into material_buffer
+    uint32_t shader_id; // the bin it's drawn from, under SB_MAX_SHADER_BINS
+    uint32_t flags; // sb_draw_flags
+    uint32_t transform_id; // set by sb_draw_transformed for a general transform, an index into transform_buffer
+    uint32_t pad;
+} sb_draw_info;
+
+// what the gpass pixel shader reads per draw, every draw of a frame with the same values shares one entry
+typedef struct
+{
 	uint32_t texture_id;
     float specularity;
-    uint32_t shader_id;
-
     uint32_t color;
-    uint32_t pad[3];
-} sb_draw_info;
+    uint32_t pad;
+} sb_material;
+
+typedef enum
+{
+    SB_DRAW_FLAG_CASTS_SHADOW = (1<<0),
+    SB_DRAW_FLAG_GENERAL_TRANSFORM = (1<<1), // set by sb_draw_transformed
+} sb_draw_flags;
 
 typedef struct
 {
@@ -28,12 +62,97 @@ typedef struct
 	sb_draw_info array[SB_MAX_DRAW_COUNT];
 } sb_draw_info_array;
 
+// one instanced command per visible mesh part or per cluster any instance kept, every instance of it is a draw id in
+// draw_instance_buffer. each shader id has its own range, drawn with a pipeline specialised for it
 typedef struct
 {
-	uint32_t count;
-	VkDrawIndexedIndirectCommand array[SB_MAX_DRAW_COUNT];
+	uint32_t counts[SB_MAX_SHADER_BINS];
+	VkDrawIndexedIndirectCommand array[SB_MAX_SHADER_BINS][SB_SHADER_BIN_COMMAND_COUNT];
 } sb_indirect_command_array;
 
+// the command list each cull phase fills, sb_cull_ubo.views[i] fills SB_CULL_LIST_VIEWS + i
+typedef enum
+{
+    SB_CULL_LIST_EARLY,
+    SB_CULL_LIST_LATE,
+    SB_CULL_LIST_VIEWS,
+} sb_cull_list;
+
+#define SB_MAX_CULL_LISTS (SB_CULL_LIST_VIEWS + SB_MAX_CULL_VIEWS)
+
+// a frustum culled view with its own command list, like a shadow map's
+typedef struct
+{
+    sb_mat4 view_projection; // the view's clip matrices in draw_matrix_buffer are built from it
+    sb_frustum frustum;
+    uint32_t required_draw_flags; // draws missing any of these are left out of the view
+    uint32_t pad[3];
+} sb_cull_view;
+
+// read by the cull shader every frame. the camera is what the gpass is occlusion culled against,
+// left zeroed nothing is culled from it
+typedef struct
+{
+    sb_mat4 camera_view_projection;
+    sb_mat4 camera_view; // the camera's normal matrices take normals to view space
+    sb_frustum camera_frustum;
+    VkDeviceAddress draw_commands[SB_MAX_CULL_LISTS]; // draw_command_buffers, set by sb_create_app
+
+    sb_vec3 camera_position; // the clusters of the camera's draws that face away from it are culled
+    uint32_t view_count;
+    sb_cull_view views[SB_MAX_CULL_VIEWS];
+} sb_cull_ubo;
+
+typedef enum
+{
+    SB_CULL_PHASE_VIEWS, // each view's draws into its own list, nothing is occlusion culled
+    SB_CULL_PHASE_EARLY, // draws in the camera frustum that were visible last frame
+    SB_CULL_PHASE_LATE, // draws in the camera frustum the depth pyramid doesn't hide and the early phase didn't draw
+} sb_cull_phase;
+
+// draws are grouped by shader id, mesh and lod, (shader_id * SB_MAX_MESHES + mesh_id) * SB_MAX_MESH_LODS + lod
+#define SB_MAX_DRAW_KEYS (SB_MAX_SHADER_BINS * SB_MAX_MESHES * SB_MAX_MESH_LODS)
+
+// gpu only. the cull pass counts each list's instances of every draw key, the compact pass turns the counts into
+// instanced commands and the scatter pass writes every draw's id at its key's first instance plus its slot
+typedef struct
+{
+    uint32_t instance_counts[SB_MAX_CULL_LISTS];
+    uint32_t mesh_instance_counts[SB_MAX_CULL_LISTS][SB_MAX_DRAW_KEYS];
+    uint32_t mesh_first_instances[SB_MAX_CULL_LISTS][SB_MAX_DRAW_KEYS];
+    uint32_t draw_slots[SB_MAX_CULL_LISTS][SB_MAX_DRAW_COUNT]; // a draw's index among its key's instances, ~0 when it was culled
+    uint32_t draw_lods[SB_MAX_DRAW_COUNT];
+} sb_cull_scratch;
+
+// gpu only, indexed by draw id. the cull pass writes a draw's matrices for every list that keeps it, so the vertex
+// shaders read them once per vertex rather than building them. only the kept draws' are current
+typedef struct
+{
+    sb_mat4 camera_clips[SB_MAX_DRAW_COUNT]; // camera_view_projection * transform
+    sb_vec4 camera_normals[SB_MAX_DRAW_COUNT][3]; // the inverse transpose of camera_view * transform, a mat3 of columns
+    sb_mat4 view_clips[SB_MAX_CULL_VIEWS][SB_MAX_DRAW_COUNT]; // views[i].view_projection * transform
+} sb_draw_matrices;
+
+// counted by the late phase, one per draw rather than per mesh part
+typedef struct
+{
+    uint32_t draw_count;
+    uint32_t frustum_rejected_count;
+    uint32_t occlusion_rejected_count;
+    uint32_t pad;
+} sb_cull_stats;
+
+#define SB_MAX_STREAMING_FRAMES 4096U // a longer window keeps its first frames
+
+// frame to frame cpu time over the last run of frames that had assets queued or in flight
+typedef struct
+{
+    uint32_t window_count; // finished windows so far, the rest is replaced whenever it goes up
+    uint32_t frame_count;
+    float p99_ms;
+    float max_ms;
+} sb_streaming_stats;
+
 typedef struct
 {
     float constant_factor;
@@ -56,6 +175,8 @@ typedef struct
     const char *fragment_shader_name;
     const VkDeviceAddress *fragment_ubos;
     uint32_t fragment_ubos_count;
+
+    uint32_t shader_id; // SB_SHADER_ID_CONSTANT_ID in both stages, the bin the pipeline draws
 } sb_graphics_pipeline_info;
 
 typedef struct
@@ -65,6 +186,12 @@ typedef struct
     uint32_t address_count;
 } sb_compute_pipeline_info;
 
+typedef struct
+{
+    sb_sampler_state state;
+    VkSampler sampler;
+} sb_cached_sampler;
+
 typedef struct sb_app
 {
     const void *user_data;
@@ -100,30 +227,82 @@ typedef struct sb_app
     VkFence render_finished_fence;
 
     VkPipelineLayout global_pipeline_layout;
-    VkPipeline compute_cull_pipeline;
+    VkPipeline cull_pipeline; // every phase runs the cull, compact, scatter and cluster passes in turn
+    VkPipeline cull_compact_pipeline;
+    VkPipeline cull_scatter_pipeline;
+    VkPipeline cull_cluster_pipeline;
+    VkPipeline depth_pyramid_pipeline;
 
     sb_mesh_memory mesh_memory;
 
     sb_texture texture_handles[SB_MAX_TEXTURES];
 	uint32_t texture_count;
+	sb_texture_id fallback_texture; // bound in place of textures whose pixels are still queued
 
-	sb_texture_id texture_descriptor_updates[SB_MAX_TEXTURES];
+	// textures share one sampler per distinct state, looked up linearly since there are only ever a few
+	sb_cached_sampler samplers[SB_MAX_SAMPLERS];
+	uint32_t sampler_count;
+
+	sb_texture_id texture_descriptor_updates[SB_MAX_TEXTURES * 2]; // streamed textures are written once at creation and again on arrival
 	uint32_t texture_descriptor_update_count;
 
     sb_transfer_buffer transfer_buffer;
+    sb_pack asset_pack; // empty when no pack was found, assets then load from loose files
+
+    // path -> id, repeated loads of the same file share one decode and one upload
+    sb_asset_cache mesh_cache;
+    sb_asset_cache texture_cache;
 
 	sb_device_arena image_arena;
+	uint32_t texture_flags; // applied to every texture loaded from a file
+	bool is_sampling_base_level_only; // see sb_sample_base_level_only
+	bool use_bc_textures; // textureCompressionBC is enabled, cooked .sbt files are skipped without it
+	bool use_texture_cache; // decoded pngs and jpegs are read from and written to SB_TEXTURE_CACHE_DIRECTORY
+
+    // begin/end timestamp pairs written by the baked command buffers, read back once the frame fence signals
+    VkQueryPool timestamp_pool;
+    double timestamp_period_ms;
+    uint32_t gpu_timer_count;
+    double gpu_timer_ms[SB_MAX_GPU_TIMERS];
 
     sb_device_arena ubo_staging_arena;
     sb_buffer ubo_gpu_memory;
 
-    sb_buffer indirect_command_buffer;
+    sb_buffer draw_command_buffers[SB_MAX_CULL_LISTS]; // indexed by sb_cull_list
+    sb_buffer draw_instance_buffer; // SB_MAX_DRAW_COUNT draw ids per list, the vertex shaders index it with gl_InstanceIndex
+    sb_buffer cull_scratch_buffer;
+    sb_buffer cull_dispatch_buffer; // a VkDispatchIndirectCommand with a thread per draw, written by sb_frame
     sb_buffer draw_info_buffers[2];
 
+    // SB_MAX_MATERIALS per frame in frame_index order, sb_draw adds a frame's materials as it meets them
+    sb_buffer material_buffer;
+    uint32_t material_count;
+    uint16_t material_slots[SB_MATERIAL_SLOT_COUNT]; // open addressed over the frame's materials, index + 1, 0 is empty
+
+    // SB_MAX_GENERAL_TRANSFORMS per frame in frame_index order, the matrices sb_draw_transformed couldn't encode
+    sb_buffer transform_buffer;
+    uint32_t transform_count;
+    sb_cull_ubo *cull_ubo; // in the ubo staging arena, the app fills the camera and views every frame
+
+    // farthest depth per level of the depth buffer the early draws leave, a storage image per level to build it
+    sb_texture_id depth_pyramid;
+    VkImageView depth_pyramid_views[SB_MAX_DEPTH_PYRAMID_LEVELS];
+    sb_buffer draw_visibility_buffer; // a uint per draw, set by the late phase and read by the next frame's early one
+    sb_buffer draw_matrix_buffer; // sb_draw_matrices
+
+    sb_buffer cull_stats_buffer;
+    sb_cull_stats cull_stats; // the last finished frame's, read back with the gpu timers
+
+    double last_frame_start_ms;
+    bool is_frame_streaming; // the last frame started with assets queued or in flight
+    float streaming_frame_ms[SB_MAX_STREAMING_FRAMES];
+    uint32_t streaming_frame_count;
+    sb_streaming_stats streaming_stats; // the last finished window's
+
     uint8_t frame_index;
 } sb_app;
 
-static VkSpecializationInfo *get_specialization_info(sb_arena *arena, const VkDeviceAddress *addresses, uint32_t address_count);
+static VkSpecializationInfo *get_specialization_info(sb_arena *arena, const VkDeviceAddress *addresses, uint32_t address_count, uint32_t shader_id);
 VkPipeline sb_create_graphics_pipeline(sb_app *app, const sb_graphics_pipeline_info *pipeline_info);
 VkPipeline sb_create_compute_pipeline(sb_app *app, const sb_compute_pipeline_info *pipeline_info);
 
@@ -133,6 +312,7 @@ typedef struct
 {
     VkFormat format;
     VkExtent2D extent;
+    uint32_t mip_levels; // levels the upload provides, 0 means 1, SB_TEXTURE_FLAG_MIPMAPPED builds a full chain instead
     VkSamplerAddressMode sampler_address_mode;
     VkBorderColor sampler_border_color;
     sb_texture_type texture_type;
@@ -141,9 +321,19 @@ typedef struct
     uint32_t flags;
 } sb_texture_info;
 
+VkSampler sb_get_sampler(sb_app *app, const sb_sampler_state *state);
 sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info);
+static const char *get_cooked_texture_path(sb_arena *arena, const char *file_path);
+static VkFormat get_texture_file_format(sb_texture_file_format format);
+static bool is_valid_texture_file(const void *data, uint64_t size);
+
+// png or jpeg, or the .sbt sbtex cooked from it when one sits next to it or in the pack
 sb_texture_id sb_texture_from_file(sb_app *app, const char *file_path);
+sb_texture_id sb_texture_from_file_prioritized(sb_app *app, const char *file_path, sb_asset_priority priority);
+uint32_t sb_release_texture(sb_app *app, const char *file_path);
 sb_texture *sb_get_texture(sb_app *app, sb_texture_id id);
+// every mipmapped texture samples mip 0 only while set, for timing the same frames with and without the chains
+void sb_sample_base_level_only(sb_app *app, bool enable);
 
 typedef enum
 {
@@ -186,7 +376,14 @@ typedef struct
 
 void sb_begin_render_pass(VkCommandBuffer command_buffer, sb_render_pass_info *info);
 #define sb_bind_graphics_pipeline(command_buffer, pipeline) vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline)
-void sb_draw_scene(VkCommandBuffer command_buffer, sb_buffer *draw_command_buffer);
+void sb_draw_scene(VkCommandBuffer command_buffer, sb_buffer *draw_command_buffer, uint32_t shader_id); // one bin of the list
+
+// two phase occlusion culling for the gpass. draw SB_CULL_LIST_EARLY after sb_cull_early_draws, then with the depth
+// buffer in SB_IMAGE_LAYOUT_READ_ONLY sb_cull_late_draws builds the pyramid from it and fills SB_CULL_LIST_LATE
+static void dispatch_cull(sb_app *app, VkCommandBuffer command_buffer, sb_cull_phase phase);
+void sb_cull_early_draws(sb_app *app, VkCommandBuffer command_buffer);
+static void build_depth_pyramid(sb_app *app, VkCommandBuffer command_buffer, sb_texture_id depth_buffer);
+void sb_cull_late_draws(sb_app *app, VkCommandBuffer command_buffer, sb_texture_id depth_buffer);
 void sb_draw_pixels(VkCommandBuffer command_buffer);
 #define sb_end_render_pass(command_buffer) vkCmdEndRendering(command_buffer)
 
@@ -196,21 +393,50 @@ typedef struct
     void (*bake_command_buffer) (sb_app *app, VkCommandBuffer command_buffer, sb_texture *swapchain_texture);
     int window_height;
     int window_width;
+    const char *asset_pack_path; // optional, sb_create_mesh and sb_texture_from_file look here before the loose files
+
+    // per frame upload budget, queued assets past it stream in over the following frames, 0 means unlimited
+    VkDeviceSize upload_bytes_per_frame;
+    float upload_ms_per_frame;
+
+    bool skip_mipmaps; // textures from files upload mip 0 only
+    bool skip_host_image_copy; // always upload through staging, even where VK_EXT_host_image_copy is supported
+    bool skip_texture_cache; // decode every png and jpeg on every run, for timing the decoder itself
+    bool use_32_bit_indices; // the shared index buffer is uint16 otherwise, meshes with more vertices than that addresses are split
 } sb_app_info;
 
 sb_app *sb_create_app(const sb_app_info *app_info);
 
+static void create_depth_pyramid(sb_app *app);
+static void destroy_depth_pyramid(sb_app *app);
+
 static void sb_update_texture_descriptors(sb_app *app);
 static void sb_recreate_window_relative_textures(sb_app *app);
 static void sb_recreate_swapchain(sb_app *app);
 static void sb_recreate_command_buffers(sb_app *app);
 static sb_buffer *sb_get_frame_draw_info_buffer(sb_app *app);
+static uint32_t get_material_id(sb_app *app, const sb_material *material);
+static uint32_t pack_snorm16x2(float x, float y);
+static void sb_read_gpu_timers(sb_app *app);
+static int compare_frame_ms(const void *lhs, const void *rhs);
+static void record_streaming_frame(sb_app *app);
+
+// every timer created has to be written by the baked command buffers, results lag a frame behind
+sb_gpu_timer_id sb_create_gpu_timer(sb_app *app);
+void sb_begin_gpu_timer(sb_app *app, VkCommandBuffer command_buffer, sb_gpu_timer_id id);
+void sb_end_gpu_timer(sb_app *app, VkCommandBuffer command_buffer, sb_gpu_timer_id id);
+double sb_get_gpu_timer_ms(sb_app *app, sb_gpu_timer_id id);
 
 void sb_on_resize(sb_app *app);
 void sb_frame(sb_app *app);
 bool sb_run_app(sb_app *app, sb_window_event *window_event);
 
 sb_mesh_id sb_create_mesh(sb_app *app, const char *name);
-void sb_draw(sb_app *app, const sb_draw_info *draw_info);
+sb_mesh_id sb_create_mesh_prioritized(sb_app *app, const char *name, sb_asset_priority priority);
+void sb_set_fallback_mesh(sb_app *app, sb_mesh_id id);
+uint32_t sb_release_mesh(sb_app *app, const char *name);
+void sb_set_draw_trs(sb_draw_info *draw_info, sb_vec3 position, sb_vec4 rotation, float scale);
+void sb_draw(sb_app *app, const sb_draw_info *draw_info, const sb_material *material);
+void sb_draw_transformed(sb_app *app, const sb_draw_info *draw_info, const sb_material *material, sb_mat4 transform);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef SB_ASSET_CACHE_H
+#define SB_ASSET_CACHE_H
+
+#include "sb_string.h"
+
+// open addressing with linear probing, sized so the table never gets past half full
+// even when every mesh or texture slot is in use
+#define SB_ASSET_CACHE_CAPACITY 2048U
+
+typedef struct
+{
+	uint64_t hash;
+	sb_str8 path; // interned in the cache arena, size 0 marks an empty slot
+	uint32_t id;
+	uint32_t ref_count;
+} sb_asset_cache_slot;
+
+typedef struct
+{
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t probes; // slots compared over all lookups, probes / lookups is the average chain length
+	uint32_t longest_probe;
+} sb_asset_cache_stats;
+
+typedef struct
+{
+	sb_arena *arena;
+	uint32_t count;
+	sb_asset_cache_stats stats;
+	sb_asset_cache_slot slots[SB_ASSET_CACHE_CAPACITY];
+} sb_asset_cache;
+
+void sb_init_asset_cache(sb_asset_cache *cache);
+static sb_asset_cache_slot *find_slot(sb_asset_cache *cache, sb_str8 path, uint64_t hash);
+
+// on a hit the ref count goes up and the slot holds the id loaded the first time,
+// on a miss path is interned and the caller loads the asset and stores its id in the returned slot
+bool sb_asset_cache_acquire(sb_asset_cache *cache, const char *path, sb_asset_cache_slot **out_slot);
+
+// returns the references left, ids stay mapped at zero since device memory is only freed wholesale
+uint32_t sb_asset_cache_release(sb_asset_cache *cache, const char *path);
+void sb_asset_cache_print_stats(const char *name, const sb_asset_cache *cache);
+
+#endif
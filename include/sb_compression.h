@@ -0,0 +1,30 @@
+#ifndef SB_COMPRESSION_H
+#define SB_COMPRESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sb_math.h"
+
+// lz77 byte stream in the lz4 block layout, a sequence is
+// token (literal length << 4 | match length - 4), extra literal length bytes, literals,
+// u16 little endian match offset, extra match length bytes
+// the last sequence of a block carries literals only
+#define SB_LZ_MIN_MATCH 4
+#define SB_LZ_HASH_BITS 12
+
+size_t sb_lz_compress_bound(size_t size);
+size_t sb_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_capacity);
+size_t sb_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size);
+
+// payloads are split into independent blocks so they can be expanded in parallel (one gpu invocation per block)
+// layout: uint32_t block_offsets[block_count + 1] relative to the payload start, then the blocks
+// a block whose stored size equals its raw size is kept uncompressed
+#define SB_COMPRESSION_BLOCK_SIZE KB(16)
+#define sb_compression_block_count(raw_size) (uint32_t)(((raw_size) + SB_COMPRESSION_BLOCK_SIZE - 1) / SB_COMPRESSION_BLOCK_SIZE)
+
+size_t sb_compress_blocks_bound(size_t raw_size);
+size_t sb_compress_blocks(const void *src, size_t raw_size, void *dst, size_t dst_capacity);
+void sb_decompress_blocks(const void *src, void *dst, size_t raw_size);
+
+#endif
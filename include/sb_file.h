@@ -12,5 +12,33 @@ uint64_t sb_get_file_size(FILE *file);
 void *sb_read_file_bytes(sb_arena *arena, FILE *file, uint64_t bytes);
 void *sb_read_file_binary(sb_arena *arena, const char *name, uint64_t *out_size);
 sb_str8 sb_read_file_string(sb_arena *arena, const char *name);
+bool sb_file_exists(const char *name);
+void sb_create_directory(const char *name); // nothing happens when it already exists
+
+// names, not paths, of the files in directory that end in extension, in no particular order
+sb_str8 *sb_list_directory(sb_arena *arena, const char *directory, const char *extension, uint32_t *out_count);
+
+// hint for how the mapped view will be read, forwarded to the os (madvise on posix, file flags + prefetch on win32)
+typedef enum
+{
+	SB_FILE_ACCESS_SEQUENTIAL,
+	SB_FILE_ACCESS_RANDOM,
+} sb_file_access;
+
+typedef struct
+{
+	const void *data;
+	uint64_t size;
+
+	void *file_handle;
+	void *mapping_handle;
+} sb_mapped_file;
+
+// read only view of an entire file, valid until sb_unmap_file
+sb_mapped_file sb_map_file(const char *name, sb_file_access access);
+void sb_unmap_file(sb_mapped_file *file);
+#define sb_mapped_file_str8(file) (sb_str8) {(char*)(file).data, (file).size}
+
+static bool has_extension(const char *name, const char *extension);
 
 #endif
@@ -0,0 +1,133 @@
+#ifndef SB_IMAGE_H
+#define SB_IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sb_arena.h"
+
+// decoder for the image formats the game ships, baseline huffman jpeg (greyscale or ycbcr, any 1x/2x chroma
+// subsampling) and 8 bit non interlaced png of every colour type, always decoded to rgba8
+// the idct, chroma upsampling, colour conversion and png unfiltering run on sse2, with avx2 paths picked at runtime
+typedef struct
+{
+	uint32_t width;
+	uint32_t height;
+} sb_image_info;
+
+// parses the header only, false when the data isn't an image the decoder handles
+bool sb_get_image_info(const void *data, size_t size, sb_image_info *out_info);
+
+// decodes into rgba, which must hold width * height * 4 bytes, scratch arenas hold the intermediate planes
+bool sb_decode_image(const void *data, size_t size, uint8_t *rgba, size_t rgba_size);
+
+static bool has_avx2(void);
+
+typedef struct
+{
+	const uint8_t *src;
+	const uint8_t *src_end;
+	uint64_t bits; // lsb first
+	uint32_t bit_count;
+	uint32_t overrun; // zero bytes fed past the end of the stream
+
+	uint8_t *dst_start;
+	uint8_t *dst;
+	uint8_t *dst_end; // writable up to 8 bytes past this, matches are copied in 8 byte steps
+} inflate_state;
+
+#define INFLATE_FAST_BITS 10
+
+typedef struct
+{
+	uint16_t fast[1 << INFLATE_FAST_BITS]; // symbol << 4 | length, 0 when the code is longer than the table
+	uint16_t counts[16];
+	uint16_t symbols[288]; // sorted by code length then symbol, for the canonical slow path
+} inflate_huffman;
+
+static bool build_inflate_huffman(inflate_huffman *huffman, const uint8_t *lengths, uint32_t count);
+static void inflate_refill(inflate_state *state);
+static uint32_t inflate_take(inflate_state *state, uint32_t count);
+static int32_t inflate_decode(inflate_state *state, const inflate_huffman *huffman);
+static bool inflate_block(inflate_state *state, const inflate_huffman *lengths, const inflate_huffman *distances);
+static bool inflate_dynamic_tables(inflate_state *state, inflate_huffman *lengths, inflate_huffman *distances);
+static bool zlib_inflate(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+static void unfilter_row_scalar(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter);
+static void unfilter_row_sse2(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter);
+static void unfilter_pixels_sse2(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter);
+static void unfilter_up_avx2(uint8_t *row, const uint8_t *prior, uint32_t row_size);
+static void expand_rgb_row_avx2(uint8_t *rgba, const uint8_t *rgb, uint32_t width);
+static void expand_rgb_row(uint8_t *rgba, const uint8_t *rgb, uint32_t width, bool use_avx2);
+static bool decode_png(const uint8_t *data, size_t size, uint8_t *rgba, size_t rgba_size);
+
+typedef struct
+{
+	uint16_t fast[1 << 9]; // length << 8 | symbol, 0 when the code is longer than 9 bits
+	int16_t fast_ac[1 << 9]; // coefficient << 8 | run << 4 | code and coefficient length, 0 when they don't fit in 9 bits
+	int32_t max_code[18]; // largest code of each length, -1 when there are none
+	int32_t value_offset[17]; // code of each length minus this is its index into values
+	uint8_t values[256];
+} jpeg_huffman;
+
+typedef struct
+{
+	const uint8_t *src;
+	const uint8_t *src_end;
+	uint64_t bits; // msb first
+	uint32_t bit_count;
+	bool hit_marker; // zeros are fed once the entropy coded segment ends
+} jpeg_bits;
+
+typedef struct
+{
+	uint8_t id;
+	uint8_t h;
+	uint8_t v;
+	uint8_t quant_table;
+	uint8_t dc_table;
+	uint8_t ac_table;
+	int32_t dc_prediction;
+
+	uint32_t width; // in samples, before upsampling
+	uint32_t height;
+	uint32_t stride; // whole mcus of blocks
+	uint8_t *plane;
+} jpeg_component;
+
+typedef struct
+{
+	uint16_t quant[4][64]; // zigzag order
+	jpeg_huffman dc[4];
+	jpeg_huffman ac[4];
+	jpeg_component components[3];
+	uint32_t component_count;
+	uint32_t width;
+	uint32_t height;
+	uint32_t h_max;
+	uint32_t v_max;
+	uint32_t mcu_x;
+	uint32_t mcu_y;
+	uint32_t restart_interval;
+	bool has_adobe_transform;
+	bool is_rgb; // stored as r g b rather than ycbcr
+	jpeg_component *scan[3]; // components of the scan being decoded, in scan order
+	uint32_t scan_count;
+} jpeg_decoder;
+
+static bool build_jpeg_huffman(jpeg_huffman *huffman, const uint8_t *counts, const uint8_t *values, uint32_t value_count);
+static void jpeg_refill(jpeg_bits *bits);
+static int32_t jpeg_decode(jpeg_bits *bits, const jpeg_huffman *huffman);
+static int32_t jpeg_receive_extend(jpeg_bits *bits, uint32_t size);
+static bool jpeg_decode_block(jpeg_bits *bits, jpeg_decoder *decoder, jpeg_component *component, uint8_t *out, uint32_t stride);
+static void idct_block_sse2(const int16_t *coefficients, uint8_t *out, uint32_t stride);
+static void jpeg_restart(jpeg_bits *bits, jpeg_decoder *decoder);
+static bool jpeg_decode_scan(jpeg_decoder *decoder, const uint8_t **cursor, const uint8_t *end);
+static const uint8_t *upsample_row(const jpeg_decoder *decoder, const jpeg_component *component, uint32_t y, int16_t *taps, uint8_t *out);
+static void ycbcr_to_rgba_row_sse2(uint8_t *rgba, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint32_t width);
+static void ycbcr_to_rgba_row_avx2(uint8_t *rgba, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint32_t width);
+static void grey_to_rgba_row(uint8_t *rgba, const uint8_t *grey, uint32_t width);
+static bool decode_jpeg(const uint8_t *data, size_t size, uint8_t *rgba, size_t rgba_size);
+
+#endif
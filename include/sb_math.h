@@ -14,6 +14,9 @@
 #define MB(x) ((size_t) (x) << 20)
 #define GB(x) ((size_t) (x) << 30)
 
+#define SB_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define SB_MAX(a, b) ((a) > (b) ? (a) : (b))
+
 typedef struct
 {
 	uint8_t r;
@@ -46,6 +49,8 @@ float sb_clamp(float d, float min, float max);
 float sb_rad(float deg);
 bool sb_is_power_of_two(size_t n);
 size_t sb_round_up(size_t n, size_t mult);
+uint16_t sb_f32_to_f16(float value); // round to nearest even, out of range values become infinity
+float sb_f16_to_f32(uint16_t value);
 
 typedef struct
 {
@@ -114,4 +119,16 @@ void sb_mat4_look_at(sb_vec3 eye, sb_vec3 center, sb_vec3 up, sb_mat4 out);
 void sb_mat4_projection_ortho(sb_mat4 out, float left, float right, float top, float bottom, float near, float far);
 void sb_mat4_projection_perpective(sb_mat4 out, float aspect_ratio, float fov, float near, float far);
 
+// false unless the matrix is a rotation with a uniform scale and a translation. the rotation is a unit quaternion, xyz
+// then w, the identity when the scale is 0
+bool sb_mat4_get_trs(sb_mat4 in, sb_vec3 *out_position, sb_vec4 *out_rotation, float *out_scale);
+
+// planes face inwards with unit normals in xyz, a point is inside when dot(plane.xyz, point) + plane.w >= 0 for all six
+typedef struct
+{
+    sb_vec4 planes[6];
+} sb_frustum;
+
+sb_frustum sb_frustum_from_mat4(sb_mat4 view_projection); // vulkan clip space, depth from 0 to 1
+
 #endif
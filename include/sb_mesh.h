@@ -3,25 +3,37 @@
 
 #include "sb_math.h"
 #include "sb_vulkan_memory.h"
+#include "sb_mesh_file.h"
 
 #define SB_MAX_MESHES 1024U
+#define SB_NULL_MESH_ID UINT32_MAX
+#define SB_MAX_MESH_PARTS 256U // extra handles after the mesh ids, for meshes split to fit 16 bit indices
+#define SB_MAX_MESH_CLUSTERS 65536U
 
 typedef uint32_t sb_mesh_id;
 
 typedef struct
 {
-	sb_vec3 position;
-	sb_vec3 normal;
-	sb_vec2 uv;
-} sb_vertex;
+	uint32_t first_index;
+	uint32_t index_count;
+} sb_mesh_lod;
 
 typedef struct
 {
 	int vertex_offset;
 	uint32_t vertex_count;
+	uint32_t lod_count; // the parts of a split mesh only have lod 0
+	uint32_t cluster_count; // lod 0's clusters, the cull shader culls them one by one when drawing lod 0
 
-	uint32_t first_index;
-	uint32_t index_count;
+	// packed positions are position_offset + unorm * position_scale, the mesh bounds
+	sb_vec3 position_offset;
+	uint32_t first_cluster; // into cluster_buffer
+	sb_vec3 position_scale;
+	uint32_t next_part; // handle drawing the rest of a split mesh, 0 when there is none
+
+	// index ranges over the same vertices, the cull shader picks one per draw from how big its error is on screen
+	sb_mesh_lod lods[SB_MAX_MESH_LODS];
+	float lod_errors[SB_MAX_MESH_LODS];
 } sb_mesh_handle;
 
 typedef struct
@@ -31,14 +43,21 @@ typedef struct
 
 	uint32_t index_count;
 	sb_buffer index_buffer;
+	VkIndexType index_type; // every mesh's indices are this wide, 16 bit ones address vertices from vertex_offset on
 
-	uint32_t handle_count;
 	sb_buffer handle_buffer;
+	sb_mesh_handle handles[SB_MAX_MESHES + SB_MAX_MESH_PARTS]; // cpu copy of handle_buffer, indexed by mesh id then part
+	uint32_t part_count;
+
+	uint32_t cluster_count;
+	sb_buffer cluster_buffer; // sb_mesh_cluster, every mesh's one after the other
 
 	uint32_t mesh_count;
+	sb_mesh_id fallback_mesh; // meshes still in the transfer queue draw this one, SB_NULL_MESH_ID draws nothing
 } sb_mesh_memory;
 
-sb_mesh_memory sb_alloc_mesh_memory(VkDevice device, const sb_memory_types *memory_types);
+sb_mesh_memory sb_alloc_mesh_memory(VkDevice device, const sb_memory_types *memory_types, VkIndexType index_type);
+#define sb_get_index_size(index_type) ((index_type) == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t))
 void sb_bind_mesh_buffers(VkCommandBuffer command_buffer, sb_mesh_memory *meshes);
 
 
@@ -0,0 +1,167 @@
+#ifndef SB_MESH_FILE_H
+#define SB_MESH_FILE_H
+
+#include "sb_math.h"
+#include "sb_arena.h"
+
+// .sbm v4 layout: sb_mesh_file_header | sb_mesh_cluster clusters[cluster_count] | sb_packed_vertex vertices[vertex_count] |
+// indices[index_count]. indices are uint16_t when SB_MESH_FILE_16_BIT_INDICES_FLAG is set, which every mesh small enough
+// gets, uint32_t otherwise. the indices hold every lod one after the other, all of them indexing the same vertices, and
+// the clusters split lod 0's into ranges the gpu culls one by one
+// v3 files are the same with a shorter header and no clusters, v2 ones also have a single lod. v1 files have no magic, they start with
+// sb_mesh_file_header_v1 followed by float sb_vertex data. they still load, their vertices are packed on the way into
+// staging and sbpak upgrades them, so the gpu only ever sees packed vertices
+#define SB_MESH_FILE_MAGIC 0x534d4253 // "SBMS"
+#define SB_MESH_FILE_VERSION 4
+#define SB_MESH_PART_MAX_VERTICES 65536U // as many as 16 bit indices address
+#define SB_MAX_MESH_LODS 4U
+#define SB_MESH_CLUSTER_MAX_VERTICES 64U
+#define SB_MESH_CLUSTER_MAX_TRIANGLES 124U
+
+typedef enum
+{
+	SB_MESH_FILE_16_BIT_INDICES_FLAG = 1 << 0,
+} sb_mesh_file_flags;
+
+typedef struct
+{
+	sb_vec3 position;
+	sb_vec3 normal;
+	sb_vec2 uv;
+} sb_vertex;
+
+// 16 bytes to sb_vertex's 32, gpass.vert and shadow.vert unpack it
+typedef struct
+{
+	uint16_t position[4]; // unorm across the mesh bounds, w is padding (16 bit xyz isn't a required vertex format)
+	int16_t normal[2]; // octahedral, snorm
+	uint16_t uv[2]; // half floats
+} sb_packed_vertex;
+
+typedef struct
+{
+	uint32_t vertex_count;
+	uint32_t index_count;
+} sb_mesh_file_header_v1;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count;
+
+	sb_vec3 bounds_min;
+	uint32_t flags;
+	sb_vec3 bounds_max;
+	uint32_t pad1;
+} sb_mesh_file_header_v2;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count; // every lod's
+
+	sb_vec3 bounds_min;
+	uint32_t flags;
+	sb_vec3 bounds_max;
+	uint32_t lod_count; // where v2 has padding, at least 1 from v3 on
+
+	uint32_t lod_index_counts[SB_MAX_MESH_LODS]; // lod 0 is the whole mesh, each one after it about half the last
+	float lod_errors[SB_MAX_MESH_LODS]; // how far each lod's surface strays from lod 0's, in the units of the positions
+} sb_mesh_file_header_v3;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count; // every lod's
+
+	sb_vec3 bounds_min;
+	uint32_t flags;
+	sb_vec3 bounds_max;
+	uint32_t lod_count;
+
+	uint32_t lod_index_counts[SB_MAX_MESH_LODS];
+	float lod_errors[SB_MAX_MESH_LODS];
+
+	uint32_t cluster_count; // 0 when lod 0 fits in a single cluster or is too big for 16 bit indices
+	uint32_t pad[3];
+} sb_mesh_file_header;
+
+// at most SB_MESH_CLUSTER_MAX_VERTICES vertices and SB_MESH_CLUSTER_MAX_TRIANGLES triangles of lod 0, in the units of the
+// positions. the handles and mesh.h use the same layout
+typedef struct
+{
+	sb_vec3 center; // bounding sphere
+	float radius;
+	sb_vec3 cone_axis; // every triangle's normal is within the cone around it
+	float cone_cutoff; // sin of the cone's half angle, 1 when the cone is too wide to ever face away
+	uint32_t first_index; // from lod 0's first index
+	uint32_t index_count;
+	uint32_t pad[2];
+} sb_mesh_cluster;
+
+_Static_assert(sizeof(sb_mesh_file_header_v2) % _Alignof(sb_packed_vertex) == 0, "vertices must stay aligned after the header");
+_Static_assert(sizeof(sb_mesh_file_header_v3) % _Alignof(sb_packed_vertex) == 0, "vertices must stay aligned after the header");
+_Static_assert(sizeof(sb_mesh_file_header) % _Alignof(sb_mesh_cluster) == 0, "clusters must stay aligned after the header");
+_Static_assert(sizeof(sb_mesh_cluster) % 16 == 0, "clusters are read as std430 structs");
+
+#define sb_is_mesh_file_v1(data) (((const sb_mesh_file_header*)(data))->magic != SB_MESH_FILE_MAGIC)
+#define sb_mesh_file_header_size(header) (((const sb_mesh_file_header*)(header))->version < 3 ? sizeof(sb_mesh_file_header_v2) : \
+	((const sb_mesh_file_header*)(header))->version < 4 ? sizeof(sb_mesh_file_header_v3) : sizeof(sb_mesh_file_header))
+#define sb_mesh_file_cluster_count(header) (((const sb_mesh_file_header*)(header))->version < 4 ? 0U : ((const sb_mesh_file_header*)(header))->cluster_count)
+#define sb_mesh_file_clusters(header) ((const sb_mesh_cluster*) ((const uint8_t*)(header) + sb_mesh_file_header_size(header)))
+#define sb_mesh_file_vertices(header) ((const sb_packed_vertex*) (sb_mesh_file_clusters(header) + sb_mesh_file_cluster_count(header)))
+#define sb_mesh_file_indices(header) ((const void*) (sb_mesh_file_vertices(header) + ((const sb_mesh_file_header*)(header))->vertex_count))
+#define sb_mesh_file_index_size(header) ((((const sb_mesh_file_header*)(header))->flags & SB_MESH_FILE_16_BIT_INDICES_FLAG) ? 2U : 4U)
+
+// false when size is too small for the header or for the payload the header declares, checked before reading the counts
+bool sb_is_valid_mesh_file(const void *data, uint64_t size);
+
+// counts of either version
+uint32_t sb_get_mesh_file_vertex_count(const void *data);
+uint32_t sb_get_mesh_file_index_count(const void *data);
+uint32_t sb_get_mesh_file_index_size(const void *data);
+const void *sb_get_mesh_file_indices(const void *data);
+uint32_t sb_get_mesh_file_cluster_count(const void *data);
+
+// returns the lod count, files from before lods have the whole mesh as their only one
+uint32_t sb_get_mesh_file_lods(const void *data, uint32_t out_index_counts[SB_MAX_MESH_LODS], float out_errors[SB_MAX_MESH_LODS]);
+
+void sb_get_vertex_bounds(const sb_vertex *vertices, uint32_t vertex_count, sb_vec3 *out_min, sb_vec3 *out_max);
+void sb_pack_vertices(sb_packed_vertex *out, const sb_vertex *vertices, uint32_t vertex_count, sb_vec3 bounds_min, sb_vec3 bounds_max);
+sb_vertex sb_unpack_vertex(const sb_packed_vertex *vertex, sb_vec3 bounds_min, sb_vec3 bounds_max);
+
+// v4 copy of an older file in arena, v4 files come back as they are
+const void *sb_upgrade_mesh_file(sb_arena *arena, const void *data, uint64_t *size);
+
+// writes a v4 file with a single lod and no clusters, indices are narrowed to 16 bits when vertex_count allows it
+void sb_write_mesh_file(const char *name, const sb_packed_vertex *vertices, uint32_t vertex_count,
+	const uint32_t *indices, uint32_t index_count, sb_vec3 bounds_min, sb_vec3 bounds_max);
+// the same with every lod's indices one after the other in indices, and lod 0's clusters
+void sb_write_mesh_file_lods(const char *name, const sb_packed_vertex *vertices, uint32_t vertex_count, const uint32_t *indices,
+	const uint32_t *lod_index_counts, const float *lod_errors, uint32_t lod_count, const sb_mesh_cluster *clusters, uint32_t cluster_count,
+	sb_vec3 bounds_min, sb_vec3 bounds_max);
+
+typedef struct
+{
+	uint32_t first_vertex; // into the split vertices
+	uint32_t vertex_count;
+	uint32_t first_index;
+	uint32_t index_count;
+} sb_mesh_part;
+
+// greedy split of a triangle list into parts of at most SB_MESH_PART_MAX_VERTICES vertices, a vertex shared across a part
+// boundary is duplicated into the next part. returns the part count, every output can be null to only count them;
+// out_source_vertices gets the original vertex each split vertex copies and out_indices the indices within each part
+uint32_t sb_split_mesh(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count,
+	sb_mesh_part *out_parts, uint32_t *out_source_vertices, uint16_t *out_indices, uint32_t *out_split_vertex_count);
+
+static void encode_octahedral(sb_vec3 normal, int16_t *out);
+static sb_vec3 decode_octahedral(const int16_t *encoded);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SB_OBJ_H
+#define SB_OBJ_H
+
+#include "sb_mesh_file.h"
+
+// wavefront .obj reader for the offline tools. only v, vt, vn and f lines are read, polygons are fanned into triangles
+// and every distinct v/vt/vn corner becomes one vertex. texture coordinates are flipped to a top left origin
+typedef struct
+{
+	sb_vertex *vertices;
+	uint32_t vertex_count;
+	uint32_t *indices;
+	uint32_t index_count;
+} sb_obj_mesh;
+
+// false when the text isn't an obj with at least one face, out_mesh is pushed onto arena.
+// the text is split on line breaks across up to thread_count threads, a small file only gets one
+bool sb_load_obj(sb_arena *arena, const char *text, uint64_t size, uint32_t thread_count, sb_obj_mesh *out_mesh);
+
+static bool is_obj_space(char c);
+static const char *skip_obj_line(const char *at, const char *end);
+static const char *skip_obj_spaces(const char *at, const char *end);
+static bool convert_digits(const char *at, uint32_t *out_value, uint32_t *out_count);
+static const char *parse_obj_decimal(const char *c, const char *end, uint64_t *out_mantissa, int32_t *out_exponent);
+static float parse_obj_float(const char **at, const char *end);
+static uint32_t parse_obj_index(const char **at, const char *end, uint32_t count);
+static void count_obj_chunk(void *data);
+static void parse_obj_chunk(void *data);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SB_PACK_H
+#define SB_PACK_H
+
+#include "sb_file.h"
+#include "sb_string.h"
+
+// .sbpak layout:
+// sb_pack_header | sb_pack_entry toc[entry_count] sorted by path_hash | name table | payloads
+// the toc and every payload start on SB_PACK_ALIGNMENT, payloads are stored in manifest order
+// which is the order the game queues its uploads, so staging copies walk the file front to back
+#define SB_PACK_MAGIC 0x4b504253 // "SBPK"
+#define SB_PACK_VERSION 2 // 2: mesh payloads are always .sbm v2
+#define SB_PACK_ALIGNMENT 64
+
+typedef enum
+{
+	SB_PACK_ENTRY_COMPRESSED_FLAG = 1 << 0, // payload is in the sb_compress_blocks layout
+} sb_pack_entry_flags;
+
+typedef enum
+{
+	SB_ASSET_TYPE_UNKNOWN,
+	SB_ASSET_TYPE_MESH,
+	SB_ASSET_TYPE_TEXTURE,
+	SB_ASSET_TYPE_SHADER,
+	SB_ASSET_TYPE_LEVEL,
+} sb_asset_type;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t pad0;
+
+	uint64_t toc_offset;
+	uint64_t names_offset;
+	uint64_t data_offset;
+	uint64_t data_size;
+
+	uint32_t pad1[4];
+} sb_pack_header;
+
+typedef struct
+{
+	uint64_t path_hash;
+	uint64_t offset; // from the start of the pack
+	uint64_t stored_size;
+	uint64_t raw_size;
+
+	uint32_t name_offset; // into the name table, not null terminated
+	uint32_t name_size;
+	uint32_t flags;
+	uint32_t asset_type;
+
+	// per asset type, meshes store vertex count, index count, sb_mesh_file_flags and either the vertex count once split
+	// for 16 bit indices or, when the mesh fits without, its cluster count. .sbt textures width, height, format and mip count
+	uint32_t metadata[4];
+} sb_pack_entry;
+
+_Static_assert(sizeof(sb_pack_header) == SB_PACK_ALIGNMENT, "pack header must fill one alignment slot");
+_Static_assert(sizeof(sb_pack_entry) == SB_PACK_ALIGNMENT, "toc entries must stay cache line sized");
+
+typedef struct
+{
+	sb_mapped_file file;
+	const sb_pack_header *header;
+	const sb_pack_entry *entries;
+	const char *names;
+} sb_pack;
+
+// returns false when there is no pack at path, callers fall back to loose files
+bool sb_open_pack(const char *path, sb_pack *out_pack);
+void sb_close_pack(sb_pack *pack);
+
+const sb_pack_entry *sb_pack_find(const sb_pack *pack, const char *path);
+#define sb_pack_entry_name(pack, entry) (sb_str8) {(char*)(pack)->names + (entry)->name_offset, (entry)->name_size}
+#define sb_pack_entry_stored(pack, entry) (const void*) ((const uint8_t*)(pack)->file.data + (entry)->offset)
+
+// zero copy view into the mapping for uncompressed entries, otherwise decompressed into arena
+const void *sb_pack_load(sb_arena *arena, const sb_pack *pack, const sb_pack_entry *entry);
+// same but only the blocks holding the first size bytes are decompressed, for reading a header ahead of the payload
+const void *sb_pack_load_prefix(sb_arena *arena, const sb_pack *pack, const sb_pack_entry *entry, uint64_t size);
+
+#endif
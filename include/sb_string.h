@@ -11,7 +11,14 @@ typedef struct
 
 #define sb_str8_lit(s) (sb_str8){(char*)(s), sizeof(s) - 1}
 
+sb_str8 sb_str8_from_cstr(const char *str);
+sb_str8 sb_str8_copy(sb_arena *arena, sb_str8 s);
 sb_str8 sb_str8_concat(sb_arena *arena, sb_str8 s1, sb_str8 s2);
 sb_str8 sb_u8_to_str8(sb_arena *arena, uint8_t number);
+bool sb_str8_eq(sb_str8 lhs, sb_str8 rhs);
+
+// 64 bit FNV-1a, stable across runs so it can be baked into asset files
+uint64_t sb_hash_bytes(const void *data, size_t size);
+#define sb_str8_hash(s) sb_hash_bytes((s).str, (s).size)
 
 #endif
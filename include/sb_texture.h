@@ -5,6 +5,7 @@
 
 #define SB_MAX_TEXTURES 1024U
 #define SB_NULL_TEXTURE_ID 0U
+#define SB_MAX_DEPTH_PYRAMID_LEVELS 16U // one storage image per level, enough for a 65536 wide depth buffer
 
 typedef enum
 {
@@ -23,10 +24,21 @@ typedef enum
 {
     SB_TEXTURE_FLAG_DEDICATED_ALLOCATION = (1<<1),
     SB_TEXTURE_FLAG_WINDOW_RELATIVE = (1<<2),
+    SB_TEXTURE_FLAG_MIPMAPPED = (1<<3), // full chain down to 1x1, built from mip 0 by blits after the upload
 } sb_texture_flags;
 
 typedef uint32_t sb_texture_id;
 
+// everything sb_create_sampler varies on, zero initialised fields give nearest filtering and repeat addressing
+typedef struct
+{
+	VkFilter filter;
+	VkSamplerMipmapMode mipmap_mode;
+	VkSamplerAddressMode address_mode;
+	VkBorderColor border_color;
+	VkBool32 is_base_level_only; // maxLod 0, sampling never leaves mip 0
+} sb_sampler_state;
+
 typedef struct
 {
 	sb_texture_type texture_type;
@@ -36,11 +48,13 @@ typedef struct
 	VkSampler sampler;
 	VkImage image;
 	VkExtent2D extent;
+	uint32_t mip_levels;
 	VkImageView view;
 	VkDeviceMemory memory;
 	VkDeviceSize offset;
 
 	bool is_window_relative;
+	bool is_pending; // pixels are still queued, the descriptor points at the fallback texture meanwhile
 } sb_texture;
 
 #endif
\ No newline at end of file
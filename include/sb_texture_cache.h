@@ -0,0 +1,24 @@
+#ifndef SB_TEXTURE_CACHE_H
+#define SB_TEXTURE_CACHE_H
+
+#include "sb_arena.h"
+#include "sb_file.h"
+#include "sb_texture_file.h"
+
+// decoded pngs and jpegs are kept as uncompressed .sbt files named after a hash of the encoded bytes (as stored, for
+// packed ones), so later runs map the texels instead of decoding them again and an edited source simply misses
+#define SB_TEXTURE_CACHE_DIRECTORY "texture_cache"
+#define SB_TEXTURE_CACHE_VERSION 1 // part of every key, bump it when the decoder's output changes
+
+// never 0, which transfers use for "don't write a cache entry"
+uint64_t sb_get_texture_cache_key(const void *encoded, uint64_t encoded_size);
+const char *sb_get_texture_cache_path(sb_arena *arena, uint64_t key);
+
+// mapped entry for the key, zeroed when there is none or it doesn't hold a complete width x height image
+sb_mapped_file sb_open_texture_cache(uint64_t key, uint32_t width, uint32_t height);
+void sb_write_texture_cache(uint64_t key, const uint8_t *rgba, uint32_t width, uint32_t height);
+
+static uint64_t get_cache_data_offset(void);
+static uint64_t get_cache_file_size(const char *path);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SB_TEXTURE_FILE_H
+#define SB_TEXTURE_FILE_H
+
+#include <stdint.h>
+
+// .sbt layout, written by tools/sbtex.c and the texture cache:
+// sb_texture_file_header | sb_texture_file_level levels[mip_count] | level data, largest level first
+// every level starts on SB_TEXTURE_FILE_ALIGNMENT so the levels can be staged with a single memcpy
+#define SB_TEXTURE_FILE_MAGIC 0x58544253 // "SBTX"
+#define SB_TEXTURE_FILE_VERSION 1
+#define SB_TEXTURE_FILE_ALIGNMENT 16
+#define SB_TEXTURE_FILE_MAX_LEVELS 16
+
+typedef enum
+{
+	SB_TEXTURE_FILE_FORMAT_BC1 = 1, // rgb, 8 bytes per 4x4 block
+	SB_TEXTURE_FILE_FORMAT_BC3 = 2, // rgba with interpolated alpha, 16 bytes per block
+	SB_TEXTURE_FILE_FORMAT_BC7 = 3, // rgba, 16 bytes per block
+	SB_TEXTURE_FILE_FORMAT_RGBA8 = 4, // uncompressed, only written by the texture cache
+} sb_texture_file_format;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t mip_count;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t pad[2];
+} sb_texture_file_header;
+
+typedef struct
+{
+	uint64_t offset; // from the start of the file
+	uint64_t size;
+} sb_texture_file_level;
+
+#define sb_texture_file_levels(header) ((const sb_texture_file_level*) ((const sb_texture_file_header*)(header) + 1))
+#define sb_texture_file_block_size(format) ((format) == SB_TEXTURE_FILE_FORMAT_BC1 ? 8U : 16U)
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SB_THREAD_H
+#define SB_THREAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SB_MAX_THREADS 64U // as many handles as WaitForMultipleObjects takes
+
+typedef void sb_thread_proc(void *data);
+
+uint32_t sb_get_processor_count(void);
+
+// calls proc on each of count elements of data, data_stride bytes apart, every call on its own thread.
+// the calling thread takes the first element and returns once all of them have
+void sb_run_threads(sb_thread_proc *proc, void *data, size_t data_stride, uint32_t count);
+
+// returns the value from before the add
+uint32_t sb_atomic_add(volatile uint32_t *value, uint32_t amount);
+
+#endif
@@ -1,24 +1,91 @@
 #ifndef SB_TRANSFER_BUFFER_H
 #define SB_TRANSFER_BUFFER_H
 
-#include <stdio.h>
-
 #include "sb_mesh.h"
 #include "sb_texture.h"
+#include "sb_file.h"
+#include "sb_pack.h"
+#include "sb_window.h"
+#include "sb_vulkan_initializers.h"
+
+// transfers are consumed highest priority first, in queue order within a priority
+typedef enum
+{
+	SB_ASSET_PRIORITY_LOW,
+	SB_ASSET_PRIORITY_NORMAL,
+	SB_ASSET_PRIORITY_HIGH,
+	SB_ASSET_PRIORITY_IMMEDIATE, // ignores the budget, for the fallbacks everything else resolves to
+} sb_asset_priority;
 
 typedef struct
 {
+	sb_mesh_id mesh_id;
+	sb_asset_priority priority;
 	uint32_t vertex_count;
 	uint32_t index_count;
-	FILE *mesh_file;
+	uint32_t index_size; // of the indices in the file, 2 or 4
+	uint32_t split_vertex_count; // vertex count once split into parts for 16 bit indices, 0 when it doesn't need splitting
+	uint32_t cluster_count;
+
+	sb_mapped_file mesh_file; // loose .sbm, unmapped once transferred
+	const sb_pack *pack; // otherwise the mesh is read out of the asset pack
+	const sb_pack_entry *pack_entry;
 } sb_mesh_transfer;
 
 typedef struct
 {
 	sb_texture_id texture_id;
-	char *pixels;
+	sb_asset_priority priority;
+
+	// png or jpeg, decoded when the transfer is picked up so decoding counts against the budget,
+	// or an .sbt (cooked or from the texture cache) whose levels are copied as they are
+	sb_mapped_file image_file;
+	const sb_pack *pack;
+	const sb_pack_entry *pack_entry;
+	const uint8_t *pixels; // already decoded rgba8, owned by the caller
+	bool is_texture_file; // the file is an .sbt
+	uint64_t cache_key; // nonzero writes the decoded texels to the texture cache under this key
+
+	uint32_t uploaded_levels; // copied from staging, levels past these are blitted down from the last one
+	bool is_host_copied; // written from the cpu, nothing for it gets recorded
+	bool is_gpu_decompressed; // copied from decompression_output on the graphics queue instead of from staging
 } sb_texture_transfer;
 
+// limits how much of the queue a single sb_transfer_assets call uploads,
+// at least one asset goes through per call so nothing larger than the budget stalls forever
+typedef struct
+{
+	VkDeviceSize bytes_per_frame; // staging bytes, 0 means unlimited
+	float ms_per_frame; // cpu time spent reading and decoding, 0 means unlimited
+} sb_transfer_budget;
+
+// compressed pack payloads are expanded by decompress.comp, one invocation per block. that covers meshes and
+// staged .sbt textures, pngs and jpegs are still decoded on the cpu and host copied textures need their texels there
+#define SB_MAX_DECOMPRESSION_BLOCKS 4096U
+#define SB_DECOMPRESSION_MEMORY_SIZE MB(32)
+
+typedef struct
+{
+	VkDeviceAddress src; // compressed block in decompression_input
+	VkDeviceAddress dst; // raw bytes in decompression_output, 4 byte aligned
+	uint32_t stored_size;
+	uint32_t raw_size;
+	uint32_t pad[2];
+} sb_decompression_block;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t pad[3];
+	sb_decompression_block blocks[SB_MAX_DECOMPRESSION_BLOCKS];
+} sb_decompression_blocks;
+
+typedef struct
+{
+	VkBufferCopy *regions;
+	uint32_t count;
+} sb_copy_regions;
+
 typedef struct
 {
 	VkQueue graphics_queue; // if there is not, we use the graphics queue, but if there is, we still use it for queue family ownership transfer
@@ -33,17 +100,32 @@ typedef struct
     VkCommandBuffer transfer_command_buffer;
 
 	VkFence transfer_fully_finished; // transfer is fully complete
+	bool is_in_flight; // submitted and not waited on yet, staging and the command buffers are still in use
 
     sb_device_arena staging_memory;
 
-	uint32_t vertices_to_transfer;
-	uint32_t indices_to_transfer;
+	// only ever touched by the graphics queue, compute can't run on a dedicated transfer queue
+	VkPipeline decompress_pipeline; // created by the app, VK_NULL_HANDLE falls back to cpu decompression
+	sb_buffer decompression_blocks; // sb_decompression_blocks
+	sb_device_arena decompression_staging;
+	sb_buffer decompression_input;
+	sb_device_arena decompression_output;
+
+	// set by the app when the device has VK_EXT_host_image_copy, textures created with
+	// VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT are then copied from the cpu without staging or a submit
+	sb_host_image_copy host_image_copy;
+
+	sb_transfer_budget budget;
 
     sb_mesh_transfer mesh_transfers[SB_MAX_MESHES];
     uint32_t mesh_transfer_count;
 
     sb_texture_transfer texture_transfers[SB_MAX_TEXTURES];
     uint32_t texture_transfer_count;
+
+	// textures whose pixels landed in the last sb_transfer_assets, their descriptors can drop the fallback
+	sb_texture_id arrived_textures[SB_MAX_TEXTURES];
+	uint32_t arrived_texture_count;
 } sb_transfer_buffer;
 
 sb_transfer_buffer sb_create_transfer_buffer(VkDevice device,
@@ -52,10 +134,44 @@ sb_transfer_buffer sb_create_transfer_buffer(VkDevice device,
 static VkBufferMemoryBarrier2 get_transfer_queue_release_barrier(sb_buffer *buffer, uint32_t transfer_index, uint32_t graphics_index);
 static VkBufferMemoryBarrier2 get_graphics_queue_acquire_barrier(sb_buffer *buffer, uint32_t transfer_index, uint32_t graphics_index);
 
-void queue_image_transition_barriers(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], sb_texture_transfer *transfers, uint32_t transfer_count, const VkImageMemoryBarrier2 *template_barrier);
-
-void sb_queue_mesh_transfer(sb_transfer_buffer *transfer_buffer, const char *file_path);
-sb_texture_transfer *sb_queue_texture_transfer(sb_transfer_buffer *transfer_buffer);
+static void push_copy_region(sb_copy_regions *copies, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size);
+static void copy_regions(VkCommandBuffer command_buffer, sb_buffer *src, sb_buffer *dst, const sb_copy_regions *copies);
+static bool is_gpu_decompressible(const sb_transfer_buffer *transfer_buffer, const sb_pack_entry *entry);
+static bool queue_gpu_decompression(sb_transfer_buffer *transfer_buffer, const sb_pack *pack, const sb_pack_entry *entry, VkDeviceSize *out_offset);
+static void record_gpu_decompression(VkCommandBuffer command_buffer, sb_transfer_buffer *transfer_buffer);
+
+void queue_image_transition_barriers(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], sb_texture_transfer *transfers, uint32_t transfer_count, bool is_gpu_decompressed, const VkImageMemoryBarrier2 *template_barrier);
+static void record_texture_copies(VkCommandBuffer command_buffer, sb_buffer *src, sb_texture textures[SB_MAX_TEXTURES], const sb_texture_transfer *transfers, uint32_t transfer_count, bool is_gpu_decompressed, const VkBufferImageCopy2 *image_copies);
+static VkImageMemoryBarrier2 get_mip_barrier(const sb_texture *texture, uint32_t base_level, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout);
+static VkOffset3D get_mip_size(VkExtent2D extent, uint32_t level);
+static void record_mip_generation(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], const sb_texture_transfer *transfers, uint32_t transfer_count);
+
+static sb_mesh_transfer *insert_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_asset_priority priority);
+static sb_texture_transfer *insert_texture_transfer(sb_transfer_buffer *transfer_buffer, sb_asset_priority priority);
+static bool is_split_mesh(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer);
+static bool can_copy_decompressed_mesh(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer);
+static uint32_t get_mesh_cluster_count(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer);
+static VkDeviceSize get_mesh_upload_size(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer);
+static VkDeviceSize get_mesh_staging_size(const sb_transfer_buffer *transfer_buffer, const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer);
+static void copy_indices(void *dst, uint32_t dst_index_size, const void *src, uint32_t src_index_size, uint32_t index_count);
+static uint32_t get_block_size(VkFormat format);
+static VkDeviceSize get_texture_staging_size(const sb_texture *texture);
+static bool fits_budget(const sb_transfer_buffer *transfer_buffer, sb_asset_priority priority, uint32_t assets_done, VkDeviceSize bytes_done, VkDeviceSize size, double start_ms);
+static VkBufferMemoryBarrier2 get_mesh_upload_barrier(sb_buffer *buffer);
+static bool is_head_immediate(const sb_transfer_buffer *transfer_buffer);
+static void reset_transfer_memory(VkDevice device, sb_transfer_buffer *transfer_buffer);
+static bool recycle_transfer(VkDevice device, sb_transfer_buffer *transfer_buffer, bool should_wait);
+
+void sb_queue_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_mesh_id mesh_id, const char *file_path, sb_asset_priority priority);
+void sb_queue_packed_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_mesh_id mesh_id, const sb_pack *pack, const sb_pack_entry *entry, sb_asset_priority priority);
+// copies whole levels from host memory into a texture created with host transfer usage and leaves it ready to sample,
+// needs no queue or command buffer so it's safe from any thread as long as nothing else touches the image
+void sb_host_copy_texture(VkDevice device, const sb_host_image_copy *host_image_copy, const sb_texture *texture, const void *const *level_pixels, uint32_t level_count);
+sb_texture_transfer *sb_queue_texture_transfer(sb_transfer_buffer *transfer_buffer, sb_texture_id texture_id, sb_asset_priority priority);
+// records and submits this frame's share of the queue without waiting for it, the draws submitted after it on the
+// graphics queue see the uploads through its barriers. a frame that finds the previous upload still running uploads
+// nothing unless the queue's head is immediate
 void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb_mesh_memory *meshes, sb_texture textures[SB_MAX_TEXTURES]);
+bool sb_is_streaming(const sb_transfer_buffer *transfer_buffer); // anything queued or still in flight
 
 #endif
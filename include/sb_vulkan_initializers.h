@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 #include "sb_vulkan_memory.h"
+#include "sb_texture.h"
 
 typedef struct
 {
@@ -40,7 +41,20 @@ VkPhysicalDevice sb_get_physical_device(VkInstance instance, VkSurfaceKHR surfac
 
 static VkDeviceQueueCreateInfo get_queue_create_info(uint32_t family_index);
 
-VkDevice sb_create_device(VkPhysicalDevice physical_device, uint32_t transfer_queue_index, uint32_t graphics_queue_index);
+// VK_EXT_host_image_copy is optional, when present images can be written straight from host memory
+typedef struct
+{
+	PFN_vkCopyMemoryToImageEXT copy_memory_to_image;
+	PFN_vkTransitionImageLayoutEXT transition_image_layout;
+} sb_host_image_copy;
+
+static bool supports_extension(VkPhysicalDevice physical_device, const char *extension_name);
+bool sb_supports_host_image_copy(VkPhysicalDevice physical_device);
+bool sb_supports_host_image_copy_format(VkPhysicalDevice physical_device, VkFormat format);
+sb_host_image_copy sb_load_host_image_copy(VkDevice device);
+bool sb_supports_bc_textures(VkPhysicalDevice physical_device); // optional too, cooked textures need it
+
+VkDevice sb_create_device(VkPhysicalDevice physical_device, uint32_t transfer_queue_index, uint32_t graphics_queue_index, bool enable_host_image_copy, bool enable_bc_textures);
 VkSwapchainKHR sb_create_swapchain(VkDevice device, VkSurfaceKHR surface, VkPhysicalDevice physical_device, VkSwapchainKHR old_swapchain,
 	VkFormat format, VkPresentModeKHR present_mode);
 VkImageMemoryBarrier2 sb_get_image_layout_transition_barrier(VkImageAspectFlags aspect_flags);
@@ -57,15 +71,22 @@ VkSemaphore sb_create_semaphore(VkDevice device);
 VkFence sb_create_fence(VkDevice device, bool should_create_signaled);
 
 VkShaderModule sb_create_shader_module(VkDevice device, const char *name);
+
+#define SB_PUSH_CONSTANT_SIZE 16U // compute only, for passes dispatched once per level or per phase with the same pipeline
 VkPipelineLayout sb_create_pipeline_layout(VkDevice device, VkDescriptorSetLayout set_layout);
 VkDescriptorSet sb_allocate_descriptor_set(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout);
 
 void sb_update_draw_info_buffer_descriptor(VkDevice device, VkDescriptorSet descriptor_set, sb_buffer *draw_info_buffer);
 VkDescriptorPool sb_create_descriptor_pool(VkDevice device);
 
-VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlags samples);
-VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag);
-VkSampler sb_create_sampler(VkDevice device, VkSamplerAddressMode address_mode,VkBorderColor border_color);
+VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlags samples, uint32_t mip_levels);
+VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag, uint32_t mip_levels);
+VkImageView sb_create_image_level_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag, uint32_t mip_level);
+uint32_t sb_get_mip_level_count(VkExtent2D extent);
+
+VkSampler sb_create_sampler(VkDevice device, const sb_sampler_state *state);
+
+VkQueryPool sb_create_timestamp_query_pool(VkDevice device, uint32_t query_count);
 
 void sb_wait_for_fence(VkDevice device, VkFence fence);
 void sb_reset_fence(VkDevice device, VkFence fence);
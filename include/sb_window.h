@@ -26,6 +26,7 @@ typedef enum
     SB_KEY_CODE_T = 'T',
     SB_KEY_CODE_I = 'I',
     SB_KEY_CODE_O = 'O',
+    SB_KEY_CODE_M = 'M',
     SB_KEY_CODE_COUNT,
 } sb_keycode;
 
@@ -58,6 +59,7 @@ typedef struct
 } sb_window;
 
 float sb_get_dt(sb_window *window);
+double sb_get_time_ms(void); // monotonic, for timing work within a frame
 float sb_get_aspect_ratio(sb_window *window);
 
 sb_window *sb_create_window(uint32_t width, uint32_t height, const char *name);
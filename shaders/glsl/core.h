@@ -15,21 +15,27 @@
 
 #define DRAW_INFO_BUFFER_BINDING (0U)
 #define TEXTURE_ARRAY_BINDING 1U
-#define DESCRIPTOR_BINDING_COUNT (TEXTURE_ARRAY_BINDING+1)U
+#define SAMPLER_ARRAY_BINDING 2U // indexed by texture id too, the slots point at a handful of shared samplers
+#define DEPTH_PYRAMID_BINDING 3U // a storage image per level, only while the pyramid is built
+#define DESCRIPTOR_BINDING_COUNT (DEPTH_PYRAMID_BINDING+1)U
 
+// mirrors sb_draw_info, get_draw_transform expands the transform
 struct draw_info_t
 {
-	mat4 transform;
+	vec3 position;
+	float scale;
+	uvec2 rotation; // a snorm16 quaternion, xy then zw
 
 	uint mesh_id;
-	uint texture_id;
-    float specularity;
+	uint material_id;
     uint shader_id;
-
-    uint color;
-    uint pad[3];
+    uint flags;
+    uint transform_id;
+    uint pad;
 };
 
+#define DRAW_FLAG_GENERAL_TRANSFORM 2U // SB_DRAW_FLAG_GENERAL_TRANSFORM
+
 layout (binding = DRAW_INFO_BUFFER_BINDING) readonly buffer DrawInfos
 {
     uint count;
@@ -42,7 +48,64 @@ layout (binding = DRAW_INFO_BUFFER_BINDING) readonly buffer DrawInfos
 	type name = type(_PTR_NAME(type,id));
 #define BUFFER_REFERENCE(type) layout(std430, buffer_reference, buffer_reference_align = 16) type;
 
-#define GET_TEXTURE_VAL(id, offset) texture(textures[id], offset)
-#define GET_TEXTURE_SIZE(id) textureSize(textures[id], 0)
+// the draw id of every culled instance, the vertex shaders index it with gl_InstanceIndex
+BUFFER_REFERENCE(buffer draw_instances_t
+{
+    uint draw_ids[];
+})
+
+// mirrors sb_material, only the gpass pixel shader reads these
+struct material_t
+{
+    uint texture_id;
+    float specularity;
+    uint color;
+    uint pad;
+};
+
+BUFFER_REFERENCE(readonly buffer materials_t
+{
+    material_t materials[];
+})
+
+// the cull pass's sb_draw_matrices arrays, indexed by draw id. only a kept draw's are current
+BUFFER_REFERENCE(readonly buffer clip_matrices_t
+{
+    mat4 clips[];
+})
+
+BUFFER_REFERENCE(readonly buffer normal_matrices_t
+{
+    mat3 normals[];
+})
+
+// sb_app's transform_buffer, the draws whose transform isn't a position, rotation and uniform scale
+BUFFER_REFERENCE(readonly buffer draw_transforms_t
+{
+    mat4 transforms[];
+})
+
+mat4 get_draw_transform(draw_info_t info, draw_transforms_t general_transforms)
+{
+    if((info.flags & DRAW_FLAG_GENERAL_TRANSFORM) != 0) return general_transforms.transforms[info.transform_id];
+
+    vec4 q = normalize(vec4(unpackSnorm2x16(info.rotation.x), unpackSnorm2x16(info.rotation.y)));
+    vec3 q2 = q.xyz * q.xyz;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    mat3 rotation = mat3(
+        1.0 - 2.0 * (q2.y + q2.z), 2.0 * (xy + wz), 2.0 * (xz - wy),
+        2.0 * (xy - wz), 1.0 - 2.0 * (q2.x + q2.z), 2.0 * (yz + wx),
+        2.0 * (xz + wy), 2.0 * (yz - wx), 1.0 - 2.0 * (q2.x + q2.y));
+
+    mat4 transform = mat4(rotation * info.scale);
+    transform[3] = vec4(info.position, 1.0);
+    return transform;
+}
+
+#define GET_SAMPLER2D(id) sampler2D(textures[id], samplers[id])
+#define GET_TEXTURE_VAL(id, offset) texture(GET_SAMPLER2D(id), offset)
+#define GET_TEXTURE_SIZE(id) textureSize(GET_SAMPLER2D(id), 0)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+#ifndef CULL_H
+#define CULL_H
+
+#extension GL_KHR_shader_subgroup_basic: require
+#extension GL_KHR_shader_subgroup_ballot: require
+#extension GL_KHR_shader_subgroup_arithmetic: require
+
+#include "core.h"
+#include "mesh.h"
+
+// shared by the cull, compact and scatter passes, every phase runs all three
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in; // SB_CULL_GROUP_SIZE
+
+#define MAX_DRAW_COUNT 65535U // SB_MAX_DRAW_COUNT
+#define MAX_MESHES 1024U // SB_MAX_MESHES
+#define MAX_CULL_VIEWS 4U // SB_MAX_CULL_VIEWS
+#define MAX_SHADER_BINS 4U // SB_MAX_SHADER_BINS
+#define SHADER_BIN_COMMAND_COUNT (MAX_DRAW_COUNT / MAX_SHADER_BINS) // SB_SHADER_BIN_COMMAND_COUNT
+
+// sb_cull_list
+#define CULL_LIST_EARLY 0U
+#define CULL_LIST_LATE 1U
+#define CULL_LIST_VIEWS 2U
+#define MAX_CULL_LISTS (CULL_LIST_VIEWS + MAX_CULL_VIEWS)
+
+#define NO_SLOT 0xFFFFFFFFU
+
+// draws are grouped by shader id, mesh and lod, see get_draw_key
+#define MAX_DRAW_KEYS (MAX_SHADER_BINS * MAX_MESHES * MAX_MESH_LODS)
+
+// past this many instance and cluster pairs a draw key keeps its one instanced command, each cluster needs room in
+// its list's instances for every instance of the key
+#define MAX_MESH_CLUSTER_INSTANCES 1024U
+
+struct draw_command_t
+{
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+// mirrors sb_indirect_command_array, every shader id appends to its own range
+BUFFER_REFERENCE(buffer indirect_commands_t
+{
+    uint counts[MAX_SHADER_BINS];
+    draw_command_t draws[MAX_SHADER_BINS][SHADER_BIN_COMMAND_COUNT];
+})
+
+struct frustum_t
+{
+    vec4 planes[6];
+};
+
+// mirrors sb_cull_view
+struct cull_view_t
+{
+    mat4 view_projection;
+    frustum_t frustum;
+    uint required_draw_flags;
+    uint pad[3];
+};
+
+// mirrors sb_cull_ubo
+BUFFER_REFERENCE(readonly buffer cull_ubo_t
+{
+    mat4 camera_view_projection;
+    mat4 camera_view;
+    frustum_t camera_frustum;
+    indirect_commands_t draw_commands[MAX_CULL_LISTS];
+
+    vec3 camera_position;
+    uint view_count;
+    cull_view_t views[MAX_CULL_VIEWS];
+})
+
+BUFFER_REFERENCE(buffer draw_visibility_t
+{
+    uint visible[];
+})
+
+// mirrors sb_draw_matrices
+BUFFER_REFERENCE(writeonly buffer draw_matrices_t
+{
+    mat4 camera_clips[MAX_DRAW_COUNT];
+    mat3 camera_normals[MAX_DRAW_COUNT];
+    mat4 view_clips[MAX_CULL_VIEWS][MAX_DRAW_COUNT];
+})
+
+// mirrors sb_cull_stats
+BUFFER_REFERENCE(buffer cull_stats_t
+{
+    uint draw_count;
+    uint frustum_rejected_count;
+    uint occlusion_rejected_count;
+    uint pad;
+})
+
+// mirrors sb_cull_scratch
+BUFFER_REFERENCE(buffer cull_scratch_t
+{
+    uint instance_counts[MAX_CULL_LISTS];
+    uint mesh_instance_counts[MAX_CULL_LISTS][MAX_DRAW_KEYS];
+    uint mesh_first_instances[MAX_CULL_LISTS][MAX_DRAW_KEYS];
+    uint draw_slots[MAX_CULL_LISTS][MAX_DRAW_COUNT];
+    uint draw_lods[MAX_DRAW_COUNT]; // the same for every list, picked from the camera
+})
+
+SPEC_CONSTANT_BDA(0, mesh_ssbo_t, mesh_ssbo)
+SPEC_CONSTANT_BDA(1, cull_ubo_t, cull_ubo)
+SPEC_CONSTANT_BDA(2, draw_visibility_t, draw_visibility)
+SPEC_CONSTANT_BDA(3, cull_stats_t, cull_stats)
+SPEC_CONSTANT_BDA(4, cull_scratch_t, cull_scratch)
+SPEC_CONSTANT_BDA(5, draw_instances_t, draw_instances)
+SPEC_CONSTANT_BDA(6, mesh_clusters_t, mesh_clusters)
+SPEC_CONSTANT_BDA(7, draw_matrices_t, draw_matrices)
+SPEC_CONSTANT_BDA(8, draw_transforms_t, draw_transforms)
+
+// sb_cull_phase
+#define CULL_PHASE_VIEWS 0U
+#define CULL_PHASE_EARLY 1U
+#define CULL_PHASE_LATE 2U
+
+layout(push_constant) uniform cull_constants_t
+{
+    uint phase;
+    uint depth_pyramid;
+    uvec2 depth_extent;
+} cull_constants;
+
+// the box is outside when it's entirely behind one plane, the radius is the box's extent projected onto the normal
+bool is_box_in_frustum(frustum_t frustum, vec3 center, vec3 extent)
+{
+    for(int i = 0; i < 6; i++)
+    {
+        vec4 plane = frustum.planes[i];
+        if(dot(plane.xyz, center) + plane.w < -dot(abs(plane.xyz), extent)) return false;
+    }
+    return true;
+}
+
+// the same for every lane, so loops over the lists keep the whole subgroup together
+void get_phase_lists(out uint first_list, out uint list_count)
+{
+    first_list = cull_constants.phase == CULL_PHASE_VIEWS ? CULL_LIST_VIEWS : cull_constants.phase == CULL_PHASE_EARLY ? CULL_LIST_EARLY : CULL_LIST_LATE;
+    list_count = cull_constants.phase == CULL_PHASE_VIEWS ? cull_ubo.view_count : 1;
+}
+
+// the key's shader id comes first, so a group of consecutive keys always shares one
+uint get_draw_key(uint shader_id, uint mesh_id, uint lod)
+{
+    return (shader_id * MAX_MESHES + mesh_id) * MAX_MESH_LODS + lod;
+}
+
+// every list owns MAX_DRAW_COUNT instances of draw_instances
+uint get_list_first_instance(uint list)
+{
+    return list * MAX_DRAW_COUNT;
+}
+
+// only lod 0 has clusters, the coarser lods are for draws too far away for culling their clusters to pay off
+bool has_cluster_commands(mesh_t m, uint lod, uint instance_count)
+{
+    return lod == 0 && m.cluster_count > 0 && instance_count * m.cluster_count <= MAX_MESH_CLUSTER_INSTANCES;
+}
+
+#endif
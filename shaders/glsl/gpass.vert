@@ -8,31 +8,46 @@
 #include "camera.h"
 #include "wave.h"
 #include "shader_ids.h"
+#include "mesh.h"
 
 SPEC_CONSTANT_BDA(0, time_ubo_t, time_ubo)
 SPEC_CONSTANT_BDA(1, camera_ubo_t, scene_camera)
+SPEC_CONSTANT_BDA(2, mesh_ssbo_t, mesh_ssbo)
+SPEC_CONSTANT_BDA(3, draw_instances_t, draw_instances)
+SPEC_CONSTANT_BDA(4, clip_matrices_t, camera_clips)
+SPEC_CONSTANT_BDA(5, normal_matrices_t, camera_normals)
+SPEC_CONSTANT_BDA(6, draw_transforms_t, draw_transforms)
+SPEC_CONSTANT_SHADER_ID
 
-layout (location = 0) in vec3 v_position;
-layout (location = 1) in vec3 v_normal;
+layout (location = 0) in vec4 v_position;
+layout (location = 1) in vec2 v_normal;
 layout (location = 2) in vec2 v_uv;
 
 layout (location = 0) out vec3 out_normal;
 layout (location = 1) out vec2 out_uv;
-layout (location = 2) out flat uint draw_id;
+layout (location = 2) out flat uint material_id;
 
 const int repeat_count = 3;
 
 void main()
 {
-    draw_info_t info = draw_infos.draws[gl_InstanceIndex];
+    uint instance_draw_id = draw_instances.draw_ids[gl_InstanceIndex];
+    draw_info_t info = draw_infos.draws[instance_draw_id];
 
-    vec4 world_position = info.transform * vec4(v_position, 1.0);
-    vec3 normal = v_normal;
+    mesh_t mesh = mesh_ssbo.meshes[info.mesh_id];
+
+    // the cull pass built the draw's clip and normal matrices, only the materials that need the world position pay for it
+    vec4 position = vec4(unpack_position(mesh, v_position), 1.0);
+    vec4 world_position;
+    vec3 normal = unpack_normal(v_normal);
     vec2 uv = v_uv;
-    // branching on constants like this is free on modern gpus, the main concern is register pressure
-    switch(info.shader_id)
+    gl_Position = camera_clips.clips[instance_draw_id] * position;
+
+    // every draw in the bin has this shader id, the other cases are gone before the pipeline is built
+    switch(shader_id)
     {
         case WATER_SHADER:
+            world_position = get_draw_transform(info, draw_transforms) * position;
 			wave_result_t result = get_wave_data(world_position, time_ubo.time);
 
             vec3 binormal  = vec3(1, result.dydx, 0);
@@ -40,18 +55,17 @@ void main()
 
             normal = normalize(cross(tangent,binormal));
 
+            // the waves move the vertex after the transform, past what the clip matrix can hold
             world_position.y = result.y;
+            gl_Position = scene_camera.projection * (scene_camera.view * world_position);
             break;
         case ICE_SHADER:
+            world_position = get_draw_transform(info, draw_transforms) * position;
             uv = vec2( world_position.x / repeat_count, world_position.z / repeat_count);
             break;
     }   
 
-    vec4 view_pos = scene_camera.view * world_position;
-
-    gl_Position = scene_camera.projection * view_pos;
-
     out_uv = uv;
-    out_normal = transpose(inverse(mat3(scene_camera.view * info.transform))) * normal;
-    draw_id = gl_InstanceIndex;
+    out_normal = camera_normals.normals[instance_draw_id] * normal;
+    material_id = info.material_id;
 } 
\ No newline at end of file
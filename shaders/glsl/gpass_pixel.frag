@@ -4,11 +4,14 @@
 
 #include "core.h"
 
-layout (binding = TEXTURE_ARRAY_BINDING) uniform sampler2D textures[1024];
+layout (binding = TEXTURE_ARRAY_BINDING) uniform texture2D textures[1024];
+layout (binding = SAMPLER_ARRAY_BINDING) uniform sampler samplers[1024];
+
+SPEC_CONSTANT_BDA(0, materials_t, material_table) // material_buffer, the draw's material id picks the frame's half
 
 layout (location = 0) in vec3 normal;
 layout (location = 1) in vec2 uv;
-layout (location = 2) in flat uint draw_id;
+layout (location = 2) in flat uint material_id;
 
 layout (location = 0) out vec3 out_normal;
 layout (location = 1) out vec4 out_albedoRGB_specularA;
@@ -17,13 +20,13 @@ void main()
 {
     out_normal = normal;
 
-    draw_info_t draw_info = draw_infos.draws[draw_id];
+    material_t material = material_table.materials[material_id];
 
-    vec4 color = vec4((draw_info.color >> 16 & 255)/255.0f, (draw_info.color >> 8 & 255)/255.0f, (draw_info.color & 255)/255.0f, 1.0);
+    vec4 color = vec4((material.color >> 16 & 255)/255.0f, (material.color >> 8 & 255)/255.0f, (material.color & 255)/255.0f, 1.0);
 
-    if(draw_info.texture_id != 0)
-        color *= texture(textures[draw_info.texture_id], uv);
+    if(material.texture_id != 0)
+        color *= GET_TEXTURE_VAL(material.texture_id, uv);
 
     //TODO: add specular mapping from texture
-    out_albedoRGB_specularA = vec4(color.rgb, draw_info.specularity/2048.0);
+    out_albedoRGB_specularA = vec4(color.rgb, material.specularity/2048.0);
 }
\ No newline at end of file
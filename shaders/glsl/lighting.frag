@@ -23,7 +23,8 @@ BUFFER_REFERENCE(readonly buffer lighting_ubo_t
 SPEC_CONSTANT_BDA(0, lighting_ubo_t, lighting_ubo)
 SPEC_CONSTANT_BDA(1, camera_ubo_t, camera_ubo)
 
-layout (binding = TEXTURE_ARRAY_BINDING) uniform sampler2D textures[1024];
+layout (binding = TEXTURE_ARRAY_BINDING) uniform texture2D textures[1024];
+layout (binding = SAMPLER_ARRAY_BINDING) uniform sampler samplers[1024];
 
 layout (location = 0) in vec2 screen_coords;
 layout (location = 0) out vec4 out_color;
@@ -0,0 +1,69 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "core.h"
+
+#define MAX_MESH_LODS 4U // SB_MAX_MESH_LODS
+
+// mirrors sb_mesh_lod
+struct mesh_lod_t
+{
+	uint first_index;
+	uint index_count;
+};
+
+// mirrors sb_mesh_handle
+struct mesh_t
+{
+	int vertex_offset;
+	uint vertex_count;
+	uint lod_count;
+	uint cluster_count;
+
+	vec3 position_offset;
+	uint first_cluster;
+	vec3 position_scale;
+	uint next_part;
+
+	mesh_lod_t lods[MAX_MESH_LODS];
+	float lod_errors[MAX_MESH_LODS];
+};
+
+BUFFER_REFERENCE(readonly buffer mesh_ssbo_t
+{
+    mesh_t[] meshes;
+})
+
+// mirrors sb_mesh_cluster
+struct mesh_cluster_t
+{
+	vec3 center;
+	float radius;
+	vec3 cone_axis;
+	float cone_cutoff;
+	uint first_index;
+	uint index_count;
+	uint pad[2];
+};
+
+BUFFER_REFERENCE(readonly buffer mesh_clusters_t
+{
+    mesh_cluster_t[] clusters;
+})
+
+// vertices arrive as sb_packed_vertex, positions as unorm across the mesh bounds and normals octahedral encoded
+vec3 unpack_position(mesh_t mesh, vec4 packed_position)
+{
+    return mesh.position_offset + packed_position.xyz * mesh.position_scale;
+}
+
+vec3 unpack_normal(vec2 octahedral)
+{
+    vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+#endif
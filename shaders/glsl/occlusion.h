@@ -0,0 +1,52 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "cull.h"
+
+// the depth pyramid test shared by the cull and cluster passes, only the late list is ever tested against it
+
+layout (binding = TEXTURE_ARRAY_BINDING) uniform texture2D textures[1024];
+layout (binding = SAMPLER_ARRAY_BINDING) uniform sampler samplers[1024];
+
+// the nearest depth of the box against the farthest depth the pyramid holds under its screen rectangle
+bool is_box_occluded(vec3 center, vec3 extent)
+{
+    vec2 min_ndc = vec2(1.0);
+    vec2 max_ndc = vec2(-1.0);
+    float min_depth = 1.0;
+    for(int i = 0; i < 8; i++)
+    {
+        vec3 corner = center + extent * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = cull_ubo.camera_view_projection * vec4(corner, 1.0);
+
+        // a corner in front of the near plane doesn't project, the box is kept
+        if(clip.w <= 0.0 || clip.z < 0.0) return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        min_ndc = min(min_ndc, ndc.xy);
+        max_ndc = max(max_ndc, ndc.xy);
+        min_depth = min(min_depth, ndc.z);
+    }
+
+    vec2 depth_size = vec2(cull_constants.depth_extent);
+    ivec2 min_pixel = ivec2(clamp((min_ndc * 0.5 + 0.5) * depth_size, vec2(0.0), depth_size - 1.0));
+    ivec2 max_pixel = ivec2(clamp((max_ndc * 0.5 + 0.5) * depth_size, vec2(0.0), depth_size - 1.0));
+
+    // a level k texel covers 2^(k+1) pixels, the first level covering the rectangle's span touches at most 2x2 texels
+    int span = max(max_pixel.x - min_pixel.x, max_pixel.y - min_pixel.y) + 1;
+    int level = span <= 2 ? 0 : findMSB(span - 1);
+    level = min(level, textureQueryLevels(GET_SAMPLER2D(cull_constants.depth_pyramid)) - 1);
+
+    // pixels past the last texel of a level were folded into it when it was built
+    ivec2 last_texel = textureSize(GET_SAMPLER2D(cull_constants.depth_pyramid), level) - 1;
+    ivec2 min_texel = min(min_pixel >> (level + 1), last_texel);
+    ivec2 max_texel = min(max_pixel >> (level + 1), last_texel);
+
+    float occluder_depth = 0.0;
+    for(int y = min_texel.y; y <= max_texel.y; y++)
+        for(int x = min_texel.x; x <= max_texel.x; x++)
+            occluder_depth = max(occluder_depth, texelFetch(GET_SAMPLER2D(cull_constants.depth_pyramid), ivec2(x, y), level).r);
+    return min_depth > occluder_depth;
+}
+
+#endif
@@ -1,2 +1,8 @@
+// sb_draw_info.shader_id, every id is culled into its own bin of commands. under MAX_SHADER_BINS
+#define DEFAULT_SHADER 0U
 #define WATER_SHADER 1U
-#define ICE_SHADER 2U
\ No newline at end of file
+#define ICE_SHADER 2U
+
+// SB_SHADER_ID_CONSTANT_ID, the vertex shaders are specialised per bin and only keep their own case
+#define SHADER_ID_CONSTANT_ID 16
+#define SPEC_CONSTANT_SHADER_ID layout(constant_id = SHADER_ID_CONSTANT_ID) const uint shader_id = DEFAULT_SHADER;
\ No newline at end of file
@@ -8,28 +8,38 @@
 #include "shader_ids.h"
 #include "wave.h"
 #include "camera.h"
+#include "mesh.h"
 
 SPEC_CONSTANT_BDA(0, camera_ubo_t, shadow_camera)
 SPEC_CONSTANT_BDA(1, time_ubo_t, time_ubo)
-
-layout (location = 0) in vec3 v_position;
-layout (location = 1) in vec3 v_normal;
+SPEC_CONSTANT_BDA(2, mesh_ssbo_t, mesh_ssbo)
+SPEC_CONSTANT_BDA(3, draw_instances_t, draw_instances)
+SPEC_CONSTANT_BDA(4, clip_matrices_t, view_clips) // the shadow view's
+SPEC_CONSTANT_BDA(5, draw_transforms_t, draw_transforms)
+SPEC_CONSTANT_SHADER_ID
+
+layout (location = 0) in vec4 v_position;
+layout (location = 1) in vec2 v_normal;
 layout (location = 2) in vec2 v_tex_coord;
 
 void main()
 {
-    draw_info_t info = draw_infos.draws[gl_InstanceIndex];
+    uint draw_id = draw_instances.draw_ids[gl_InstanceIndex];
+    draw_info_t info = draw_infos.draws[draw_id];
+
+    mesh_t mesh = mesh_ssbo.meshes[info.mesh_id];
 
-    vec4 world_position = info.transform * vec4(v_position, 1.0);
+    vec4 position = vec4(unpack_position(mesh, v_position), 1.0);
+    gl_Position = view_clips.clips[draw_id] * position;
 
     // we need to run the water shader in the shadow map as well to get accurate shadows.
     // this isnt ideal, but it works reasonably well for now
-    switch(info.shader_id)
+    switch(shader_id)
     {
         case WATER_SHADER:
+            vec4 world_position = get_draw_transform(info, draw_transforms) * position;
             world_position.y = get_wave_data(world_position, time_ubo.time).y;
+            gl_Position = shadow_camera.projection * shadow_camera.view * world_position;
             break;
     }
-
-    gl_Position = shadow_camera.projection * shadow_camera.view * world_position;
 }
\ No newline at end of file
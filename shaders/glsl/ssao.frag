@@ -21,7 +21,8 @@ BUFFER_REFERENCE(readonly buffer ssao_ubo_t
 SPEC_CONSTANT_BDA(0, ssao_ubo_t, ssao_ubo)
 SPEC_CONSTANT_BDA(1, camera_ubo_t, camera_ubo)
 
-layout (binding = TEXTURE_ARRAY_BINDING) uniform sampler2D textures[1024];
+layout (binding = TEXTURE_ARRAY_BINDING) uniform texture2D textures[1024];
+layout (binding = SAMPLER_ARRAY_BINDING) uniform sampler samplers[1024];
 
 layout (location = 0) in vec2 frag_uv;
 layout (location = 0) out float out_visiblity_factor;
@@ -11,7 +11,8 @@ BUFFER_REFERENCE(readonly buffer texture_ids_t
 
 SPEC_CONSTANT_BDA(0, texture_ids_t, texture_ids)
 
-layout (binding = TEXTURE_ARRAY_BINDING) uniform sampler2D textures[1024];
+layout (binding = TEXTURE_ARRAY_BINDING) uniform texture2D textures[1024];
+layout (binding = SAMPLER_ARRAY_BINDING) uniform sampler samplers[1024];
 
 layout (location = 0) in vec2 frag_uv;
 layout (location = 0) out float out_visibility_factor;
@@ -1,5 +1,6 @@
 #define WAVE_COUNT 32
 #define INCREMENT 0.1176f
+#define WAVE_MAX_HEIGHT 1.28f // the noise is 0 to 1, so y tops out at the sum of the amplitudes past start_wave
 
 float hash(float n) { return fract(sin(n) * 1e4); }
 
@@ -9,6 +9,17 @@
 #include <time.h>
 #include <math.h>
 
+// mirrors shaders/glsl/shader_ids.h, each one is drawn with its own gpass and shadow pipeline
+typedef enum
+{
+    SHADER_ID_DEFAULT,
+    SHADER_ID_WATER,
+    SHADER_ID_ICE,
+    SHADER_ID_COUNT,
+} shader_id_t;
+
+_Static_assert(SHADER_ID_COUNT <= SB_MAX_SHADER_BINS, "every shader id needs its own bin");
+
 typedef enum
 {
     DOOR_COLOR_PURPLE,
@@ -342,7 +353,8 @@ typedef struct
     sb_arena *arena;
 
     sb_arena_temp reset_point;
-    sb_str8 level_text;
+    sb_mapped_file level_file;
+    sb_str8 level_text; // view into level_file
 
     uint8_t level_number;
     level_t *level;
@@ -410,7 +422,9 @@ assets_t load_assets(sb_app *app)
 {
     assets_t assets = {0};
 
-    assets.cube_mesh = sb_create_mesh(app, "assets/meshes/cube.sbm");
+    // everything else draws as a cube until it has streamed in
+    assets.cube_mesh = sb_create_mesh_prioritized(app, "assets/meshes/cube.sbm", SB_ASSET_PRIORITY_IMMEDIATE);
+    sb_set_fallback_mesh(app, assets.cube_mesh);
     assets.water_mesh = sb_create_mesh(app, "assets/meshes/water.sbm");
     assets.player_mesh = sb_create_mesh(app, "assets/meshes/box.sbm");
     assets.key_mesh = sb_create_mesh(app, "assets/meshes/key.sbm");
@@ -429,28 +443,39 @@ assets_t load_assets(sb_app *app)
     assets.player_texture = sb_texture_from_file(app, "assets/textures/rock.jpeg");
     assets.door_texture = sb_texture_from_file(app, "assets/textures/door.jpg");
 
+    #ifdef _DEBUG
+    sb_asset_cache_print_stats("meshes", &app->mesh_cache);
+    sb_asset_cache_print_stats("textures", &app->texture_cache);
+    #endif
+
     return assets;
 }
 
 void draw_ice(sb_app *app, assets_t *assets, sb_vec3 position)
 {
     sb_draw_info draw_info = {0};
-    draw_info.color = sb_color3_as_u32(SB_WHITE);
-    draw_info.specularity = 10000;
-    draw_info.texture_id = assets->ice_texture;
+    draw_info.flags = SB_DRAW_FLAG_CASTS_SHADOW;
     draw_info.mesh_id = assets->cube_mesh;
-    sb_mat4_from_position(draw_info.transform, position);
-    sb_draw(app, &draw_info);
+    sb_set_draw_trs(&draw_info, position, (sb_vec4) {0, 0, 0, 1}, 1.0f);
+
+    sb_material material = {0};
+    material.color = sb_color3_as_u32(SB_WHITE);
+    material.specularity = 10000;
+    material.texture_id = assets->ice_texture;
+    sb_draw(app, &draw_info, &material);
 }
 
 void draw_metal(sb_app *app, assets_t *assets, sb_vec3 position)
 {
     sb_draw_info metal_info = {0};
-    sb_mat4_from_position(metal_info.transform, position);
-    metal_info.color = sb_color3_as_u32(SB_WHITE);
+    sb_set_draw_trs(&metal_info, position, (sb_vec4) {0, 0, 0, 1}, 1.0f);
+    metal_info.flags = SB_DRAW_FLAG_CASTS_SHADOW;
     metal_info.mesh_id = assets->cube_mesh;
-    metal_info.texture_id = assets->metal_texture;
-    sb_draw(app, &metal_info);
+
+    sb_material metal = {0};
+    metal.color = sb_color3_as_u32(SB_WHITE);
+    metal.texture_id = assets->metal_texture;
+    sb_draw(app, &metal_info, &metal);
 }
 
 void draw_level(sb_app *app, const assets_t *assets, level_t *level)
@@ -463,105 +488,113 @@ void draw_level(sb_app *app, const assets_t *assets, level_t *level)
         {
             sb_vec3 elevation = tile_is_elevated(tile->tile_type) ? VEC3_ELEVATION : (sb_vec3) {0};
             sb_draw_info draw_info = {0};
-            draw_info.color = sb_color3_as_u32(SB_WHITE);
-            sb_mat4_from_position(draw_info.transform, (sb_vec3) {pos.x * 2, elevation.y, pos.y * 2});
+            sb_material material = {0};
+            sb_mat4 transform;
+            material.color = sb_color3_as_u32(SB_WHITE);
+            draw_info.flags = SB_DRAW_FLAG_CASTS_SHADOW;
+            sb_mat4_from_position(transform, (sb_vec3) {pos.x * 2, elevation.y, pos.y * 2});
 
             draw_info.mesh_id = assets->cube_mesh;
 
             switch(tile->tile_type)
             {   
                 case TILE_TYPE_BUTTON:
-                    draw_info.color = sb_color3_as_u32(button_color_as_color3(tile->u8));
+                    material.color = sb_color3_as_u32(button_color_as_color3(tile->u8));
                     draw_info.mesh_id = assets->button_mesh;
 
                     draw_metal(app, assets, world_position);
                     break;
                 case TILE_TYPE_TELEPORT:
                     draw_info.mesh_id = assets->teleport_pad_mesh;
-                    draw_info.specularity = 2048.0f;
-                    draw_info.texture_id = assets->teleport_texture;
+                    material.specularity = 2048.0f;
+                    material.texture_id = assets->teleport_texture;
 
                     sb_color3 start = teleport_color_as_color3(tile->u8);
                     sb_color3 goal = SB_WHITE;
 
                     sb_color3 color = sb_color3_lerp(start, goal, tile->f32);
 
-                    draw_info.color = sb_color3_as_u32(color);
+                    material.color = sb_color3_as_u32(color);
 
                     draw_metal(app, assets, world_position);
                     break;
                 case TILE_TYPE_PILLAR:
-                    draw_info.color = sb_color3_as_u32(button_color_as_color3(tile->u8));
-                    draw_info.texture_id = assets->pillar_texture;
-                    sb_mat4_translate(draw_info.transform, (sb_vec3) { 0, tile->f32, 0 });
+                    material.color = sb_color3_as_u32(button_color_as_color3(tile->u8));
+                    material.texture_id = assets->pillar_texture;
+                    sb_mat4_translate(transform, (sb_vec3) { 0, tile->f32, 0 });
                     draw_info.mesh_id = assets->pillar_mesh;
 
                     draw_metal(app, assets, world_position);
                     break;
                 case TILE_TYPE_BEGIN:
-                    draw_info.color = sb_color3_as_u32((sb_color3) {0,153,16});
+                    material.color = sb_color3_as_u32((sb_color3) {0,153,16});
                     break;
                 case TILE_TYPE_END:
-                    draw_info.color = sb_color3_as_u32((sb_color3){128,27,27});
+                    material.color = sb_color3_as_u32((sb_color3){128,27,27});
                     break;
                 case TILE_TYPE_WALL:
-                    draw_info.color = sb_color3_as_u32(SB_LIGHT_BLUE);
-                    draw_info.texture_id = assets->rock_texture;
+                    material.color = sb_color3_as_u32(SB_LIGHT_BLUE);
+                    material.texture_id = assets->rock_texture;
                     draw_ice(app, assets, world_position);
                     break;
                 case TILE_TYPE_WATER:
-                    draw_info.color = sb_color3_as_u32((sb_color3) {1,16,104});
-                    draw_info.shader_id = 1;
-                    draw_info.specularity = 1000.0f;
+                    material.color = sb_color3_as_u32((sb_color3) {1,16,104});
+                    draw_info.shader_id = SHADER_ID_WATER;
+                    material.specularity = 1000.0f;
                     draw_info.mesh_id = assets->water_mesh;
                     break;
                 case TILE_TYPE_ICE:
-                    draw_info.specularity = 2048.0f;
-                    draw_info.shader_id = 2;
+                    material.specularity = 2048.0f;
+                    draw_info.shader_id = SHADER_ID_ICE;
                     draw_info.mesh_id = tile_neighbors_water(level, pos) ? assets->cube_mesh : assets->plane_mesh;
-                    draw_info.texture_id = assets->ice_texture;
+                    // nothing is below the flat floor for it to shadow
+                    if(draw_info.mesh_id == assets->plane_mesh) draw_info.flags = 0;
+                    material.texture_id = assets->ice_texture;
                     break;
                 case TILE_TYPE_DOOR:
-                    draw_info.specularity = 50.0f;
-                    draw_info.color = sb_color3_as_u32(door_color_as_color3(tile->u8));
-                    draw_info.texture_id = assets->door_texture;
+                    material.specularity = 50.0f;
+                    material.color = sb_color3_as_u32(door_color_as_color3(tile->u8));
+                    material.texture_id = assets->door_texture;
                     draw_ice(app, assets, world_position);
                     break;
             }
 
             if(tile->tile_type != TILE_TYPE_NONE)
-                sb_draw(app, &draw_info);
+                sb_draw_transformed(app, &draw_info, &material, transform);
         }
 
         {
             sb_draw_info draw_info = {0};
+            sb_material material = {0};
+            sb_mat4 transform;
+            draw_info.flags = SB_DRAW_FLAG_CASTS_SHADOW;
 
             switch(tile->pickup_type)
             {
                 case PICKUP_TYPE_BOULDER:
-                    sb_mat4_copy(tile->transform, draw_info.transform);
-                    draw_info.color = sb_color3_as_u32(SB_BROWN);
+                    sb_mat4_copy(tile->transform, transform);
+                    material.color = sb_color3_as_u32(SB_BROWN);
                     draw_info.mesh_id = assets->boulder_mesh;
-                    draw_info.texture_id = assets->crate_texture;
-                    sb_draw(app, &draw_info);
+                    material.texture_id = assets->crate_texture;
+                    sb_draw_transformed(app, &draw_info, &material, transform);
                     break;
                 case PICKUP_TYPE_PLAYER:
-                    sb_mat4_copy(tile->transform, draw_info.transform);
-                    draw_info.color = sb_color3_as_u32(SB_WHITE);
+                    sb_mat4_copy(tile->transform, transform);
+                    material.color = sb_color3_as_u32(SB_WHITE);
                     draw_info.mesh_id  = assets->cube_mesh;
-                    draw_info.texture_id = assets->player_texture;
-                    sb_draw(app, &draw_info);
+                    material.texture_id = assets->player_texture;
+                    sb_draw_transformed(app, &draw_info, &material, transform);
                     break;
                 case PICKUP_TYPE_KEY:
-                    sb_mat4_from_angles(draw_info.transform, (sb_vec3) {0, tile->f32, 0});
+                    sb_mat4_from_angles(transform, (sb_vec3) {0, tile->f32, 0});
 
                     sb_vec3 translate = sb_vec3_add(world_position, VEC3_ELEVATION);
-                    sb_mat4_translate(draw_info.transform, translate);
+                    sb_mat4_translate(transform, translate);
 
-                    draw_info.color = sb_color3_as_u32(door_color_as_color3(tile->u8));
+                    material.color = sb_color3_as_u32(door_color_as_color3(tile->u8));
                     draw_info.mesh_id  = assets->key_mesh;
-                    draw_info.specularity = 2048.0f;
-                    sb_draw(app, &draw_info);
+                    material.specularity = 2048.0f;
+                    sb_draw_transformed(app, &draw_info, &material, transform);
                  break;
             }
         }
@@ -578,6 +611,7 @@ level_t *get_level(sb_arena *arena, sb_str8 level_text)
         for(int i = 0; i < level_text.size; i++)
         {
             char c = level_text.str[i];
+            if(c == '\r') continue; // the mapped file isnt newline translated like a text mode read
             if(c == '\n')
             {
                 if(row_width > width) width = row_width;
@@ -606,6 +640,7 @@ level_t *get_level(sb_arena *arena, sb_str8 level_text)
     for(int i = 0; i < level_text.size; i++)
     {
         char c = level_text.str[i];
+        if(c == '\r') continue;
 
         tile_t *tile = &level->tiles[y*width + x];
         sb_ivec2 pos ={x,y};
@@ -756,16 +791,16 @@ sb_ivec2 get_move_direction(sb_keycode key_code)
     }
 }
 
-sb_str8 get_level_text(sb_arena *arena, uint8_t number)
+sb_mapped_file map_level_file(uint8_t number)
 {
-    sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+    sb_arena_temp scratch = sb_get_scratch();
     sb_str8 number_string = sb_u8_to_str8(scratch.arena, number);
     sb_str8 directory = sb_str8_concat(scratch.arena, sb_str8_lit("assets/levels/"), number_string);
     sb_str8 save_file_name = sb_str8_concat(scratch.arena, directory, sb_str8_lit(".txt"));
 
-    sb_str8 text = sb_read_file_string(arena, save_file_name.str);
+    sb_mapped_file file = sb_map_file(save_file_name.str, SB_FILE_ACCESS_SEQUENTIAL);
     sb_release_scratch(&scratch);
-    return text;
+    return file;
 }
 
 void reset_game_state(game_state_t *game_state)
@@ -788,7 +823,13 @@ void reset_game_state(game_state_t *game_state)
 void new_level(game_state_t *game_state)
 {
     sb_reset_arena(game_state->arena);
-    game_state->level_text = get_level_text(game_state->arena, +game_state->level_number++);
+
+    // the level text stays mapped for the whole level since resetting reparses it
+    if(game_state->level_file.data)
+        sb_unmap_file(&game_state->level_file);
+
+    game_state->level_file = map_level_file(game_state->level_number++);
+    game_state->level_text = sb_mapped_file_str8(game_state->level_file);
     game_state->reset_point = sb_arena_temp_begin(game_state->arena);
     reset_game_state(game_state);
 }
@@ -906,9 +947,11 @@ typedef struct
 
     VkPipeline ssao_pipeline;
     VkPipeline ssao_blur_pipeline;
-    VkPipeline gpass_pipeline;
-    VkPipeline shadow_pipeline;
+    VkPipeline gpass_pipelines[SHADER_ID_COUNT];
+    VkPipeline shadow_pipelines[SHADER_ID_COUNT];
     VkPipeline lighting_pipeline;
+
+    sb_gpu_timer_id gpass_timer; // the only pass sampling material textures, where mipmapping pays off
 } resources_t;
 
 sb_image_transition get_fragment_attachment_transition(sb_texture *texture)
@@ -981,7 +1024,7 @@ void bake_command_buffer(sb_app *app, VkCommandBuffer command_buffer, sb_texture
     }
 
 
-    // geometry pass
+    // geometry pass, what was visible last frame first, then what the depth it leaves doesn't hide
     {
         VkRenderingAttachmentInfo color_attachments[] = {
             sb_rendering_attachment_info(normal_texture, (sb_clear_value) {0}),
@@ -996,12 +1039,46 @@ void bake_command_buffer(sb_app *app, VkCommandBuffer command_buffer, sb_texture
         gpass.render_area = swapchain_texture->extent;
         gpass.depth_attachment = &depth_attachment;
 
+        sb_begin_gpu_timer(app, command_buffer, resources->gpass_timer);
+        sb_cull_early_draws(app, command_buffer);
         sb_begin_render_pass(command_buffer, &gpass);
 
-        sb_bind_graphics_pipeline(command_buffer, resources->gpass_pipeline);
-        sb_draw_scene(command_buffer, &app->indirect_command_buffer);
+        for(uint32_t i = 0; i < SHADER_ID_COUNT; i++)
+        {
+            sb_bind_graphics_pipeline(command_buffer, resources->gpass_pipelines[i]);
+            sb_draw_scene(command_buffer, &app->draw_command_buffers[SB_CULL_LIST_EARLY], i);
+        }
 
         sb_end_render_pass(command_buffer);
+
+        sb_image_transition depth_pyramid_transition = get_depth_readonly_transition(depth_buffer);
+        depth_pyramid_transition.dst_stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        sb_set_image_layouts(command_buffer, &depth_pyramid_transition, 1);
+
+        sb_cull_late_draws(app, command_buffer, resources->depth_buffer_id);
+
+        sb_image_transition depth_attachment_transition = {0};
+        depth_attachment_transition.texture = depth_buffer;
+        depth_attachment_transition.old_layout = SB_IMAGE_LAYOUT_READ_ONLY;
+        depth_attachment_transition.new_layout = SB_IMAGE_LAYOUT_RENDER_ATTACHMENT;
+        depth_attachment_transition.src_stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        depth_attachment_transition.dst_stage_mask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        sb_set_image_layouts(command_buffer, &depth_attachment_transition, 1);
+
+        for(uint32_t i = 0; i < COUNTOF(color_attachments); i++)
+            color_attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+        sb_begin_render_pass(command_buffer, &gpass);
+
+        for(uint32_t i = 0; i < SHADER_ID_COUNT; i++)
+        {
+            sb_bind_graphics_pipeline(command_buffer, resources->gpass_pipelines[i]);
+            sb_draw_scene(command_buffer, &app->draw_command_buffers[SB_CULL_LIST_LATE], i);
+        }
+
+        sb_end_render_pass(command_buffer);
+        sb_end_gpu_timer(app, command_buffer, resources->gpass_timer);
     }
 
     // shadow map generation pass
@@ -1014,8 +1091,11 @@ void bake_command_buffer(sb_app *app, VkCommandBuffer command_buffer, sb_texture
 
         sb_begin_render_pass(command_buffer, &shadow_pass);
 
-        sb_bind_graphics_pipeline(command_buffer, resources->shadow_pipeline);
-        sb_draw_scene(command_buffer, &app->indirect_command_buffer);
+        for(uint32_t i = 0; i < SHADER_ID_COUNT; i++)
+        {
+            sb_bind_graphics_pipeline(command_buffer, resources->shadow_pipelines[i]);
+            sb_draw_scene(command_buffer, &app->draw_command_buffers[SB_CULL_LIST_VIEWS + 0], i);
+        }
 
         sb_end_render_pass(command_buffer);
     }
@@ -1152,6 +1232,9 @@ int main(void)
     app_info.window_height = 1200;
     app_info.window_width = 900;
     app_info.bake_command_buffer = bake_command_buffer;
+    app_info.asset_pack_path = "assets.sbpak";
+    app_info.upload_bytes_per_frame = MB(8);
+    app_info.upload_ms_per_frame = 2.0f;
     sb_app *app = sb_create_app(&app_info);
 
     VkDeviceAddress time_address              = 0;
@@ -1170,6 +1253,10 @@ int main(void)
 
     sb_mat4_projection_ortho(shadow_camera_ubo->projection,  -25,  25,  -25,  25, 1,25);
 
+    // the gpass draws the camera's lists, the shadow pass its own view's
+    app->cull_ubo->view_count = 1;
+    app->cull_ubo->views[0].required_draw_flags = SB_DRAW_FLAG_CASTS_SHADOW;
+
     sb_vec3 scene_camera_position = {0};
 
     sb_mat4 scene_camera_rotation_matrix;
@@ -1211,9 +1298,14 @@ int main(void)
 
     // gpass pipeline
     {
-        VkDeviceAddress gpass_vertex_shader_ubos[2] = {0};
+        VkDeviceAddress gpass_vertex_shader_ubos[7] = {0};
         gpass_vertex_shader_ubos[0] = time_address;
         gpass_vertex_shader_ubos[1] = scene_camera_ubo_address;
+        gpass_vertex_shader_ubos[2] = app->mesh_memory.handle_buffer.address; // bounds for unpacking positions
+        gpass_vertex_shader_ubos[3] = app->draw_instance_buffer.address; // draw ids of the culled instances
+        gpass_vertex_shader_ubos[4] = app->draw_matrix_buffer.address + offsetof(sb_draw_matrices, camera_clips);
+        gpass_vertex_shader_ubos[5] = app->draw_matrix_buffer.address + offsetof(sb_draw_matrices, camera_normals);
+        gpass_vertex_shader_ubos[6] = app->transform_buffer.address; // water and ice need the world position
 
         VkFormat gpass_attachments[2] = {0};
         gpass_attachments[0] = VK_FORMAT_R16G16B16A16_SFLOAT; // Normals
@@ -1228,8 +1320,15 @@ int main(void)
         gpass_pipeline.cull_enabled = true;
         gpass_pipeline.vertex_ubo_count = COUNTOF(gpass_vertex_shader_ubos);
         gpass_pipeline.vertex_ubos = gpass_vertex_shader_ubos;
+        gpass_pipeline.fragment_ubos = &app->material_buffer.address;
+        gpass_pipeline.fragment_ubos_count = 1;
 
-        resources.gpass_pipeline = sb_create_graphics_pipeline(app, &gpass_pipeline);
+        for(uint32_t i = 0; i < SHADER_ID_COUNT; i++)
+        {
+            gpass_pipeline.shader_id = i;
+            resources.gpass_pipelines[i] = sb_create_graphics_pipeline(app, &gpass_pipeline);
+        }
+        resources.gpass_timer = sb_create_gpu_timer(app);
     }
 
     // shadow pass resources
@@ -1251,9 +1350,13 @@ int main(void)
         depth_bias.constant_factor = 1.25f;
         depth_bias.slope_factor = 1.9f;
 
-        VkDeviceAddress shadow_ubos[2] = {0};
+        VkDeviceAddress shadow_ubos[6] = {0};
         shadow_ubos[0] = shadow_camera_ubo_address;
         shadow_ubos[1] = time_address;
+        shadow_ubos[2] = app->mesh_memory.handle_buffer.address;
+        shadow_ubos[3] = app->draw_instance_buffer.address;
+        shadow_ubos[4] = app->draw_matrix_buffer.address + offsetof(sb_draw_matrices, view_clips[0]); // the shadow is view 0
+        shadow_ubos[5] = app->transform_buffer.address;
 
         sb_graphics_pipeline_info shadow_pipeline_info = {0};
         shadow_pipeline_info.depth_attachment_format = VK_FORMAT_D32_SFLOAT;
@@ -1263,7 +1366,11 @@ int main(void)
         shadow_pipeline_info.vertex_ubo_count = COUNTOF(shadow_ubos);
         shadow_pipeline_info.vertex_ubos = shadow_ubos;
 
-        resources.shadow_pipeline = sb_create_graphics_pipeline(app, &shadow_pipeline_info);
+        for(uint32_t i = 0; i < SHADER_ID_COUNT; i++)
+        {
+            shadow_pipeline_info.shader_id = i;
+            resources.shadow_pipelines[i] = sb_create_graphics_pipeline(app, &shadow_pipeline_info);
+        }
     }
      
     // ssao resources
@@ -1367,9 +1474,46 @@ int main(void)
     game_state.arena = sb_arena_alloc();
     new_level(&game_state);
 
+    #ifdef _DEBUG
+    double gpass_ms_total = 0.0;
+    uint32_t gpass_frame_count = 0;
+    bool was_mip_key_down = false;
+    uint32_t streaming_window_count = 0;
+    #endif
+
     sb_window_event window_event;
     while(sb_run_app(app, &window_event))
     {
+        #ifdef _DEBUG
+        // m flips every mipmapped texture between its full chain and mip 0 alone, each gpass average covers one of the two
+        bool is_mip_key_down = sb_is_key_down(SB_KEY_CODE_M);
+        if(is_mip_key_down && !was_mip_key_down)
+        {
+            sb_sample_base_level_only(app, !app->is_sampling_base_level_only);
+            gpass_ms_total = 0.0;
+            gpass_frame_count = 0;
+        }
+        was_mip_key_down = is_mip_key_down;
+
+        gpass_ms_total += sb_get_gpu_timer_ms(app, resources.gpass_timer);
+        if(++gpass_frame_count == 1000)
+        {
+            printf("gpass: %.3f ms avg, sampling %s\n", gpass_ms_total / gpass_frame_count,
+                app->is_sampling_base_level_only ? "mip 0 only" : "every mip");
+            printf("cull: %u draws, %u outside the frustum, %u occluded\n", app->cull_stats.draw_count,
+                app->cull_stats.frustum_rejected_count, app->cull_stats.occlusion_rejected_count);
+            gpass_ms_total = 0.0;
+            gpass_frame_count = 0;
+        }
+
+        const sb_streaming_stats *streaming = &app->streaming_stats;
+        if(streaming->window_count != streaming_window_count)
+        {
+            printf("streaming: %u frames, %.2f ms p99, %.2f ms max\n", streaming->frame_count, streaming->p99_ms, streaming->max_ms);
+            streaming_window_count = streaming->window_count;
+        }
+        #endif
+
         if(window_event.flags & SB_WINDOW_RESIZED_FLAG)
             sb_mat4_projection_perpective(scene_camera_ubo->projection, sb_get_aspect_ratio(app->window), sb_rad(60),2.5f, 28.0f);
 
@@ -1403,6 +1547,16 @@ int main(void)
         sb_mat4 world_to_shadow_view;
         sb_mat4_mul_mat4(shadow_camera_ubo->view, scene_transform, world_to_shadow_view);
 
+        sb_mat4 scene_view_projection, shadow_view_projection;
+        sb_mat4_mul_mat4(scene_camera_ubo->projection, scene_camera_ubo->view, scene_view_projection);
+        sb_mat4_mul_mat4(shadow_camera_ubo->projection, shadow_camera_ubo->view, shadow_view_projection);
+        app->cull_ubo->camera_frustum = sb_frustum_from_mat4(scene_view_projection);
+        app->cull_ubo->camera_position = scene_camera_position;
+        sb_mat4_copy(scene_view_projection, app->cull_ubo->camera_view_projection);
+        sb_mat4_copy(scene_camera_ubo->view, app->cull_ubo->camera_view);
+        app->cull_ubo->views[0].frustum = sb_frustum_from_mat4(shadow_view_projection);
+        sb_mat4_copy(shadow_view_projection, app->cull_ubo->views[0].view_projection);
+
         sb_mat4 shadow_view_to_light_space;
         sb_mat4_mul_mat4(shadow_camera_ubo->projection, world_to_shadow_view, shadow_view_to_light_space);
 
@@ -1,16 +1,23 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
 #include "sb_app.h"
 #include "sb_common.h"
 #include "sb_arena.h"
 #include "sb_file.h"
 #include "sb_vulkan_initializers.h"
 #include "sb_swapchain.h"
+#include "sb_image.h"
+#include "sb_texture_cache.h"
+#include "sb_compression.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
 
-VkSpecializationInfo *get_specialization_info(sb_arena *arena, const VkDeviceAddress *addresses, uint32_t address_count)
+// the addresses are constants 0 up, the shader id follows them. shaders without a constant just ignore its entry
+VkSpecializationInfo *get_specialization_info(sb_arena *arena, const VkDeviceAddress *addresses, uint32_t address_count, uint32_t shader_id)
 {
-    VkSpecializationMapEntry *entries = sb_arena_push(arena, VkSpecializationMapEntry, address_count);
+    assert(address_count <= SB_SHADER_ID_CONSTANT_ID);
+
+    VkSpecializationMapEntry *entries = sb_arena_push(arena, VkSpecializationMapEntry, address_count + 1);
     for(int i = 0; i < address_count; i++)
     {
         VkSpecializationMapEntry *entry = &entries[i];
@@ -19,11 +26,21 @@ VkSpecializationInfo *get_specialization_info(sb_arena *arena, const VkDeviceAdd
         entry->size = sizeof(VkDeviceAddress);
     }
 
+    size_t data_size = sizeof(VkDeviceAddress)*address_count + sizeof(uint32_t);
+    uint8_t *data = sb_arena_push(arena, uint8_t, data_size);
+    if(address_count > 0) memcpy(data, addresses, sizeof(VkDeviceAddress)*address_count);
+    memcpy(data + sizeof(VkDeviceAddress)*address_count, &shader_id, sizeof(uint32_t));
+
+    VkSpecializationMapEntry *shader_id_entry = &entries[address_count];
+    shader_id_entry->constantID = SB_SHADER_ID_CONSTANT_ID;
+    shader_id_entry->offset = sizeof(VkDeviceAddress)*address_count;
+    shader_id_entry->size = sizeof(uint32_t);
+
     VkSpecializationInfo *specialization = sb_arena_one(arena, VkSpecializationInfo);
-    specialization->dataSize = sizeof(VkDeviceAddress)*address_count;
-    specialization->mapEntryCount = address_count;
+    specialization->dataSize = data_size;
+    specialization->mapEntryCount = address_count + 1;
     specialization->pMapEntries = entries;
-    specialization->pData = (const void*)addresses;
+    specialization->pData = data;
     return specialization;
 }
 
@@ -31,26 +48,26 @@ VkPipeline sb_create_graphics_pipeline(sb_app *app, const sb_graphics_pipeline_i
 {
     VkVertexInputBindingDescription vertex_binding = {0};
 	vertex_binding.binding = 0;
-	vertex_binding.stride = sizeof(sb_vertex);
+	vertex_binding.stride = sizeof(sb_packed_vertex);
 	vertex_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 	VkVertexInputAttributeDescription position_attribute = {0};
 	position_attribute.location = 0;
 	position_attribute.binding = 0;
-	position_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-	position_attribute.offset = offsetof(sb_vertex, position);
+	position_attribute.format = VK_FORMAT_R16G16B16A16_UNORM;
+	position_attribute.offset = offsetof(sb_packed_vertex, position);
 
 	VkVertexInputAttributeDescription normal_attribute = {0};
 	normal_attribute.location = 1;
 	normal_attribute.binding = 0;
-	normal_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-	normal_attribute.offset = offsetof(sb_vertex, normal);
+	normal_attribute.format = VK_FORMAT_R16G16_SNORM;
+	normal_attribute.offset = offsetof(sb_packed_vertex, normal);
 
 	VkVertexInputAttributeDescription uv_attribute = {0};
 	uv_attribute.location = 2;
 	uv_attribute.binding = 0;
-	uv_attribute.format = VK_FORMAT_R32G32_SFLOAT;
-	uv_attribute.offset = offsetof(sb_vertex, uv);
+	uv_attribute.format = VK_FORMAT_R16G16_SFLOAT;
+	uv_attribute.offset = offsetof(sb_packed_vertex, uv);
 
 	VkVertexInputAttributeDescription attributes[] = { position_attribute, normal_attribute, uv_attribute };
 
@@ -76,11 +93,8 @@ VkPipeline sb_create_graphics_pipeline(sb_app *app, const sb_graphics_pipeline_i
 	vertex_shader.module = vertex_shader_module;
 	vertex_shader.stage =  VK_SHADER_STAGE_VERTEX_BIT;
     vertex_shader.pName = "main";
-    if(pipeline_info->vertex_ubo_count > 0)
-    {
-        vertex_shader.pSpecializationInfo =
-            get_specialization_info(scratch.arena, pipeline_info->vertex_ubos, pipeline_info->vertex_ubo_count);
-    }
+    vertex_shader.pSpecializationInfo =
+        get_specialization_info(scratch.arena, pipeline_info->vertex_ubos, pipeline_info->vertex_ubo_count, pipeline_info->shader_id);
 
     VkShaderModule frag_shader_module = VK_NULL_HANDLE;
     VkPipelineShaderStageCreateInfo frag_shader = {0};
@@ -91,11 +105,8 @@ VkPipeline sb_create_graphics_pipeline(sb_app *app, const sb_graphics_pipeline_i
         frag_shader.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         frag_shader.module = frag_shader_module;
         frag_shader.stage =  VK_SHADER_STAGE_FRAGMENT_BIT;
-        if(pipeline_info->fragment_ubos_count > 0)
-        {
-            frag_shader.pSpecializationInfo =
-                get_specialization_info(scratch.arena, pipeline_info->fragment_ubos, pipeline_info->fragment_ubos_count);
-        }
+        frag_shader.pSpecializationInfo =
+            get_specialization_info(scratch.arena, pipeline_info->fragment_ubos, pipeline_info->fragment_ubos_count, pipeline_info->shader_id);
         frag_shader.pName = "main";
     }
 
@@ -210,7 +221,7 @@ VkPipeline sb_create_compute_pipeline(sb_app *app, const sb_compute_pipeline_inf
     if(pipeline_info->address_count > 0)
     {
         comp_shader.pSpecializationInfo =
-            get_specialization_info(scratch.arena, pipeline_info->addresses, pipeline_info->address_count);
+            get_specialization_info(scratch.arena, pipeline_info->addresses, pipeline_info->address_count, 0);
 
     }
 	comp_shader.pName = "main";
@@ -235,6 +246,18 @@ VkImageAspectFlags sb_get_aspect_flag(sb_texture_type type)
     return type == SB_TEXTURE_TYPE_DEPTH ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 }
 
+VkSampler sb_get_sampler(sb_app *app, const sb_sampler_state *state)
+{
+    for(uint32_t i = 0; i < app->sampler_count; i++)
+        if(memcmp(&app->samplers[i].state, state, sizeof(sb_sampler_state)) == 0) return app->samplers[i].sampler;
+
+    assert(app->sampler_count < SB_MAX_SAMPLERS);
+    sb_cached_sampler *cached = &app->samplers[app->sampler_count++];
+    cached->state = *state;
+    cached->sampler = sb_create_sampler(app->device, state);
+    return cached->sampler;
+}
+
 sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info)
 {
     sb_texture_id id = ++app->texture_count;
@@ -243,7 +266,13 @@ sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info)
     VkImageUsageFlags image_usage = 0;
     if(info->usage & SB_TEXTURE_USAGE_SHADER_READ_FLAG)
     {
-        texture->sampler = sb_create_sampler(app->device, info->sampler_address_mode, info->sampler_border_color);
+        sb_sampler_state sampler_state = {0};
+        sampler_state.filter = VK_FILTER_LINEAR;
+        sampler_state.mipmap_mode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        sampler_state.address_mode = info->sampler_address_mode;
+        sampler_state.border_color = info->sampler_border_color;
+        sampler_state.is_base_level_only = app->is_sampling_base_level_only;
+        texture->sampler = sb_get_sampler(app, &sampler_state);
         image_usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
         app->texture_descriptor_updates[app->texture_descriptor_update_count++] = id;
     }
@@ -253,6 +282,21 @@ sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info)
     if(info->usage & SB_TEXTURE_USAGE_TRANSFER_DST)
         image_usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
+    uint32_t mip_levels = SB_MAX(info->mip_levels, 1);
+    if(info->flags & SB_TEXTURE_FLAG_MIPMAPPED)
+    {
+        // each level is blitted from the one above it, so every level is both a source and a destination
+        assert(!(info->flags & SB_TEXTURE_FLAG_WINDOW_RELATIVE));
+        mip_levels = sb_get_mip_level_count(info->extent);
+        image_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    else if((info->usage & SB_TEXTURE_USAGE_TRANSFER_DST) && app->transfer_buffer.host_image_copy.copy_memory_to_image &&
+        sb_supports_host_image_copy_format(app->physical_device, info->format))
+    {
+        // every level comes from the cpu, so the pixels can skip staging and go straight into the image
+        image_usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+    }
+
     VkExtent2D extent = info->extent;
     if(info->flags & SB_TEXTURE_FLAG_WINDOW_RELATIVE)
     {
@@ -260,7 +304,7 @@ sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info)
         extent = sb_get_window_extent(app->window);
     }
 
-    texture->image = sb_create_image(app->device, extent, info->format, image_usage, VK_SAMPLE_COUNT_1_BIT);
+    texture->image = sb_create_image(app->device, extent, info->format, image_usage, VK_SAMPLE_COUNT_1_BIT, mip_levels);
     if(info->flags & SB_TEXTURE_FLAG_DEDICATED_ALLOCATION)
         texture->memory = sb_dedicated_image_allocation(&app->memory_types, app->device, texture->image);
     else
@@ -270,38 +314,204 @@ sb_texture_id sb_create_texture(sb_app *app, const sb_texture_info *info)
     texture->image_usage = image_usage;
     texture->texture_type = info->texture_type;
     texture->extent = extent;
-    texture->view = sb_create_image_view(app->device, texture->image, info->format, sb_get_aspect_flag(info->texture_type));
+    texture->mip_levels = mip_levels;
+    texture->view = sb_create_image_view(app->device, texture->image, info->format, sb_get_aspect_flag(info->texture_type), mip_levels);
 
     return id;
 }
 
 sb_texture_id sb_texture_from_file(sb_app *app, const char *file_path)
 {
-	int tex_width, tex_height, tex_channels;
-	char *pixels = stbi_load(file_path, &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
-	assert(pixels);
-
-    sb_texture_info info = {0};
-    info.extent = (VkExtent2D) {tex_width, tex_height};
-    info.format = VK_FORMAT_R8G8B8A8_SRGB;
-    info.texture_type = SB_TEXTURE_TYPE_COLOR;
-    info.sampler_address_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    info.sampler_border_color = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
-    info.usage = SB_TEXTURE_USAGE_SHADER_READ_FLAG | SB_TEXTURE_USAGE_TRANSFER_DST;
+    return sb_texture_from_file_prioritized(app, file_path, SB_ASSET_PRIORITY_NORMAL);
+}
+
+const char *get_cooked_texture_path(sb_arena *arena, const char *file_path)
+{
+	size_t stem_size = strlen(file_path);
+	for(size_t i = stem_size; i > 0 && file_path[i - 1] != '/'; i--)
+		if(file_path[i - 1] == '.')
+		{
+			stem_size = i - 1;
+			break;
+		}
+
+	char *cooked_path = sb_arena_push(arena, char, stem_size + sizeof(".sbt"));
+	memcpy(cooked_path, file_path, stem_size);
+	memcpy(cooked_path + stem_size, ".sbt", sizeof(".sbt"));
+	return cooked_path;
+}
+
+VkFormat get_texture_file_format(sb_texture_file_format format)
+{
+	switch(format)
+	{
+		case SB_TEXTURE_FILE_FORMAT_BC1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case SB_TEXTURE_FILE_FORMAT_BC3: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case SB_TEXTURE_FILE_FORMAT_BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+		case SB_TEXTURE_FILE_FORMAT_RGBA8: return VK_FORMAT_R8G8B8A8_SRGB;
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+// a stale or foreign .sbt would otherwise be staged as level data, every level has to lie inside the file
+bool is_valid_texture_file(const void *data, uint64_t size)
+{
+	const sb_texture_file_header *header = data;
+	if(size < sizeof(sb_texture_file_header) || header->magic != SB_TEXTURE_FILE_MAGIC || header->version != SB_TEXTURE_FILE_VERSION)
+		return false;
+	if(get_texture_file_format(header->format) == VK_FORMAT_UNDEFINED || header->width == 0 || header->height == 0)
+		return false;
+	if(header->mip_count == 0 || header->mip_count > SB_TEXTURE_FILE_MAX_LEVELS)
+		return false;
+	if(size < sizeof(sb_texture_file_header) + header->mip_count * sizeof(sb_texture_file_level))
+		return false;
+
+	const sb_texture_file_level *levels = sb_texture_file_levels(header);
+	for(uint32_t i = 0; i < header->mip_count; i++)
+		if(levels[i].offset > size || levels[i].size > size - levels[i].offset) return false;
+	return true;
+}
+
+sb_texture_id sb_texture_from_file_prioritized(sb_app *app, const char *file_path, sb_asset_priority priority)
+{
+	sb_asset_cache_slot *cached;
+	if(sb_asset_cache_acquire(&app->texture_cache, file_path, &cached)) return cached->id;
+
+	sb_texture_info info = {0};
+	info.texture_type = SB_TEXTURE_TYPE_COLOR;
+	info.sampler_address_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	info.sampler_border_color = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
+	info.usage = SB_TEXTURE_USAGE_SHADER_READ_FLAG | SB_TEXTURE_USAGE_TRANSFER_DST;
+
+	// a cooked .sbt next to the source wins, its blocks and mips are uploaded as they are.
+	// a device without bc formats decodes the source instead
+	sb_texture_transfer source = {0};
+	sb_texture_file_header cooked = {0};
+	sb_arena_temp scratch = sb_get_scratch();
+	const char *cooked_path = get_cooked_texture_path(scratch.arena, file_path);
+	const sb_pack_entry *entry = app->use_bc_textures ? sb_pack_find(&app->asset_pack, cooked_path) : NULL;
+	if(entry)
+	{
+		cooked.width = entry->metadata[0];
+		cooked.height = entry->metadata[1];
+		cooked.format = entry->metadata[2];
+		cooked.mip_count = entry->metadata[3];
+	}
+	else if(app->use_bc_textures && sb_file_exists(cooked_path))
+	{
+		// one that doesn't check out is ignored and the source image decoded in its place
+		source.image_file = sb_map_file(cooked_path, SB_FILE_ACCESS_SEQUENTIAL);
+		if(is_valid_texture_file(source.image_file.data, source.image_file.size))
+			cooked = *(const sb_texture_file_header*) source.image_file.data;
+		else
+			sb_unmap_file(&source.image_file);
+	}
+	source.is_texture_file = cooked.mip_count > 0;
+
+	if(cooked.mip_count > 0)
+	{
+		info.extent = (VkExtent2D) {cooked.width, cooked.height};
+		info.format = get_texture_file_format(cooked.format);
+		info.mip_levels = cooked.mip_count;
+	}
+	else
+	{
+		entry = sb_pack_find(&app->asset_pack, file_path);
+		if(!entry) source.image_file = sb_map_file(file_path, SB_FILE_ACCESS_SEQUENTIAL);
+
+		// only the header is parsed here, the pixels are decoded once the transfer is picked up. a packed image only has
+		// its leading blocks expanded, a jpeg's frame header can sit behind large metadata so that grows until it's found
+		sb_image_info image_info = {0};
+		bool is_valid_image = false;
+		if(entry)
+		{
+			uint64_t prefix_size = SB_MIN(SB_COMPRESSION_BLOCK_SIZE, entry->raw_size);
+			for(;;)
+			{
+				const void *prefix = sb_pack_load_prefix(scratch.arena, &app->asset_pack, entry, prefix_size);
+				is_valid_image = sb_get_image_info(prefix, prefix_size, &image_info);
+				if(is_valid_image || prefix_size == entry->raw_size) break;
+				prefix_size = SB_MIN(prefix_size * 2, entry->raw_size);
+			}
+		}
+		else is_valid_image = sb_get_image_info(source.image_file.data, source.image_file.size, &image_info);
+		assert(is_valid_image);
+
+		info.extent = (VkExtent2D) {image_info.width, image_info.height};
+		info.format = VK_FORMAT_R8G8B8A8_SRGB;
+		info.flags = app->texture_flags;
+
+		// texels decoded from the same bytes on an earlier run are mapped and staged like a cooked texture,
+		// otherwise the transfer writes them out after decoding
+		if(app->use_texture_cache)
+		{
+			// packed images are keyed on the bytes as stored, which change whenever the source does, so nothing is
+			// decompressed just to look an entry up
+			source.cache_key = entry ? sb_get_texture_cache_key(sb_pack_entry_stored(&app->asset_pack, entry), entry->stored_size) :
+				sb_get_texture_cache_key(source.image_file.data, source.image_file.size);
+			sb_mapped_file cache_file = sb_open_texture_cache(source.cache_key, image_info.width, image_info.height);
+			if(cache_file.data)
+			{
+				if(source.image_file.data) sb_unmap_file(&source.image_file);
+				source.image_file = cache_file;
+				source.is_texture_file = true;
+				source.cache_key = 0;
+				entry = NULL;
+			}
+		}
+	}
+	sb_release_scratch(&scratch);
+
     sb_texture_id id = sb_create_texture(app, &info);
+    sb_get_texture(app, id)->is_pending = true;
 
-    sb_texture_transfer *transfer = sb_queue_texture_transfer(&app->transfer_buffer);
-    transfer->texture_id = id;
-    transfer->pixels = pixels;
+    sb_texture_transfer *transfer = sb_queue_texture_transfer(&app->transfer_buffer, id, priority);
+    transfer->image_file = source.image_file;
+    transfer->pack = entry ? &app->asset_pack : NULL;
+    transfer->pack_entry = entry;
+    transfer->is_texture_file = source.is_texture_file;
+    transfer->cache_key = source.cache_key;
 
+	cached->id = id;
 	return id;
 }
 
+uint32_t sb_release_texture(sb_app *app, const char *file_path)
+{
+	return sb_asset_cache_release(&app->texture_cache, file_path);
+}
+
 sb_texture *sb_get_texture(sb_app *app, sb_texture_id id)
 {
     return &app->texture_handles[id];
 }
 
+void sb_sample_base_level_only(sb_app *app, bool enable)
+{
+    if(app->is_sampling_base_level_only == enable) return;
+    app->is_sampling_base_level_only = enable;
+
+    // the views keep every level, only the sampler swaps, so flipping back and forth costs a descriptor write per texture
+    for(sb_texture_id id = 1; id <= app->texture_count; id++)
+    {
+        sb_texture *texture = sb_get_texture(app, id);
+        if(!texture->sampler || texture->mip_levels < 2) continue;
+
+        for(uint32_t i = 0; i < app->sampler_count; i++)
+        {
+            if(app->samplers[i].sampler != texture->sampler) continue;
+
+            sb_sampler_state state = app->samplers[i].state;
+            state.is_base_level_only = enable;
+            texture->sampler = sb_get_sampler(app, &state);
+            break;
+        }
+
+        assert(app->texture_descriptor_update_count < SB_MAX_TEXTURES * 2);
+        app->texture_descriptor_updates[app->texture_descriptor_update_count++] = id;
+    }
+}
+
 void *sb_alloc_ubo(sb_app *app, VkDeviceSize size, VkDeviceAddress *out_address)
 {
     VkDeviceSize offset = sb_offset_device_arena_aligned(&app->ubo_staging_arena, size, 16);
@@ -347,7 +557,7 @@ void sb_set_image_layouts(VkCommandBuffer command_buffer, const sb_image_transit
         image_barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         image_barrier->subresourceRange.baseArrayLayer = 0;
         image_barrier->subresourceRange.layerCount = 1;
-        image_barrier->subresourceRange.levelCount = 1;
+        image_barrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
         image_barrier->subresourceRange.baseMipLevel = 0;
         image_barrier->subresourceRange.aspectMask = sb_get_aspect_flag(texture_barrier->texture->texture_type);
 
@@ -405,15 +615,16 @@ void sb_begin_render_pass(VkCommandBuffer command_buffer, sb_render_pass_info *i
 	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 }
 
-void sb_draw_scene(VkCommandBuffer command_buffer, sb_buffer *draw_command_buffer)
+void sb_draw_scene(VkCommandBuffer command_buffer, sb_buffer *draw_command_buffer, uint32_t shader_id)
 {
+    assert(shader_id < SB_MAX_SHADER_BINS);
     vkCmdDrawIndexedIndirectCount(
 		command_buffer,
 		draw_command_buffer->vk_buffer,
-		offsetof(sb_indirect_command_array, array),
+		offsetof(sb_indirect_command_array, array) + shader_id * SB_SHADER_BIN_COMMAND_COUNT * sizeof(VkDrawIndexedIndirectCommand),
 		draw_command_buffer->vk_buffer,
-		offsetof(sb_indirect_command_array, count),
-		SB_MAX_DRAW_COUNT,
+		offsetof(sb_indirect_command_array, counts) + shader_id * sizeof(uint32_t),
+		SB_SHADER_BIN_COMMAND_COUNT,
 		sizeof(VkDrawIndexedIndirectCommand)
 	);
 }
@@ -438,11 +649,29 @@ VkDescriptorSetLayout create_global_set_layout(VkDevice device)
     VkDescriptorSetLayoutBinding texture_array_binding = {0};
     texture_array_binding.binding = TEXTURE_ARRAY_BINDING;
     texture_array_binding.descriptorCount = SB_MAX_TEXTURES;
-    texture_array_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    texture_array_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding bindings[] = {draw_info_binding, texture_array_binding};
-    VkDescriptorBindingFlags binding_flags[] = {draw_info_binding_flags, texture_array_binding_flags};
+    texture_array_binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    texture_array_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    // indexed by texture id like the images, every slot points at one of the cached samplers
+    #define SAMPLER_ARRAY_BINDING 2U
+    VkDescriptorBindingFlags sampler_array_binding_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorSetLayoutBinding sampler_array_binding = {0};
+    sampler_array_binding.binding = SAMPLER_ARRAY_BINDING;
+    sampler_array_binding.descriptorCount = SB_MAX_TEXTURES;
+    sampler_array_binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    sampler_array_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    // one level of the depth pyramid each, written while it's built. the cull reads it back through the texture array
+    #define DEPTH_PYRAMID_BINDING 3U
+    VkDescriptorBindingFlags depth_pyramid_binding_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorSetLayoutBinding depth_pyramid_binding = {0};
+    depth_pyramid_binding.binding = DEPTH_PYRAMID_BINDING;
+    depth_pyramid_binding.descriptorCount = SB_MAX_DEPTH_PYRAMID_LEVELS;
+    depth_pyramid_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    depth_pyramid_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding bindings[] = {draw_info_binding, texture_array_binding, sampler_array_binding, depth_pyramid_binding};
+    VkDescriptorBindingFlags binding_flags[] = {draw_info_binding_flags, texture_array_binding_flags, sampler_array_binding_flags, depth_pyramid_binding_flags};
 
     VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {0};
 	binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
@@ -461,6 +690,52 @@ VkDescriptorSetLayout create_global_set_layout(VkDevice device)
     return set_layout;
 }
 
+// half the window rounded down, the cull maps pixels past the last texel of a level onto it
+void create_depth_pyramid(sb_app *app)
+{
+    VkExtent2D window_extent = sb_get_window_extent(app->window);
+    VkExtent2D extent = {SB_MAX(window_extent.width / 2, 1), SB_MAX(window_extent.height / 2, 1)};
+
+    sb_texture *pyramid = sb_get_texture(app, app->depth_pyramid);
+    pyramid->texture_type = SB_TEXTURE_TYPE_COLOR;
+    pyramid->format = VK_FORMAT_R32_SFLOAT;
+    pyramid->image_usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    pyramid->extent = extent;
+    pyramid->mip_levels = SB_MIN(sb_get_mip_level_count(extent), SB_MAX_DEPTH_PYRAMID_LEVELS);
+    pyramid->sampler = sb_get_sampler(app, &(sb_sampler_state) {0});
+    pyramid->image = sb_create_image(app->device, extent, pyramid->format, pyramid->image_usage, VK_SAMPLE_COUNT_1_BIT, pyramid->mip_levels);
+    pyramid->memory = sb_dedicated_image_allocation(&app->memory_types, app->device, pyramid->image);
+    pyramid->view = sb_create_image_view(app->device, pyramid->image, pyramid->format, VK_IMAGE_ASPECT_COLOR_BIT, pyramid->mip_levels);
+    app->texture_descriptor_updates[app->texture_descriptor_update_count++] = app->depth_pyramid;
+
+    VkDescriptorImageInfo image_infos[SB_MAX_DEPTH_PYRAMID_LEVELS] = {0};
+    for(uint32_t level = 0; level < pyramid->mip_levels; level++)
+    {
+        app->depth_pyramid_views[level] = sb_create_image_level_view(app->device, pyramid->image, pyramid->format, VK_IMAGE_ASPECT_COLOR_BIT, level);
+        image_infos[level].imageView = app->depth_pyramid_views[level];
+        image_infos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkWriteDescriptorSet write = {0};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = app->global_set;
+    write.dstBinding = DEPTH_PYRAMID_BINDING;
+    write.descriptorCount = pyramid->mip_levels;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.pImageInfo = image_infos;
+    vkUpdateDescriptorSets(app->device, 1, &write, 0, NULL);
+}
+
+void destroy_depth_pyramid(sb_app *app)
+{
+    sb_texture *pyramid = sb_get_texture(app, app->depth_pyramid);
+    for(uint32_t level = 0; level < pyramid->mip_levels; level++)
+        vkDestroyImageView(app->device, app->depth_pyramid_views[level], NULL);
+    vkDestroyImageView(app->device, pyramid->view, NULL);
+    vkDestroyImage(app->device, pyramid->image, NULL);
+    vkFreeMemory(app->device, pyramid->memory, NULL);
+}
+
 sb_app *sb_create_app(const sb_app_info *info)
 {
     sb_app *app = malloc(sizeof(sb_app));
@@ -474,7 +749,9 @@ sb_app *sb_create_app(const sb_app_info *info)
 
     uint32_t transfer_queue_index; uint32_t graphics_queue_index;
     app->physical_device = sb_get_physical_device(app->instance, app->surface, &transfer_queue_index, &graphics_queue_index);
-    app->device = sb_create_device(app->physical_device, transfer_queue_index, graphics_queue_index);
+    bool use_host_image_copy = !info->skip_host_image_copy && sb_supports_host_image_copy(app->physical_device);
+    app->use_bc_textures = sb_supports_bc_textures(app->physical_device);
+    app->device = sb_create_device(app->physical_device, transfer_queue_index, graphics_queue_index, use_host_image_copy, app->use_bc_textures);
 
     app->memory_types = sb_get_memory_types(app->physical_device);
 
@@ -493,8 +770,12 @@ sb_app *sb_create_app(const sb_app_info *info)
     app->swapchain = sb_create_swapchain(app->device, app->surface, app->physical_device, VK_NULL_HANDLE, app->swapchain_image_format, app->present_mode);
     app->command_pool = sb_create_command_pool(app->device, graphics_queue_index);
     app->swapchain_arena = sb_arena_alloc();
-    app->mesh_memory = sb_alloc_mesh_memory(app->device, &app->memory_types);
+    app->mesh_memory = sb_alloc_mesh_memory(app->device, &app->memory_types, info->use_32_bit_indices ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16);
     app->transfer_buffer = sb_create_transfer_buffer(app->device, &app->memory_types, transfer_queue_index, graphics_queue_index);
+    if(use_host_image_copy) app->transfer_buffer.host_image_copy = sb_load_host_image_copy(app->device);
+    if(info->asset_pack_path) sb_open_pack(info->asset_pack_path, &app->asset_pack);
+    sb_init_asset_cache(&app->mesh_cache);
+    sb_init_asset_cache(&app->texture_cache);
 
     sb_memory_info image_arena_info = {0};
     image_arena_info.capacity = MB(256);
@@ -503,6 +784,32 @@ sb_app *sb_create_app(const sb_app_info *info)
     image_arena_info.memory_types = &app->memory_types;
     sb_allocate_device_arena(app->device, &image_arena_info, &app->image_arena);
 
+    app->texture_flags = info->skip_mipmaps ? 0 : SB_TEXTURE_FLAG_MIPMAPPED;
+    app->use_texture_cache = !info->skip_texture_cache;
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(app->physical_device, &device_properties);
+    app->timestamp_period_ms = device_properties.limits.timestampPeriod / 1000000.0;
+    app->timestamp_pool = sb_create_timestamp_query_pool(app->device, SB_MAX_GPU_TIMERS * 2);
+
+    app->transfer_buffer.budget.bytes_per_frame = info->upload_bytes_per_frame;
+    app->transfer_buffer.budget.ms_per_frame = info->upload_ms_per_frame;
+
+    // textures still in the transfer queue sample this, white so the draw color shows through untouched
+    static const uint8_t white_pixel[4] = {255, 255, 255, 255};
+
+    sb_texture_info fallback_info = {0};
+    fallback_info.extent = (VkExtent2D) {1, 1};
+    fallback_info.format = VK_FORMAT_R8G8B8A8_SRGB;
+    fallback_info.texture_type = SB_TEXTURE_TYPE_COLOR;
+    fallback_info.sampler_address_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    fallback_info.sampler_border_color = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
+    fallback_info.usage = SB_TEXTURE_USAGE_SHADER_READ_FLAG | SB_TEXTURE_USAGE_TRANSFER_DST;
+    app->fallback_texture = sb_create_texture(app, &fallback_info);
+
+    sb_texture_transfer *fallback_transfer = sb_queue_texture_transfer(&app->transfer_buffer, app->fallback_texture, SB_ASSET_PRIORITY_IMMEDIATE);
+    fallback_transfer->pixels = white_pixel;
+
     VkDeviceSize ubo_memory_size = MB(16);
 
     sb_memory_info ubo_staging_arena_info = {0};
@@ -524,7 +831,56 @@ sb_app *sb_create_app(const sb_app_info *info)
     indirect_command_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
     indirect_command_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     indirect_command_buffer_info.memory_types = &app->memory_types;
-    sb_allocate_buffer(app->device, &indirect_command_buffer_info, &app->indirect_command_buffer);
+    for(uint32_t i = 0; i < SB_MAX_CULL_LISTS; i++)
+        sb_allocate_buffer(app->device, &indirect_command_buffer_info, &app->draw_command_buffers[i]);
+
+    sb_memory_info draw_instance_buffer_info = {0};
+    draw_instance_buffer_info.capacity = SB_MAX_CULL_LISTS * SB_MAX_DRAW_COUNT * sizeof(uint32_t);
+    draw_instance_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
+    draw_instance_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    draw_instance_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &draw_instance_buffer_info, &app->draw_instance_buffer);
+
+    sb_memory_info cull_scratch_buffer_info = {0};
+    cull_scratch_buffer_info.capacity = sizeof(sb_cull_scratch);
+    cull_scratch_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
+    cull_scratch_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    cull_scratch_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &cull_scratch_buffer_info, &app->cull_scratch_buffer);
+
+    sb_memory_info cull_dispatch_buffer_info = {0};
+    cull_dispatch_buffer_info.capacity = sizeof(VkDispatchIndirectCommand);
+    cull_dispatch_buffer_info.memory_usage = SB_MEMORY_USAGE_CPU;
+    cull_dispatch_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    cull_dispatch_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &cull_dispatch_buffer_info, &app->cull_dispatch_buffer);
+    memset(app->cull_dispatch_buffer.memory_ptr, 0, sizeof(VkDispatchIndirectCommand));
+
+    // never cleared, until the first late phase has run draws only move between the early and late lists
+    sb_memory_info draw_visibility_buffer_info = {0};
+    draw_visibility_buffer_info.capacity = SB_MAX_DRAW_COUNT * sizeof(uint32_t);
+    draw_visibility_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
+    draw_visibility_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    draw_visibility_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &draw_visibility_buffer_info, &app->draw_visibility_buffer);
+
+    sb_memory_info draw_matrix_buffer_info = {0};
+    draw_matrix_buffer_info.capacity = sizeof(sb_draw_matrices);
+    draw_matrix_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
+    draw_matrix_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    draw_matrix_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &draw_matrix_buffer_info, &app->draw_matrix_buffer);
+
+    sb_memory_info cull_stats_buffer_info = {0};
+    cull_stats_buffer_info.capacity = sizeof(sb_cull_stats);
+    cull_stats_buffer_info.memory_usage = SB_MEMORY_USAGE_CPU;
+    cull_stats_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    cull_stats_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &cull_stats_buffer_info, &app->cull_stats_buffer);
+    memset(app->cull_stats_buffer.memory_ptr, 0, sizeof(sb_cull_stats));
+
+    app->depth_pyramid = ++app->texture_count;
+    create_depth_pyramid(app);
 
     for(int i = 0; i < 2; i++)
     {
@@ -536,16 +892,62 @@ sb_app *sb_create_app(const sb_app_info *info)
         sb_allocate_buffer(app->device, &draw_info_buffer_info, &app->draw_info_buffers[i]);
     }
 
-    VkDeviceAddress addresses[2];
-    addresses[0] = app->indirect_command_buffer.address;
-    addresses[1] = app->mesh_memory.handle_buffer.address;
+    sb_memory_info material_buffer_info = {0};
+    material_buffer_info.capacity = 2 * SB_MAX_MATERIALS * sizeof(sb_material);
+    material_buffer_info.memory_usage = SB_MEMORY_USAGE_CPU_TO_GPU;
+    material_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    material_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &material_buffer_info, &app->material_buffer);
+
+    sb_memory_info transform_buffer_info = {0};
+    transform_buffer_info.capacity = 2 * SB_MAX_GENERAL_TRANSFORMS * sizeof(sb_mat4);
+    transform_buffer_info.memory_usage = SB_MEMORY_USAGE_CPU_TO_GPU;
+    transform_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    transform_buffer_info.memory_types = &app->memory_types;
+    sb_allocate_buffer(app->device, &transform_buffer_info, &app->transform_buffer);
+
+    VkDeviceAddress cull_ubo_address = 0;
+    app->cull_ubo = sb_alloc_ubo(app, sizeof(sb_cull_ubo), &cull_ubo_address);
+    for(uint32_t i = 0; i < SB_MAX_CULL_LISTS; i++)
+        app->cull_ubo->draw_commands[i] = app->draw_command_buffers[i].address;
+
+    // the cull passes share their addresses, every phase finds its lists in the ubo
+    VkDeviceAddress addresses[9];
+    addresses[0] = app->mesh_memory.handle_buffer.address;
+    addresses[1] = cull_ubo_address;
+    addresses[2] = app->draw_visibility_buffer.address;
+    addresses[3] = app->cull_stats_buffer.address;
+    addresses[4] = app->cull_scratch_buffer.address;
+    addresses[5] = app->draw_instance_buffer.address;
+    addresses[6] = app->mesh_memory.cluster_buffer.address;
+    addresses[7] = app->draw_matrix_buffer.address;
+    addresses[8] = app->transform_buffer.address;
 
     sb_compute_pipeline_info cull_info = {0};
     cull_info.addresses = addresses;
-    cull_info.address_count = 2;
-    cull_info.compute_shader_name = "shaders/spv/comp.spv";
-
-    app->compute_cull_pipeline = sb_create_compute_pipeline(app, &cull_info);
+    cull_info.address_count = COUNTOF(addresses);
+
+    cull_info.compute_shader_name = "shaders/spv/shader.spv";
+    app->cull_pipeline = sb_create_compute_pipeline(app, &cull_info);
+    cull_info.compute_shader_name = "shaders/spv/cull_compact.spv";
+    app->cull_compact_pipeline = sb_create_compute_pipeline(app, &cull_info);
+    cull_info.compute_shader_name = "shaders/spv/cull_scatter.spv";
+    app->cull_scatter_pipeline = sb_create_compute_pipeline(app, &cull_info);
+    cull_info.compute_shader_name = "shaders/spv/cull_clusters.spv";
+    app->cull_cluster_pipeline = sb_create_compute_pipeline(app, &cull_info);
+
+    sb_compute_pipeline_info depth_pyramid_info = {0};
+    depth_pyramid_info.compute_shader_name = "shaders/spv/depth_pyramid.spv";
+    app->depth_pyramid_pipeline = sb_create_compute_pipeline(app, &depth_pyramid_info);
+
+    // without the shader compressed meshes are expanded on the cpu
+    sb_compute_pipeline_info decompress_info = {0};
+    decompress_info.addresses = &app->transfer_buffer.decompression_blocks.address;
+    decompress_info.address_count = 1;
+    decompress_info.compute_shader_name = "shaders/spv/decompress.spv";
+
+    if(sb_file_exists(decompress_info.compute_shader_name))
+        app->transfer_buffer.decompress_pipeline = sb_create_compute_pipeline(app, &decompress_info);
     return app;
 }
 
@@ -579,7 +981,7 @@ void sb_recreate_swapchain(sb_app *app)
 
     app->image_views = sb_arena_push(app->swapchain_arena, VkImageView, app->image_count);
     for(int i = 0; i < app->image_count; i++)
-        app->image_views[i] = sb_create_image_view(app->device, app->images[i], app->swapchain_image_format, VK_IMAGE_ASPECT_COLOR_BIT);
+        app->image_views[i] = sb_create_image_view(app->device, app->images[i], app->swapchain_image_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
 void sb_recreate_command_buffers(sb_app *app)
@@ -594,6 +996,7 @@ void sb_recreate_command_buffers(sb_app *app)
         VkImageView image_view = app->image_views[image_index];
 
         sb_begin_command_buffer(command_buffer, false);
+        vkCmdResetQueryPool(command_buffer, app->timestamp_pool, 0, SB_MAX_GPU_TIMERS * 2);
         sb_bind_mesh_buffers(command_buffer, &app->mesh_memory);
 
         vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->global_pipeline_layout, 0, 1, &app->global_set, 0, NULL);
@@ -602,7 +1005,7 @@ void sb_recreate_command_buffers(sb_app *app)
         VkBufferMemoryBarrier2 pre_ubo_copy_barrier = sb_get_buffer_barrier(&app->ubo_gpu_memory);
         pre_ubo_copy_barrier.srcAccessMask = 0;
         pre_ubo_copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        pre_ubo_copy_barrier.srcStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        pre_ubo_copy_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         pre_ubo_copy_barrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
         sb_buffer_barriers(command_buffer, &pre_ubo_copy_barrier, 1);
 
@@ -616,36 +1019,51 @@ void sb_recreate_command_buffers(sb_app *app)
         post_ubo_copy_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         post_ubo_copy_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
         post_ubo_copy_barrier.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        post_ubo_copy_barrier.dstStageMask = VK_SHADER_STAGE_VERTEX_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-
-        VkBufferMemoryBarrier2 prefill_barrier = sb_get_buffer_barrier(&app->indirect_command_buffer);
-        prefill_barrier.srcStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
-        prefill_barrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        prefill_barrier.srcAccessMask = 0;
-        prefill_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        VkBufferMemoryBarrier2 barriers[] = {post_ubo_copy_barrier, prefill_barrier};
+        post_ubo_copy_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        // every list's draw count, the per mesh instance counts and the cull stats start from 0
+        sb_buffer *reset_buffers[SB_MAX_CULL_LISTS + 2] = {&app->cull_stats_buffer, &app->cull_scratch_buffer};
+        for(uint32_t i = 0; i < SB_MAX_CULL_LISTS; i++)
+            reset_buffers[i + 2] = &app->draw_command_buffers[i];
+        VkBufferMemoryBarrier2 barriers[COUNTOF(reset_buffers) + 1];
+        barriers[0] = post_ubo_copy_barrier;
+        for(uint32_t i = 0; i < COUNTOF(reset_buffers); i++)
+        {
+            VkBufferMemoryBarrier2 prefill_barrier = sb_get_buffer_barrier(reset_buffers[i]);
+            prefill_barrier.srcStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            prefill_barrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            prefill_barrier.srcAccessMask = 0;
+            prefill_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barriers[i + 1] = prefill_barrier;
+        }
         sb_buffer_barriers(command_buffer, barriers, COUNTOF(barriers));
 
-        // reset draw count to 0
-        vkCmdFillBuffer(command_buffer, app->indirect_command_buffer.vk_buffer, offsetof(sb_indirect_command_array, count), sizeof(uint32_t), 0);
+        vkCmdFillBuffer(command_buffer, app->cull_stats_buffer.vk_buffer, 0, sizeof(sb_cull_stats), 0);
+        vkCmdFillBuffer(command_buffer, app->cull_scratch_buffer.vk_buffer, 0, offsetof(sb_cull_scratch, mesh_first_instances), 0);
+        for(uint32_t i = 2; i < COUNTOF(reset_buffers); i++)
+            vkCmdFillBuffer(command_buffer, reset_buffers[i]->vk_buffer, offsetof(sb_indirect_command_array, counts), SB_MAX_SHADER_BINS * sizeof(uint32_t), 0);
 
-        VkBufferMemoryBarrier2 postfill_barrier = sb_get_buffer_barrier(&app->indirect_command_buffer);
-        postfill_barrier.srcStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
-        postfill_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-        postfill_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        postfill_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT |  VK_ACCESS_SHADER_WRITE_BIT;
-        sb_buffer_barriers(command_buffer, &postfill_barrier, 1);
+        VkBufferMemoryBarrier2 postfill_barriers[COUNTOF(reset_buffers) + 1];
+        for(uint32_t i = 0; i < COUNTOF(reset_buffers); i++)
+        {
+            VkBufferMemoryBarrier2 postfill_barrier = sb_get_buffer_barrier(reset_buffers[i]);
+            postfill_barrier.srcStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+            postfill_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            postfill_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            postfill_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT |  VK_ACCESS_SHADER_WRITE_BIT;
+            postfill_barriers[i] = postfill_barrier;
+        }
 
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->compute_cull_pipeline);
-        vkCmdDispatch(command_buffer, SB_MAX_DRAW_COUNT / 64U, 1, 1);
+        // the last frame's late phase wrote the visibility this frame's early phase reads
+        VkBufferMemoryBarrier2 visibility_barrier = sb_get_buffer_barrier(&app->draw_visibility_buffer);
+        visibility_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        visibility_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        visibility_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        visibility_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        postfill_barriers[COUNTOF(reset_buffers)] = visibility_barrier;
+        sb_buffer_barriers(command_buffer, postfill_barriers, COUNTOF(postfill_barriers));
 
-        VkBufferMemoryBarrier2 indirect_barrier = sb_get_buffer_barrier(&app->indirect_command_buffer);
-        indirect_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-        indirect_barrier.dstStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
-        indirect_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT |  VK_ACCESS_SHADER_WRITE_BIT;
-        indirect_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-        sb_buffer_barriers(command_buffer, &indirect_barrier, 1);
+        dispatch_cull(app, command_buffer, SB_CULL_PHASE_VIEWS);
 
         sb_texture swapchain_texture = {0};
         swapchain_texture.image = image;
@@ -680,12 +1098,12 @@ void sb_recreate_window_relative_textures(sb_app *app)
             if(was_dedicated_allocation)
                 vkFreeMemory(app->device, texture->memory, NULL);
 
-            texture->image = sb_create_image(app->device, window_extent, texture->format, texture->image_usage, VK_SAMPLE_COUNT_1_BIT);
+            texture->image = sb_create_image(app->device, window_extent, texture->format, texture->image_usage, VK_SAMPLE_COUNT_1_BIT, 1);
             if(was_dedicated_allocation)
                 texture->memory = sb_dedicated_image_allocation(&app->memory_types, app->device, texture->image);
 
             texture->extent = window_extent;
-            texture->view = sb_create_image_view(app->device, texture->image, texture->format, sb_get_aspect_flag(texture->texture_type));
+            texture->view = sb_create_image_view(app->device, texture->image, texture->format, sb_get_aspect_flag(texture->texture_type), 1);
 
             if(texture->sampler)
                 app->texture_descriptor_updates[app->texture_descriptor_update_count++] = id;
@@ -697,6 +1115,8 @@ void sb_on_resize(sb_app *app)
     VK_CHECK(vkDeviceWaitIdle(app->device));
 
     sb_recreate_window_relative_textures(app);
+    destroy_depth_pyramid(app);
+    create_depth_pyramid(app);
     sb_recreate_swapchain(app);
     sb_recreate_command_buffers(app);
 }
@@ -706,43 +1126,271 @@ void sb_update_texture_descriptors(sb_app *app)
     if(app->texture_descriptor_update_count == 0) return;
 	sb_arena_temp scratch = sb_get_scratch();
 
+	// one image and one sampler write per texture, both at the texture's id
+	uint32_t write_count = app->texture_descriptor_update_count * 2;
 	VkDescriptorImageInfo *image_infos = sb_arena_push(scratch.arena, VkDescriptorImageInfo, app->texture_descriptor_update_count);
-	VkWriteDescriptorSet *set_writes = sb_arena_push(scratch.arena, VkWriteDescriptorSet, app->texture_descriptor_update_count);
+	VkWriteDescriptorSet *set_writes = sb_arena_push(scratch.arena, VkWriteDescriptorSet, write_count);
 	for(int i = 0; i < app->texture_descriptor_update_count; i++)
 	{
 		sb_texture_id id = app->texture_descriptor_updates[i];
 		sb_texture *texture = sb_get_texture(app, id);
+		if(texture->is_pending) texture = sb_get_texture(app, app->fallback_texture);
 
 		VkDescriptorImageInfo *image_info = &image_infos[i];
 		image_info->imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
 		image_info->imageView = texture->view;
 		image_info->sampler = texture->sampler;
 
-		VkWriteDescriptorSet *write = &set_writes[i];
-		write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write->dstSet = app->global_set;
-		write->dstBinding = TEXTURE_ARRAY_BINDING;
-		write->dstArrayElement = id;
-		write->descriptorCount = 1;
-		write->descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		write->pImageInfo = image_info;
+		VkWriteDescriptorSet *image_write = &set_writes[i * 2];
+		image_write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		image_write->dstSet = app->global_set;
+		image_write->dstBinding = TEXTURE_ARRAY_BINDING;
+		image_write->dstArrayElement = id;
+		image_write->descriptorCount = 1;
+		image_write->descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		image_write->pImageInfo = image_info;
+
+		VkWriteDescriptorSet *sampler_write = &set_writes[i * 2 + 1];
+		*sampler_write = *image_write;
+		sampler_write->dstBinding = SAMPLER_ARRAY_BINDING;
+		sampler_write->descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
 	}
 
-	vkUpdateDescriptorSets(app->device, app->texture_descriptor_update_count, set_writes, 0, NULL);
+	vkUpdateDescriptorSets(app->device, write_count, set_writes, 0, NULL);
 
     app->texture_descriptor_update_count = 0;
 	sb_release_scratch(&scratch);
 }
 
+typedef struct
+{
+    uint32_t phase;
+    sb_texture_id depth_pyramid;
+    VkExtent2D depth_extent;
+} cull_constants;
+
+// the cull pass counts each list's instances of every mesh, the compact pass writes a command per mesh part with
+// instances and the scatter pass fills in their draw ids. the cluster pass then writes an instanced command per kept
+// cluster for the meshes the compact pass left to it, over a range of just the instances that kept it. the draw wide passes are sized by sb_frame's draw count
+void dispatch_cull(sb_app *app, VkCommandBuffer command_buffer, sb_cull_phase phase)
+{
+    cull_constants constants = {0};
+    constants.phase = phase;
+    constants.depth_pyramid = app->depth_pyramid;
+    constants.depth_extent = sb_get_window_extent(app->window);
+    vkCmdPushConstants(command_buffer, app->global_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+    VkBufferMemoryBarrier2 scratch_barrier = sb_get_buffer_barrier(&app->cull_scratch_buffer);
+    scratch_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    scratch_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    scratch_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    scratch_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->cull_pipeline);
+    vkCmdDispatchIndirect(command_buffer, app->cull_dispatch_buffer.vk_buffer, 0);
+    sb_buffer_barriers(command_buffer, &scratch_barrier, 1);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->cull_compact_pipeline);
+    vkCmdDispatch(command_buffer, SB_MAX_DRAW_KEYS / SB_CULL_GROUP_SIZE, 1, 1); // a thread per draw key
+    sb_buffer_barriers(command_buffer, &scratch_barrier, 1);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->cull_scatter_pipeline);
+    vkCmdDispatchIndirect(command_buffer, app->cull_dispatch_buffer.vk_buffer, 0);
+
+    // the views phase covers every view's list, used or not
+    uint32_t first_list = phase == SB_CULL_PHASE_VIEWS ? SB_CULL_LIST_VIEWS : phase == SB_CULL_PHASE_EARLY ? SB_CULL_LIST_EARLY : SB_CULL_LIST_LATE;
+    uint32_t list_count = phase == SB_CULL_PHASE_VIEWS ? SB_MAX_CULL_VIEWS : 1;
+
+    // the cluster pass reads the draw ids the scatter pass just wrote and copies the kept ones after them, and appends to
+    // the counts and commands the compact pass left in the phase's lists
+    VkBufferMemoryBarrier2 cluster_barriers[SB_MAX_CULL_LISTS + 1];
+    VkBufferMemoryBarrier2 draw_id_barrier = sb_get_buffer_barrier(&app->draw_instance_buffer);
+    draw_id_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    draw_id_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    draw_id_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    draw_id_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    cluster_barriers[0] = draw_id_barrier;
+
+    for(uint32_t i = 0; i < list_count; i++)
+    {
+        VkBufferMemoryBarrier2 command_barrier = sb_get_buffer_barrier(&app->draw_command_buffers[first_list + i]);
+        command_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        command_barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        command_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        command_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        cluster_barriers[i + 1] = command_barrier;
+    }
+    sb_buffer_barriers(command_buffer, cluster_barriers, list_count + 1);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->cull_cluster_pipeline);
+    vkCmdDispatch(command_buffer, SB_MAX_SHADER_BINS * SB_MAX_MESHES, 1, 1); // a group per shader id and mesh
+
+    VkBufferMemoryBarrier2 draw_barriers[SB_MAX_CULL_LISTS + 2];
+    for(uint32_t i = 0; i < list_count; i++)
+    {
+        VkBufferMemoryBarrier2 indirect_barrier = sb_get_buffer_barrier(&app->draw_command_buffers[first_list + i]);
+        indirect_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        indirect_barrier.dstStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        indirect_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT |  VK_ACCESS_SHADER_WRITE_BIT;
+        indirect_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        draw_barriers[i] = indirect_barrier;
+    }
+
+    VkBufferMemoryBarrier2 instance_barrier = sb_get_buffer_barrier(&app->draw_instance_buffer);
+    instance_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    instance_barrier.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    instance_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    instance_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    draw_barriers[list_count] = instance_barrier;
+
+    VkBufferMemoryBarrier2 matrix_barrier = sb_get_buffer_barrier(&app->draw_matrix_buffer);
+    matrix_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    matrix_barrier.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    matrix_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    matrix_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    draw_barriers[list_count + 1] = matrix_barrier;
+    sb_buffer_barriers(command_buffer, draw_barriers, list_count + 2);
+}
+
+void sb_cull_early_draws(sb_app *app, VkCommandBuffer command_buffer)
+{
+    dispatch_cull(app, command_buffer, SB_CULL_PHASE_EARLY);
+}
+
+typedef struct
+{
+    sb_texture_id depth_buffer;
+    uint32_t level;
+} depth_pyramid_constants;
+
+// one dispatch per level, each reading the one above it or the depth buffer for level 0
+void build_depth_pyramid(sb_app *app, VkCommandBuffer command_buffer, sb_texture_id depth_buffer)
+{
+    sb_texture *pyramid = sb_get_texture(app, app->depth_pyramid);
+
+    // every level is rewritten, so last frame's contents are dropped on the way to general
+    VkImageMemoryBarrier2 barrier = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
+    barrier.image = pyramid->image;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    sb_image_barriers(command_buffer, &barrier, 1);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->depth_pyramid_pipeline);
+    for(uint32_t level = 0; level < pyramid->mip_levels; level++)
+    {
+        depth_pyramid_constants constants = {depth_buffer, level};
+        vkCmdPushConstants(command_buffer, app->global_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+        uint32_t width = SB_MAX(pyramid->extent.width >> level, 1);
+        uint32_t height = SB_MAX(pyramid->extent.height >> level, 1);
+        vkCmdDispatch(command_buffer, (width + 7) / 8, (height + 7) / 8, 1);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        if(level == pyramid->mip_levels - 1)
+        {
+            barrier.newLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+        sb_image_barriers(command_buffer, &barrier, 1);
+    }
+}
+
+void sb_cull_late_draws(sb_app *app, VkCommandBuffer command_buffer, sb_texture_id depth_buffer)
+{
+    build_depth_pyramid(app, command_buffer, depth_buffer);
+    dispatch_cull(app, command_buffer, SB_CULL_PHASE_LATE);
+
+    VkBufferMemoryBarrier2 stats_barrier = sb_get_buffer_barrier(&app->cull_stats_buffer);
+    stats_barrier.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    stats_barrier.dstStageMask = VK_PIPELINE_STAGE_HOST_BIT;
+    stats_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    stats_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    sb_buffer_barriers(command_buffer, &stats_barrier, 1);
+}
+
 sb_buffer *sb_get_frame_draw_info_buffer(sb_app *app)
 {
     return &app->draw_info_buffers[app->frame_index];
 }
 
+sb_gpu_timer_id sb_create_gpu_timer(sb_app *app)
+{
+    assert(app->gpu_timer_count < SB_MAX_GPU_TIMERS);
+    return app->gpu_timer_count++;
+}
+
+void sb_begin_gpu_timer(sb_app *app, VkCommandBuffer command_buffer, sb_gpu_timer_id id)
+{
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, app->timestamp_pool, id * 2);
+}
+
+void sb_end_gpu_timer(sb_app *app, VkCommandBuffer command_buffer, sb_gpu_timer_id id)
+{
+    vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, app->timestamp_pool, id * 2 + 1);
+}
+
+double sb_get_gpu_timer_ms(sb_app *app, sb_gpu_timer_id id)
+{
+    return app->gpu_timer_ms[id];
+}
+
+void sb_read_gpu_timers(sb_app *app)
+{
+    if(app->gpu_timer_count == 0) return;
+
+    // not ready before the first frame has been through, the previous values are kept until then
+    uint64_t timestamps[SB_MAX_GPU_TIMERS * 2];
+    VkResult result = vkGetQueryPoolResults(app->device, app->timestamp_pool, 0, app->gpu_timer_count * 2,
+        sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if(result != VK_SUCCESS) return;
+
+    for(uint32_t i = 0; i < app->gpu_timer_count; i++)
+        app->gpu_timer_ms[i] = (timestamps[i * 2 + 1] - timestamps[i * 2]) * app->timestamp_period_ms;
+}
+
+int compare_frame_ms(const void *lhs, const void *rhs)
+{
+    float a = *(const float*) lhs, b = *(const float*) rhs;
+    return (a > b) - (a < b);
+}
+
+// the window closes on the first frame that starts with nothing left to upload
+void record_streaming_frame(sb_app *app)
+{
+    double now_ms = sb_get_time_ms();
+    float frame_ms = (float) (now_ms - app->last_frame_start_ms);
+    app->last_frame_start_ms = now_ms;
+
+    if(app->is_frame_streaming)
+    {
+        if(app->streaming_frame_count < SB_MAX_STREAMING_FRAMES) app->streaming_frame_ms[app->streaming_frame_count++] = frame_ms;
+        return;
+    }
+    if(app->streaming_frame_count == 0) return;
+
+    uint32_t count = app->streaming_frame_count;
+    qsort(app->streaming_frame_ms, count, sizeof(float), compare_frame_ms);
+
+    sb_streaming_stats *stats = &app->streaming_stats;
+    stats->window_count++;
+    stats->frame_count = count;
+    stats->p99_ms = app->streaming_frame_ms[(count * 99 + 99) / 100 - 1];
+    stats->max_ms = app->streaming_frame_ms[count - 1];
+    app->streaming_frame_count = 0;
+}
+
 void sb_frame(sb_app *app)
 {
     sb_wait_for_fence(app->device, app->render_finished_fence);
     sb_reset_fence(app->device, app->render_finished_fence);
+    sb_read_gpu_timers(app);
+    app->cull_stats = *(const sb_cull_stats*) app->cull_stats_buffer.memory_ptr;
 
     int current_image = sb_acquire_next_image(app->device, app->swapchain, app->image_available_semaphore);
     if(current_image == -1)
@@ -752,10 +1400,19 @@ void sb_frame(sb_app *app)
         return;
     }
 
+    // transfers go first so textures that land this frame get their real descriptor right away
+    app->is_frame_streaming = sb_is_streaming(&app->transfer_buffer);
+    sb_transfer_assets(app->device, &app->transfer_buffer, &app->mesh_memory, app->texture_handles);
+    for(uint32_t i = 0; i < app->transfer_buffer.arrived_texture_count; i++)
+        app->texture_descriptor_updates[app->texture_descriptor_update_count++] = app->transfer_buffer.arrived_textures[i];
+
     sb_update_texture_descriptors(app);
     sb_update_draw_info_buffer_descriptor(app->device, app->global_set, sb_get_frame_draw_info_buffer(app));
 
-    sb_transfer_assets(app->device, &app->transfer_buffer, &app->mesh_memory, app->texture_handles);
+    // the baked command buffers can't know the draw count, the cull passes read their group count from here
+    const sb_draw_info_array *draw_infos = sb_get_frame_draw_info_buffer(app)->memory_ptr;
+    VkDispatchIndirectCommand *cull_dispatch = app->cull_dispatch_buffer.memory_ptr;
+    *cull_dispatch = (VkDispatchIndirectCommand) {(draw_infos->count + SB_CULL_GROUP_SIZE - 1) / SB_CULL_GROUP_SIZE, 1, 1};
 
     sb_queue_submit_info submit_info = {0};
     submit_info.wait_semaphore = app->image_available_semaphore;
@@ -774,6 +1431,10 @@ void sb_frame(sb_app *app)
     sb_buffer *draw_info_buffer = sb_get_frame_draw_info_buffer(app);
     sb_draw_info_array *info_array = draw_info_buffer->memory_ptr;
     info_array->count = 0;
+
+    app->material_count = 0;
+    memset(app->material_slots, 0, sizeof(app->material_slots));
+    app->transform_count = 0;
 }
 
 bool sb_run_app(sb_app *app, sb_window_event *window_event)
@@ -787,20 +1448,112 @@ bool sb_run_app(sb_app *app, sb_window_event *window_event)
         sb_on_resize(app);
     }
 
+    record_streaming_frame(app);
     sb_frame(app);
     return should_quit;
 }
 
 sb_mesh_id sb_create_mesh(sb_app *app, const char *name)
 {
-    sb_queue_mesh_transfer(&app->transfer_buffer, name);
-	return app->mesh_memory.mesh_count++;
+    return sb_create_mesh_prioritized(app, name, SB_ASSET_PRIORITY_NORMAL);
+}
+
+sb_mesh_id sb_create_mesh_prioritized(sb_app *app, const char *name, sb_asset_priority priority)
+{
+    sb_asset_cache_slot *cached;
+    if(sb_asset_cache_acquire(&app->mesh_cache, name, &cached)) return cached->id;
+
+    assert(app->mesh_memory.mesh_count < SB_MAX_MESHES);
+    sb_mesh_id id = app->mesh_memory.mesh_count++;
+
+    const sb_pack_entry *entry = sb_pack_find(&app->asset_pack, name);
+    if(entry) sb_queue_packed_mesh_transfer(&app->transfer_buffer, id, &app->asset_pack, entry, priority);
+    else sb_queue_mesh_transfer(&app->transfer_buffer, id, name, priority);
+
+	cached->id = id;
+	return id;
+}
+
+void sb_set_fallback_mesh(sb_app *app, sb_mesh_id id)
+{
+    app->mesh_memory.fallback_mesh = id;
+}
+
+uint32_t sb_release_mesh(sb_app *app, const char *name)
+{
+    return sb_asset_cache_release(&app->mesh_cache, name);
 }
 
-void sb_draw(sb_app *app, const sb_draw_info *draw_info)
+// the frame's materials start at frame_index * SB_MAX_MATERIALS, the ids handed out already include it
+uint32_t get_material_id(sb_app *app, const sb_material *material)
+{
+    sb_material key = *material;
+    key.pad = 0;
+
+    sb_material *materials = (sb_material*) app->material_buffer.memory_ptr + app->frame_index * SB_MAX_MATERIALS;
+    uint32_t slot = (uint32_t) sb_hash_bytes(&key, sizeof(key)) % SB_MATERIAL_SLOT_COUNT;
+    for(;; slot = (slot + 1) % SB_MATERIAL_SLOT_COUNT)
+    {
+        uint32_t index = app->material_slots[slot];
+        if(index == 0) break;
+        if(memcmp(&materials[index - 1], &key, sizeof(key)) == 0) return app->frame_index * SB_MAX_MATERIALS + index - 1;
+    }
+
+    assert(app->material_count < SB_MAX_MATERIALS);
+    uint32_t index = app->material_count++;
+    materials[index] = key;
+    app->material_slots[slot] = (uint16_t) (index + 1);
+    return app->frame_index * SB_MAX_MATERIALS + index;
+}
+
+uint32_t pack_snorm16x2(float x, float y)
+{
+    int16_t packed_x = (int16_t) roundf(SB_MAX(SB_MIN(x, 1.0f), -1.0f) * 32767.0f);
+    int16_t packed_y = (int16_t) roundf(SB_MAX(SB_MIN(y, 1.0f), -1.0f) * 32767.0f);
+    return (uint32_t) (uint16_t) packed_x | (uint32_t) (uint16_t) packed_y << 16;
+}
+
+void sb_set_draw_trs(sb_draw_info *draw_info, sb_vec3 position, sb_vec4 rotation, float scale)
+{
+    draw_info->position = position;
+    draw_info->scale = scale;
+    draw_info->rotation[0] = pack_snorm16x2(rotation.x, rotation.y);
+    draw_info->rotation[1] = pack_snorm16x2(rotation.z, rotation.w);
+    draw_info->flags &= ~SB_DRAW_FLAG_GENERAL_TRANSFORM;
+}
+
+void sb_draw(sb_app *app, const sb_draw_info *draw_info, const sb_material *material)
 {
     sb_buffer *draw_info_buffer = sb_get_frame_draw_info_buffer(app);
 
+    assert(draw_info->shader_id < SB_MAX_SHADER_BINS);
+
     sb_draw_info_array *draw_infos = draw_info_buffer->memory_ptr;
-    draw_infos->array[draw_infos->count++] = *draw_info;
+    sb_draw_info *info = &draw_infos->array[draw_infos->count++];
+    *info = *draw_info;
+    info->material_id = get_material_id(app, material);
+}
+
+// the frame's general transforms start at frame_index * SB_MAX_GENERAL_TRANSFORMS, like its materials
+void sb_draw_transformed(sb_app *app, const sb_draw_info *draw_info, const sb_material *material, sb_mat4 transform)
+{
+    sb_draw_info info = *draw_info;
+
+    sb_vec3 position;
+    sb_vec4 rotation;
+    float scale;
+    if(sb_mat4_get_trs(transform, &position, &rotation, &scale))
+    {
+        sb_set_draw_trs(&info, position, rotation, scale);
+    }
+    else
+    {
+        assert(app->transform_count < SB_MAX_GENERAL_TRANSFORMS);
+        info.transform_id = app->frame_index * SB_MAX_GENERAL_TRANSFORMS + app->transform_count++;
+        info.flags |= SB_DRAW_FLAG_GENERAL_TRANSFORM;
+        sb_mat4 *transforms = app->transform_buffer.memory_ptr;
+        sb_mat4_copy(transform, transforms[info.transform_id]);
+    }
+
+    sb_draw(app, &info, material);
 }
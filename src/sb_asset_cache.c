@@ -0,0 +1,71 @@
+#include "sb_asset_cache.h"
+#include "sb_common.h"
+
+void sb_init_asset_cache(sb_asset_cache *cache)
+{
+	SB_ZERO_STRUCT(cache);
+	cache->arena = sb_arena_alloc();
+}
+
+sb_asset_cache_slot *find_slot(sb_asset_cache *cache, sb_str8 path, uint64_t hash)
+{
+	uint32_t index = (uint32_t) hash & (SB_ASSET_CACHE_CAPACITY - 1);
+	uint32_t probe_length = 1;
+
+	sb_asset_cache_slot *slot = &cache->slots[index];
+	while(slot->path.size != 0 && !(slot->hash == hash && sb_str8_eq(slot->path, path)))
+	{
+		index = (index + 1) & (SB_ASSET_CACHE_CAPACITY - 1);
+		slot = &cache->slots[index];
+		probe_length++;
+	}
+
+	cache->stats.lookups++;
+	cache->stats.probes += probe_length;
+	cache->stats.longest_probe = SB_MAX(cache->stats.longest_probe, probe_length);
+	return slot;
+}
+
+bool sb_asset_cache_acquire(sb_asset_cache *cache, const char *path, sb_asset_cache_slot **out_slot)
+{
+	sb_str8 key = sb_str8_from_cstr(path);
+	assert(key.size > 0);
+
+	uint64_t hash = sb_str8_hash(key);
+	sb_asset_cache_slot *slot = find_slot(cache, key, hash);
+	*out_slot = slot;
+
+	if(slot->path.size != 0)
+	{
+		slot->ref_count++;
+		cache->stats.hits++;
+		return true;
+	}
+
+	assert(cache->count < SB_ASSET_CACHE_CAPACITY / 2);
+	cache->count++;
+	cache->stats.misses++;
+
+	slot->hash = hash;
+	slot->path = sb_str8_copy(cache->arena, key);
+	slot->ref_count = 1;
+	return false;
+}
+
+uint32_t sb_asset_cache_release(sb_asset_cache *cache, const char *path)
+{
+	sb_str8 key = sb_str8_from_cstr(path);
+	sb_asset_cache_slot *slot = find_slot(cache, key, sb_str8_hash(key));
+
+	assert(slot->path.size != 0 && slot->ref_count > 0);
+	return --slot->ref_count;
+}
+
+void sb_asset_cache_print_stats(const char *name, const sb_asset_cache *cache)
+{
+	const sb_asset_cache_stats *stats = &cache->stats;
+	printf("ASSET CACHE %s:\n{assets: %u, lookups: %llu, hits: %llu, misses: %llu, avg probe: %.2f, longest probe: %u}\n",
+		name, cache->count,
+		(unsigned long long) stats->lookups, (unsigned long long) stats->hits, (unsigned long long) stats->misses,
+		stats->lookups ? (double) stats->probes / (double) stats->lookups : 0.0, stats->longest_probe);
+}
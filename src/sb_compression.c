@@ -0,0 +1,190 @@
+#include "sb_compression.h"
+#include "sb_common.h"
+
+#include <string.h>
+
+static uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - SB_LZ_HASH_BITS);
+}
+
+static uint8_t *lz_write_length(uint8_t *out, size_t length)
+{
+    for(; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = (uint8_t) length;
+    return out;
+}
+
+static uint8_t *lz_write_sequence(uint8_t *out, const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length)
+{
+    uint8_t *token = out++;
+    *token = (uint8_t) (SB_MIN(literal_length, 15) << 4);
+    if(literal_length >= 15)
+        out = lz_write_length(out, literal_length - 15);
+
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    if(match_length == 0) return out;
+
+    *out++ = (uint8_t) offset;
+    *out++ = (uint8_t) (offset >> 8);
+
+    size_t match_code = match_length - SB_LZ_MIN_MATCH;
+    *token |= (uint8_t) SB_MIN(match_code, 15);
+    if(match_code >= 15)
+        out = lz_write_length(out, match_code - 15);
+
+    return out;
+}
+
+size_t sb_lz_compress_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t sb_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_capacity)
+{
+    assert(dst_capacity >= sb_lz_compress_bound(src_size));
+
+    const uint8_t *in = src;
+    uint8_t *out = dst;
+
+    uint32_t table[1 << SB_LZ_HASH_BITS];
+    memset(table, 0xff, sizeof(table));
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while(pos + SB_LZ_MIN_MATCH <= src_size)
+    {
+        uint32_t sequence;
+        memcpy(&sequence, in + pos, sizeof(sequence));
+
+        uint32_t hash = lz_hash(sequence);
+        uint32_t candidate = table[hash];
+        table[hash] = (uint32_t) pos;
+
+        if(candidate == UINT32_MAX || pos - candidate > UINT16_MAX || memcmp(in + candidate, in + pos, SB_LZ_MIN_MATCH) != 0)
+        {
+            pos++;
+            continue;
+        }
+
+        size_t match_length = SB_LZ_MIN_MATCH;
+        while(pos + match_length < src_size && in[candidate + match_length] == in[pos + match_length])
+            match_length++;
+
+        out = lz_write_sequence(out, in + anchor, pos - anchor, pos - candidate, match_length);
+        pos += match_length;
+        anchor = pos;
+    }
+
+    out = lz_write_sequence(out, in + anchor, src_size - anchor, 0, 0);
+    return out - (uint8_t*)dst;
+}
+
+size_t sb_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+    const uint8_t *in = src;
+    const uint8_t *in_end = in + src_size;
+    uint8_t *out = dst;
+    uint8_t *out_end = out + dst_size;
+
+    while(in < in_end)
+    {
+        uint8_t token = *in++;
+
+        size_t literal_length = token >> 4;
+        if(literal_length == 15)
+        {
+            uint8_t extra;
+            do { extra = *in++; literal_length += extra; } while(extra == 255);
+        }
+
+        assert(in + literal_length <= in_end && out + literal_length <= out_end);
+        memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if(in >= in_end) break;
+
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        size_t match_length = (token & 15) + SB_LZ_MIN_MATCH;
+        if((token & 15) == 15)
+        {
+            uint8_t extra;
+            do { extra = *in++; match_length += extra; } while(extra == 255);
+        }
+
+        // matches may overlap the bytes they produce, so copy forward one byte at a time
+        const uint8_t *match = out - offset;
+        assert(match >= (uint8_t*)dst && out + match_length <= out_end);
+        for(size_t i = 0; i < match_length; i++)
+            *out++ = *match++;
+    }
+
+    return out - (uint8_t*)dst;
+}
+
+size_t sb_compress_blocks_bound(size_t raw_size)
+{
+    uint32_t block_count = sb_compression_block_count(raw_size);
+    return (block_count + 1) * sizeof(uint32_t) + block_count * sb_lz_compress_bound(SB_COMPRESSION_BLOCK_SIZE);
+}
+
+size_t sb_compress_blocks(const void *src, size_t raw_size, void *dst, size_t dst_capacity)
+{
+    assert(dst_capacity >= sb_compress_blocks_bound(raw_size));
+
+    uint32_t block_count = sb_compression_block_count(raw_size);
+    uint32_t *block_offsets = dst;
+
+    size_t stored_size = (block_count + 1) * sizeof(uint32_t);
+    for(uint32_t i = 0; i < block_count; i++)
+    {
+        size_t block_start = (size_t) i * SB_COMPRESSION_BLOCK_SIZE;
+        size_t block_size = SB_MIN(raw_size - block_start, SB_COMPRESSION_BLOCK_SIZE);
+        const uint8_t *block = (const uint8_t*)src + block_start;
+        uint8_t *out = (uint8_t*)dst + stored_size;
+
+        block_offsets[i] = (uint32_t) stored_size;
+
+        size_t compressed_size = sb_lz_compress(block, block_size, out, dst_capacity - stored_size);
+        if(compressed_size >= block_size)
+        {
+            memcpy(out, block, block_size);
+            compressed_size = block_size;
+        }
+        stored_size += compressed_size;
+    }
+    block_offsets[block_count] = (uint32_t) stored_size;
+
+    return stored_size;
+}
+
+void sb_decompress_blocks(const void *src, void *dst, size_t raw_size)
+{
+    uint32_t block_count = sb_compression_block_count(raw_size);
+    const uint32_t *block_offsets = src;
+
+    for(uint32_t i = 0; i < block_count; i++)
+    {
+        size_t block_start = (size_t) i * SB_COMPRESSION_BLOCK_SIZE;
+        size_t block_size = SB_MIN(raw_size - block_start, SB_COMPRESSION_BLOCK_SIZE);
+        size_t stored_size = block_offsets[i + 1] - block_offsets[i];
+
+        const uint8_t *block = (const uint8_t*)src + block_offsets[i];
+        uint8_t *out = (uint8_t*)dst + block_start;
+
+        if(stored_size == block_size)
+            memcpy(out, block, block_size);
+        else
+        {
+            size_t decompressed_size = sb_lz_decompress(block, stored_size, out, block_size);
+            assert(decompressed_size == block_size);
+        }
+    }
+}
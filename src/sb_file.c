@@ -1,16 +1,94 @@
 #include "sb_file.h"
+#include "sb_common.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 uint64_t sb_get_file_size(FILE *file)
 {
-	assert(fseek(file, 0, SEEK_END) == 0);
+	int seek_result = fseek(file, 0, SEEK_END);
 	uint64_t file_size = ftell(file);
-	assert(file_size > 0);
-	assert(fseek(file, 0, SEEK_SET) == 0);
-	return file_size;
+	seek_result |= fseek(file, 0, SEEK_SET);
+	assert(seek_result == 0 && file_size > 0);
+	return seek_result == 0 ? file_size : 0;
+}
+
+
+bool sb_file_exists(const char *name)
+{
+	FILE *file = fopen(name, "rb");
+	if(!file) return false;
+
+	fclose(file);
+	return true;
+}
+
+void sb_create_directory(const char *name)
+{
+#if defined(_WIN32)
+	CreateDirectoryA(name, NULL);
+#else
+	mkdir(name, 0755);
+#endif
 }
 
+bool has_extension(const char *name, const char *extension)
+{
+	size_t length = strlen(name);
+	size_t extension_length = strlen(extension);
+	return length > extension_length && strcmp(name + length - extension_length, extension) == 0;
+}
+
+sb_str8 *sb_list_directory(sb_arena *arena, const char *directory, const char *extension, uint32_t *out_count)
+{
+	// names go into scratch one after another and are only gathered into arena once the count is known
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	sb_str8 *names = sb_arena_push(scratch.arena, sb_str8, 0);
+	uint32_t count = 0;
+
+#if defined(_WIN32)
+	char pattern[MAX_PATH];
+	snprintf(pattern, sizeof(pattern), "%s/*%s", directory, extension);
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA(pattern, &found);
+	for(BOOL more = find != INVALID_HANDLE_VALUE; more; more = FindNextFileA(find, &found))
+	{
+		if((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !has_extension(found.cFileName, extension)) continue;
+		sb_str8 *name = sb_arena_one(scratch.arena, sb_str8);
+		*name = sb_str8_copy(arena, sb_str8_from_cstr(found.cFileName));
+		count++;
+	}
+	if(find != INVALID_HANDLE_VALUE) FindClose(find);
+#else
+	DIR *dir = opendir(directory);
+	for(struct dirent *entry = dir ? readdir(dir) : NULL; entry; entry = readdir(dir))
+	{
+		if(entry->d_type == DT_DIR || !has_extension(entry->d_name, extension)) continue;
+		sb_str8 *name = sb_arena_one(scratch.arena, sb_str8);
+		*name = sb_str8_copy(arena, sb_str8_from_cstr(entry->d_name));
+		count++;
+	}
+	if(dir) closedir(dir);
+#endif
+
+	sb_str8 *result = sb_arena_push(arena, sb_str8, count);
+	memcpy(result, names, count * sizeof(sb_str8));
+	sb_release_scratch(&scratch);
+
+	*out_count = count;
+	return result;
+}
 
 FILE *sb_fopen(const char *name, const char *mode)
 {
@@ -34,7 +112,7 @@ void *sb_read_file_binary(sb_arena *arena, const char *name, uint64_t *out_size)
     *out_size = sb_get_file_size(file);
 	void *buffer = sb_read_file_bytes(arena, file, *out_size);
 
-	assert(fclose(file) == 0);
+	fclose(file);
 	return buffer;
 }
 
@@ -52,3 +130,78 @@ sb_str8 sb_read_file_string(sb_arena *arena, const char *name)
 	buffer[file_size+1] = 0;
 	return (sb_str8) {buffer, file_size};
 }
+
+#if defined(_WIN32)
+sb_mapped_file sb_map_file(const char *name, sb_file_access access)
+{
+	DWORD access_flag = access == SB_FILE_ACCESS_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+	HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | access_flag, NULL);
+	assert(file != INVALID_HANDLE_VALUE);
+
+	LARGE_INTEGER file_size;
+	BOOL got_size = GetFileSizeEx(file, &file_size);
+	if(!got_size || file_size.QuadPart <= 0) SB_PANIC("can't map a file that's empty or whose size can't be read");
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	assert(mapping);
+
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	assert(data);
+
+	// equivalent of MADV_WILLNEED, sequential readers touch every page so start faulting them in now
+	if(access == SB_FILE_ACCESS_SEQUENTIAL)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = {data, (SIZE_T) file_size.QuadPart};
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+
+	return (sb_mapped_file) {
+		.data = data,
+		.size = file_size.QuadPart,
+		.file_handle = file,
+		.mapping_handle = mapping,
+	};
+}
+
+void sb_unmap_file(sb_mapped_file *file)
+{
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->mapping_handle);
+	CloseHandle(file->file_handle);
+	SB_ZERO_STRUCT(file);
+}
+#else
+sb_mapped_file sb_map_file(const char *name, sb_file_access access)
+{
+	int file = open(name, O_RDONLY);
+	assert(file != -1);
+
+	struct stat file_stat;
+	int stat_result = fstat(file, &file_stat);
+	if(stat_result != 0 || file_stat.st_size <= 0) SB_PANIC("can't map a file that's empty or whose size can't be read");
+
+	void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	assert(data != MAP_FAILED);
+
+	if(access == SB_FILE_ACCESS_SEQUENTIAL)
+	{
+		madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+		madvise(data, file_stat.st_size, MADV_WILLNEED);
+	}
+	else
+		madvise(data, file_stat.st_size, MADV_RANDOM);
+
+	return (sb_mapped_file) {
+		.data = data,
+		.size = file_stat.st_size,
+		.file_handle = (void*)(intptr_t) file,
+	};
+}
+
+void sb_unmap_file(sb_mapped_file *file)
+{
+	munmap((void*) file->data, file->size);
+	close((int)(intptr_t) file->file_handle);
+	SB_ZERO_STRUCT(file);
+}
+#endif
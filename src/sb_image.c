@@ -0,0 +1,1534 @@
+#include "sb_image.h"
+#include "sb_common.h"
+#include "sb_math.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SB_AVX2_FUNCTION
+#define sb_bswap64(x) _byteswap_uint64(x)
+#else
+#define SB_AVX2_FUNCTION __attribute__((target("avx2")))
+#define sb_bswap64(x) __builtin_bswap64(x)
+#endif
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+#define PNG_CHUNK(a, b, c, d) ((uint32_t) (a) << 24 | (uint32_t) (b) << 16 | (uint32_t) (c) << 8 | (uint32_t) (d))
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// natural (row major) index of each zigzag position
+static const uint8_t ZIGZAG[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+bool has_avx2(void)
+{
+	static int cached = -1;
+	if(cached < 0)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int registers[4];
+		__cpuid(registers, 1);
+		bool saves_ymm = (registers[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+		__cpuidex(registers, 7, 0);
+		cached = saves_ymm && (registers[1] & (1 << 5));
+#else
+		__builtin_cpu_init();
+		cached = __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+	return cached;
+}
+
+static uint8_t clamp_byte(int32_t value)
+{
+	return (uint8_t) SB_MIN(SB_MAX(value, 0), 255);
+}
+
+static uint32_t read_be16(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] << 8 | bytes[1];
+}
+
+static uint32_t read_be32(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16 | (uint32_t) bytes[2] << 8 | bytes[3];
+}
+
+bool sb_get_image_info(const void *data, size_t size, sb_image_info *out_info)
+{
+	const uint8_t *bytes = data;
+	if(size >= 24 && memcmp(bytes, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+	{
+		if(read_be32(bytes + 12) != PNG_CHUNK('I', 'H', 'D', 'R')) return false;
+		out_info->width = read_be32(bytes + 16);
+		out_info->height = read_be32(bytes + 20);
+		return out_info->width > 0 && out_info->height > 0;
+	}
+
+	if(size < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8) return false;
+
+	// walk the segments up to the frame header
+	const uint8_t *cursor = bytes + 2;
+	const uint8_t *end = bytes + size;
+	while(end - cursor >= 4)
+	{
+		if(cursor[0] != 0xFF) return false;
+		uint8_t marker = cursor[1];
+		if(marker == 0xFF) { cursor++; continue; }
+
+		uint32_t length = read_be16(cursor + 2);
+		if(marker == 0xC0 || marker == 0xC1 || marker == 0xC2)
+		{
+			if(end - cursor < 9) return false;
+			out_info->height = read_be16(cursor + 5);
+			out_info->width = read_be16(cursor + 7);
+			return out_info->width > 0 && out_info->height > 0;
+		}
+		if(marker == 0xDA || marker == 0xD9) return false;
+		cursor += 2 + length;
+	}
+	return false;
+}
+
+bool sb_decode_image(const void *data, size_t size, uint8_t *rgba, size_t rgba_size)
+{
+	const uint8_t *bytes = data;
+	if(size >= sizeof(PNG_SIGNATURE) && memcmp(bytes, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+		return decode_png(bytes, size, rgba, rgba_size);
+	if(size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xD8)
+		return decode_jpeg(bytes, size, rgba, rgba_size);
+	return false;
+}
+
+// inflate
+
+bool build_inflate_huffman(inflate_huffman *huffman, const uint8_t *lengths, uint32_t count)
+{
+	SB_ZERO_STRUCT(huffman);
+	for(uint32_t i = 0; i < count; i++)
+		huffman->counts[lengths[i]]++;
+	huffman->counts[0] = 0;
+
+	// incomplete codes are fine (a lone distance code), oversubscribed ones aren't
+	int32_t left = 1;
+	for(uint32_t length = 1; length < 16; length++)
+	{
+		left = (left << 1) - huffman->counts[length];
+		if(left < 0) return false;
+	}
+
+	uint16_t offsets[16] = {0};
+	for(uint32_t length = 1; length < 15; length++)
+		offsets[length + 1] = offsets[length] + huffman->counts[length];
+	for(uint32_t symbol = 0; symbol < count; symbol++)
+		if(lengths[symbol]) huffman->symbols[offsets[lengths[symbol]]++] = (uint16_t) symbol;
+
+	// deflate sends codes msb first inside an lsb first stream, so the table is indexed by the reversed code
+	uint32_t code = 0;
+	uint32_t index = 0;
+	for(uint32_t length = 1; length <= INFLATE_FAST_BITS; length++)
+	{
+		for(uint32_t i = 0; i < huffman->counts[length]; i++, code++, index++)
+		{
+			uint32_t reversed = 0;
+			for(uint32_t bit = 0; bit < length; bit++)
+				reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+
+			uint16_t entry = (uint16_t) (huffman->symbols[index] << 4 | length);
+			for(uint32_t fill = reversed; fill < (1 << INFLATE_FAST_BITS); fill += 1 << length)
+				huffman->fast[fill] = entry;
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+void inflate_refill(inflate_state *state)
+{
+	// whole words while there's room, the bytes past the ones counted are the same ones the next refill ors in
+	if(state->src_end - state->src >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, state->src, sizeof(word));
+		state->bits |= word << state->bit_count;
+		state->src += (63 - state->bit_count) >> 3;
+		state->bit_count |= 56;
+		return;
+	}
+
+	while(state->bit_count <= 56)
+	{
+		uint64_t byte = 0;
+		if(state->src < state->src_end) byte = *state->src++;
+		else state->overrun++;
+		state->bits |= byte << state->bit_count;
+		state->bit_count += 8;
+	}
+}
+
+uint32_t inflate_take(inflate_state *state, uint32_t count)
+{
+	uint32_t value = (uint32_t) (state->bits & ((1ull << count) - 1));
+	state->bits >>= count;
+	state->bit_count -= count;
+	return value;
+}
+
+int32_t inflate_decode(inflate_state *state, const inflate_huffman *huffman)
+{
+	uint32_t entry = huffman->fast[state->bits & ((1 << INFLATE_FAST_BITS) - 1)];
+	if(entry)
+	{
+		inflate_take(state, entry & 15);
+		return entry >> 4;
+	}
+
+	// codes longer than the table are walked one bit at a time against the canonical ranges
+	int32_t code = 0;
+	int32_t first = 0;
+	int32_t index = 0;
+	uint64_t bits = state->bits;
+	for(uint32_t length = 1; length < 16; length++)
+	{
+		code |= (int32_t) (bits & 1);
+		bits >>= 1;
+
+		int32_t count = huffman->counts[length];
+		if(code - count < first)
+		{
+			inflate_take(state, length);
+			return huffman->symbols[index + (code - first)];
+		}
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+bool inflate_block(inflate_state *stream, const inflate_huffman *lengths, const inflate_huffman *distances)
+{
+	// the literal stores are byte writes that could alias the state, a local copy keeps it in registers
+	inflate_state local = *stream;
+	inflate_state *state = &local;
+	bool is_valid = true;
+	while(is_valid)
+	{
+		// one refill covers a length code, a distance code and both of their extra bits
+		inflate_refill(state);
+		int32_t symbol = inflate_decode(state, lengths);
+		if(symbol < 256)
+		{
+			is_valid = symbol >= 0 && state->dst < state->dst_end;
+			if(is_valid) *state->dst++ = (uint8_t) symbol;
+			continue;
+		}
+		if(symbol == 256) break;
+
+		symbol -= 257;
+		is_valid = symbol < 29;
+		if(!is_valid) break;
+		uint32_t length = LENGTH_BASE[symbol] + inflate_take(state, LENGTH_EXTRA[symbol]);
+
+		int32_t distance_symbol = inflate_decode(state, distances);
+		is_valid = distance_symbol >= 0 && distance_symbol < 30;
+		if(!is_valid) break;
+		uint32_t distance = DISTANCE_BASE[distance_symbol] + inflate_take(state, DISTANCE_EXTRA[distance_symbol]);
+
+		is_valid = distance <= (size_t) (state->dst - state->dst_start) && length <= (size_t) (state->dst_end - state->dst);
+		if(!is_valid) break;
+
+		uint8_t *dst = state->dst;
+		const uint8_t *match = dst - distance;
+		if(distance >= 8)
+		{
+			// far enough back that every 8 byte step reads bytes already written, the last step spills into the slack
+			for(uint32_t i = 0; i < length; i += 8)
+				memcpy(dst + i, match + i, 8);
+		}
+		else if(distance == 1) memset(dst, match[0], length);
+		else
+		{
+			for(uint32_t i = 0; i < length; i++)
+				dst[i] = match[i];
+		}
+		state->dst += length;
+	}
+
+	*stream = local;
+	return is_valid;
+}
+
+bool inflate_dynamic_tables(inflate_state *state, inflate_huffman *lengths, inflate_huffman *distances)
+{
+	inflate_refill(state);
+	uint32_t length_count = inflate_take(state, 5) + 257;
+	uint32_t distance_count = inflate_take(state, 5) + 1;
+	uint32_t code_length_count = inflate_take(state, 4) + 4;
+	if(length_count > 286 || distance_count > 30) return false;
+
+	uint8_t code_lengths[19] = {0};
+	for(uint32_t i = 0; i < code_length_count; i++)
+	{
+		inflate_refill(state);
+		code_lengths[CODE_LENGTH_ORDER[i]] = (uint8_t) inflate_take(state, 3);
+	}
+
+	inflate_huffman code_length_huffman;
+	if(!build_inflate_huffman(&code_length_huffman, code_lengths, COUNTOF(code_lengths))) return false;
+
+	uint8_t code_length_values[286 + 30];
+	uint32_t total = length_count + distance_count;
+	for(uint32_t i = 0; i < total;)
+	{
+		inflate_refill(state);
+		int32_t symbol = inflate_decode(state, &code_length_huffman);
+		if(symbol < 0) return false;
+		if(symbol < 16)
+		{
+			code_length_values[i++] = (uint8_t) symbol;
+			continue;
+		}
+
+		uint8_t value = 0;
+		uint32_t repeat;
+		if(symbol == 16)
+		{
+			if(i == 0) return false;
+			value = code_length_values[i - 1];
+			repeat = 3 + inflate_take(state, 2);
+		}
+		else if(symbol == 17) repeat = 3 + inflate_take(state, 3);
+		else repeat = 11 + inflate_take(state, 7);
+
+		if(i + repeat > total) return false;
+		memset(code_length_values + i, value, repeat);
+		i += repeat;
+	}
+
+	if(code_length_values[256] == 0) return false;
+	return build_inflate_huffman(lengths, code_length_values, length_count) &&
+		build_inflate_huffman(distances, code_length_values + length_count, distance_count);
+}
+
+bool zlib_inflate(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+{
+	if(src_size < 2) return false;
+	uint32_t cmf = src[0];
+	uint32_t flags = src[1];
+	if((cmf & 15) != 8 || (cmf << 8 | flags) % 31 != 0 || (flags & 32)) return false;
+
+	inflate_state state = {0};
+	state.src = src + 2;
+	state.src_end = src + src_size;
+	state.dst_start = dst;
+	state.dst = dst;
+	state.dst_end = dst + dst_size;
+
+	inflate_huffman lengths;
+	inflate_huffman distances;
+
+	bool is_final = false;
+	while(!is_final)
+	{
+		inflate_refill(&state);
+		is_final = inflate_take(&state, 1);
+		uint32_t type = inflate_take(&state, 2);
+
+		if(type == 0)
+		{
+			// stored blocks restart on a byte boundary, the whole bytes still in the bit buffer are handed back
+			inflate_take(&state, state.bit_count & 7);
+			if((state.bit_count >> 3) < state.overrun) return false;
+			state.src -= (state.bit_count >> 3) - state.overrun;
+			state.bits = 0;
+			state.bit_count = 0;
+			state.overrun = 0;
+
+			if(state.src_end - state.src < 4) return false;
+			uint32_t length = state.src[0] | (uint32_t) state.src[1] << 8;
+			uint32_t inverse = state.src[2] | (uint32_t) state.src[3] << 8;
+			state.src += 4;
+			if(length != (~inverse & 0xFFFF)) return false;
+			if(length > (size_t) (state.src_end - state.src) || length > (size_t) (state.dst_end - state.dst)) return false;
+
+			memcpy(state.dst, state.src, length);
+			state.src += length;
+			state.dst += length;
+		}
+		else if(type == 1)
+		{
+			uint8_t fixed_lengths[288];
+			memset(fixed_lengths, 8, 144);
+			memset(fixed_lengths + 144, 9, 112);
+			memset(fixed_lengths + 256, 7, 24);
+			memset(fixed_lengths + 280, 8, 8);
+			uint8_t fixed_distances[30];
+			memset(fixed_distances, 5, sizeof(fixed_distances));
+
+			build_inflate_huffman(&lengths, fixed_lengths, COUNTOF(fixed_lengths));
+			build_inflate_huffman(&distances, fixed_distances, COUNTOF(fixed_distances));
+			if(!inflate_block(&state, &lengths, &distances)) return false;
+		}
+		else if(type == 2)
+		{
+			if(!inflate_dynamic_tables(&state, &lengths, &distances)) return false;
+			if(!inflate_block(&state, &lengths, &distances)) return false;
+		}
+		else return false;
+	}
+
+	// the adler32 trailer isn't checked, a bad stream has already failed one of the checks above
+	return state.dst == state.dst_end && state.overrun * 8 <= state.bit_count;
+}
+
+// png
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+	int32_t pa = abs((int32_t) b - c);
+	int32_t pb = abs((int32_t) a - c);
+	int32_t pc = abs((int32_t) a + b - 2 * c);
+	if(pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+void unfilter_row_scalar(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter)
+{
+	switch(filter)
+	{
+		case 1:
+			for(uint32_t i = bpp; i < row_size; i++)
+				row[i] += row[i - bpp];
+			break;
+		case 2:
+			for(uint32_t i = 0; i < row_size; i++)
+				row[i] += prior[i];
+			break;
+		case 3:
+			for(uint32_t i = 0; i < bpp; i++)
+				row[i] += prior[i] >> 1;
+			for(uint32_t i = bpp; i < row_size; i++)
+				row[i] += (uint8_t) (((uint32_t) row[i - bpp] + prior[i]) >> 1);
+			break;
+		case 4:
+			for(uint32_t i = 0; i < bpp; i++)
+				row[i] += prior[i];
+			for(uint32_t i = bpp; i < row_size; i++)
+				row[i] += paeth(row[i - bpp], prior[i], prior[i - bpp]);
+			break;
+	}
+}
+
+static inline __m128i load_pixel(const uint8_t *bytes, uint32_t bpp)
+{
+	uint32_t value = 0;
+	if(bpp == 4) memcpy(&value, bytes, 4);
+	else
+	{
+		uint16_t low;
+		memcpy(&low, bytes, 2);
+		value = low | (uint32_t) bytes[2] << 16;
+	}
+	return _mm_cvtsi32_si128((int) value);
+}
+
+static inline void store_pixel(uint8_t *bytes, __m128i pixel, uint32_t bpp)
+{
+	uint32_t value = (uint32_t) _mm_cvtsi128_si32(pixel);
+	if(bpp == 4) memcpy(bytes, &value, 4);
+	else
+	{
+		uint16_t low = (uint16_t) value;
+		memcpy(bytes, &low, 2);
+		bytes[2] = (uint8_t) (value >> 16);
+	}
+}
+
+static __m128i abs_epi16(__m128i value)
+{
+	return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+}
+
+static __m128i select_si128(__m128i mask, __m128i if_set, __m128i if_clear)
+{
+	return _mm_or_si128(_mm_and_si128(mask, if_set), _mm_andnot_si128(mask, if_clear));
+}
+
+void unfilter_row_sse2(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter)
+{
+	if(filter == 2)
+	{
+		uint32_t i = 0;
+		for(; i + 16 <= row_size; i += 16)
+		{
+			__m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*) (row + i)), _mm_loadu_si128((const __m128i*) (prior + i)));
+			_mm_storeu_si128((__m128i*) (row + i), sum);
+		}
+		for(; i < row_size; i++)
+			row[i] += prior[i];
+		return;
+	}
+
+	if(filter == 0) return;
+	if(bpp != 3 && bpp != 4)
+	{
+		unfilter_row_scalar(row, prior, row_size, bpp, filter);
+		return;
+	}
+
+	// constant pixel sizes let the pixel loads and stores compile down to single moves
+	if(bpp == 4) unfilter_pixels_sse2(row, prior, row_size, 4, filter);
+	else unfilter_pixels_sse2(row, prior, row_size, 3, filter);
+}
+
+// sub, average and paeth depend on the pixel to the left, so a whole pixel is carried in a register instead of a byte
+static inline void unfilter_pixels_sse2(uint8_t *row, const uint8_t *prior, uint32_t row_size, uint32_t bpp, uint8_t filter)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i left = zero;
+	if(filter == 1)
+	{
+		for(uint32_t i = 0; i < row_size; i += bpp)
+		{
+			left = _mm_add_epi8(left, load_pixel(row + i, bpp));
+			store_pixel(row + i, left, bpp);
+		}
+	}
+	else if(filter == 3)
+	{
+		// avg rounds up, taking the low bit of a ^ b back off makes it the floor png wants
+		__m128i ones = _mm_set1_epi8(1);
+		for(uint32_t i = 0; i < row_size; i += bpp)
+		{
+			__m128i above = load_pixel(prior + i, bpp);
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(left, above), _mm_and_si128(_mm_xor_si128(left, above), ones));
+			left = _mm_add_epi8(average, load_pixel(row + i, bpp));
+			store_pixel(row + i, left, bpp);
+		}
+	}
+	else
+	{
+		// predictors are picked in 16 bit lanes, where a + b - 2c can't overflow
+		__m128i a = zero;
+		__m128i c = zero;
+		for(uint32_t i = 0; i < row_size; i += bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8(load_pixel(prior + i, bpp), zero);
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = abs_epi16(_mm_add_epi16(pa, pb));
+			pa = abs_epi16(pa);
+			pb = abs_epi16(pb);
+
+			// ties go to a, then b, then c
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i predictor = select_si128(_mm_cmpeq_epi16(pb, smallest), b, c);
+			predictor = select_si128(_mm_cmpeq_epi16(pa, smallest), a, predictor);
+
+			left = _mm_add_epi8(_mm_packus_epi16(predictor, predictor), load_pixel(row + i, bpp));
+			store_pixel(row + i, left, bpp);
+			a = _mm_unpacklo_epi8(left, zero);
+			c = b;
+		}
+	}
+}
+
+SB_AVX2_FUNCTION void unfilter_up_avx2(uint8_t *row, const uint8_t *prior, uint32_t row_size)
+{
+	uint32_t i = 0;
+	for(; i + 32 <= row_size; i += 32)
+	{
+		__m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*) (row + i)), _mm256_loadu_si256((const __m256i*) (prior + i)));
+		_mm256_storeu_si256((__m256i*) (row + i), sum);
+	}
+	for(; i < row_size; i++)
+		row[i] += prior[i];
+}
+
+SB_AVX2_FUNCTION void expand_rgb_row_avx2(uint8_t *rgba, const uint8_t *rgb, uint32_t width)
+{
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+
+	// each load reads 16 bytes for the 12 it uses, so the last pixels are left to the scalar loop
+	uint32_t x = 0;
+	for(; x + 6 <= width; x += 4)
+	{
+		__m128i pixels = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (rgb + x * 3)), shuffle);
+		_mm_storeu_si128((__m128i*) (rgba + x * 4), _mm_or_si128(pixels, alpha));
+	}
+	for(; x < width; x++)
+	{
+		rgba[x * 4 + 0] = rgb[x * 3 + 0];
+		rgba[x * 4 + 1] = rgb[x * 3 + 1];
+		rgba[x * 4 + 2] = rgb[x * 3 + 2];
+		rgba[x * 4 + 3] = 255;
+	}
+}
+
+void expand_rgb_row(uint8_t *rgba, const uint8_t *rgb, uint32_t width, bool use_avx2)
+{
+	if(use_avx2)
+	{
+		expand_rgb_row_avx2(rgba, rgb, width);
+		return;
+	}
+
+	for(uint32_t x = 0; x < width; x++)
+	{
+		rgba[x * 4 + 0] = rgb[x * 3 + 0];
+		rgba[x * 4 + 1] = rgb[x * 3 + 1];
+		rgba[x * 4 + 2] = rgb[x * 3 + 2];
+		rgba[x * 4 + 3] = 255;
+	}
+}
+
+void grey_to_rgba_row(uint8_t *rgba, const uint8_t *grey, uint32_t width)
+{
+	const __m128i alpha = _mm_set1_epi8((char) 0xFF);
+
+	uint32_t x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		__m128i values = _mm_loadu_si128((const __m128i*) (grey + x));
+		__m128i doubled_lo = _mm_unpacklo_epi8(values, values);
+		__m128i doubled_hi = _mm_unpackhi_epi8(values, values);
+		__m128i opaque_lo = _mm_unpacklo_epi8(values, alpha);
+		__m128i opaque_hi = _mm_unpackhi_epi8(values, alpha);
+
+		_mm_storeu_si128((__m128i*) (rgba + x * 4), _mm_unpacklo_epi16(doubled_lo, opaque_lo));
+		_mm_storeu_si128((__m128i*) (rgba + x * 4 + 16), _mm_unpackhi_epi16(doubled_lo, opaque_lo));
+		_mm_storeu_si128((__m128i*) (rgba + x * 4 + 32), _mm_unpacklo_epi16(doubled_hi, opaque_hi));
+		_mm_storeu_si128((__m128i*) (rgba + x * 4 + 48), _mm_unpackhi_epi16(doubled_hi, opaque_hi));
+	}
+	for(; x < width; x++)
+	{
+		rgba[x * 4 + 0] = grey[x];
+		rgba[x * 4 + 1] = grey[x];
+		rgba[x * 4 + 2] = grey[x];
+		rgba[x * 4 + 3] = 255;
+	}
+}
+
+bool decode_png(const uint8_t *data, size_t size, uint8_t *rgba, size_t rgba_size)
+{
+	if(size < 33 || read_be32(data + 8) != 13 || read_be32(data + 12) != PNG_CHUNK('I', 'H', 'D', 'R')) return false;
+
+	uint32_t width = read_be32(data + 16);
+	uint32_t height = read_be32(data + 20);
+	uint8_t bit_depth = data[24];
+	uint8_t colour_type = data[25];
+	if(bit_depth != 8 || data[26] != 0 || data[27] != 0 || data[28] != 0) return false; // 8 bit, deflate, adaptive filtering, not interlaced
+	if(width == 0 || height == 0 || (uint64_t) width * height * 4 > rgba_size) return false;
+
+	uint32_t channels;
+	switch(colour_type)
+	{
+		case 0: channels = 1; break; // grey
+		case 2: channels = 3; break; // rgb
+		case 3: channels = 1; break; // palette
+		case 4: channels = 2; break; // grey alpha
+		case 6: channels = 4; break; // rgba
+		default: return false;
+	}
+
+	// first pass finds the palette, the transparency and how big the image data is
+	uint8_t palette[256 * 4];
+	memset(palette, 255, sizeof(palette));
+	bool has_colour_key = false;
+	uint8_t colour_key[3] = {0};
+	size_t idat_size = 0;
+
+	const uint8_t *end = data + size;
+	const uint8_t *chunk = data + 8;
+	while(end - chunk >= 12)
+	{
+		uint32_t length = read_be32(chunk);
+		uint32_t type = read_be32(chunk + 4);
+		const uint8_t *payload = chunk + 8;
+		if(length > (size_t) (end - payload) - 4) return false;
+
+		if(type == PNG_CHUNK('I', 'D', 'A', 'T')) idat_size += length;
+		else if(type == PNG_CHUNK('P', 'L', 'T', 'E'))
+		{
+			if(length % 3 != 0 || length > 256 * 3) return false;
+			for(uint32_t i = 0; i < length / 3; i++)
+				memcpy(palette + i * 4, payload + i * 3, 3);
+		}
+		else if(type == PNG_CHUNK('t', 'R', 'N', 'S'))
+		{
+			// 16 bit samples whose high byte is always zero at 8 bits per channel
+			if(colour_type == 3)
+				for(uint32_t i = 0; i < length && i < 256; i++)
+					palette[i * 4 + 3] = payload[i];
+			else if(colour_type == 0 && length >= 2)
+			{
+				has_colour_key = true;
+				memset(colour_key, payload[1], sizeof(colour_key));
+			}
+			else if(colour_type == 2 && length >= 6)
+			{
+				has_colour_key = true;
+				colour_key[0] = payload[1];
+				colour_key[1] = payload[3];
+				colour_key[2] = payload[5];
+			}
+		}
+		else if(type == PNG_CHUNK('I', 'E', 'N', 'D')) break;
+
+		chunk = payload + length + 4;
+	}
+	if(idat_size == 0) return false;
+
+	sb_arena_temp scratch = sb_get_scratch();
+	uint8_t *idat = sb_arena_push(scratch.arena, uint8_t, idat_size);
+	size_t idat_offset = 0;
+	for(chunk = data + 8; idat_offset < idat_size; chunk += read_be32(chunk) + 12)
+	{
+		uint32_t length = read_be32(chunk);
+		if(read_be32(chunk + 4) != PNG_CHUNK('I', 'D', 'A', 'T')) continue;
+		memcpy(idat + idat_offset, chunk + 8, length);
+		idat_offset += length;
+	}
+
+	// the 8 bytes of slack past the rows are for inflate's match copies
+	uint32_t row_size = width * channels;
+	size_t filtered_size = (size_t) (row_size + 1) * height;
+	uint8_t *filtered = sb_arena_push_aligned(scratch.arena, filtered_size + 8, 16);
+	uint8_t *zero_row = sb_arena_push(scratch.arena, uint8_t, row_size);
+	memset(zero_row, 0, row_size);
+
+	bool is_valid = zlib_inflate(idat, idat_size, filtered, filtered_size);
+	bool use_avx2 = has_avx2();
+
+	// rows are unfiltered in place against the row above, already reconstructed, then expanded into the output
+	const uint8_t *prior = zero_row;
+	for(uint32_t y = 0; is_valid && y < height; y++)
+	{
+		uint8_t *row = filtered + (size_t) y * (row_size + 1);
+		uint8_t filter = row[0];
+		row++;
+		if(filter > 4)
+		{
+			is_valid = false;
+			break;
+		}
+
+		if(filter == 2 && use_avx2) unfilter_up_avx2(row, prior, row_size);
+		else unfilter_row_sse2(row, prior, row_size, channels, filter);
+		prior = row;
+
+		uint8_t *out = rgba + (size_t) y * width * 4;
+		switch(colour_type)
+		{
+			case 6:
+				memcpy(out, row, row_size);
+				break;
+			case 2:
+				expand_rgb_row(out, row, width, use_avx2);
+				if(has_colour_key)
+					for(uint32_t x = 0; x < width; x++)
+						if(memcmp(row + x * 3, colour_key, 3) == 0) out[x * 4 + 3] = 0;
+				break;
+			case 0:
+				grey_to_rgba_row(out, row, width);
+				if(has_colour_key)
+					for(uint32_t x = 0; x < width; x++)
+						if(row[x] == colour_key[0]) out[x * 4 + 3] = 0;
+				break;
+			case 4:
+				for(uint32_t x = 0; x < width; x++)
+				{
+					memset(out + x * 4, row[x * 2], 3);
+					out[x * 4 + 3] = row[x * 2 + 1];
+				}
+				break;
+			case 3:
+				for(uint32_t x = 0; x < width; x++)
+					memcpy(out + x * 4, palette + row[x] * 4, 4);
+				break;
+		}
+	}
+
+	sb_release_scratch(&scratch);
+	return is_valid;
+}
+
+// jpeg
+
+bool build_jpeg_huffman(jpeg_huffman *huffman, const uint8_t *counts, const uint8_t *values, uint32_t value_count)
+{
+	SB_ZERO_STRUCT(huffman);
+	memcpy(huffman->values, values, value_count);
+
+	uint32_t code = 0;
+	uint32_t index = 0;
+	for(uint32_t length = 1; length <= 16; length++)
+	{
+		uint32_t count = counts[length - 1];
+		huffman->value_offset[length] = (int32_t) index - (int32_t) code;
+		huffman->max_code[length] = count ? (int32_t) (code + count - 1) : -1;
+
+		for(uint32_t i = 0; i < count && length <= 9; i++)
+		{
+			uint32_t first = (code + i) << (9 - length);
+			for(uint32_t fill = 0; fill < (1u << (9 - length)); fill++)
+				huffman->fast[first + fill] = (uint16_t) (length << 8 | values[index + i]);
+		}
+
+		code += count;
+		index += count;
+		if(code > (1u << length) || index > value_count) return false;
+		code <<= 1;
+	}
+	huffman->max_code[17] = INT32_MAX;
+
+	// short ac codes whose coefficient bits fit in the same 9 bit window are decoded in a single lookup
+	for(uint32_t window = 0; window < (1 << 9); window++)
+	{
+		uint32_t entry = huffman->fast[window];
+		uint32_t length = entry >> 8;
+		uint32_t run = (entry >> 4) & 15;
+		uint32_t size = entry & 15;
+		if(!entry || size == 0 || length + size > 9) continue;
+
+		int32_t value = (int32_t) ((window >> (9 - length - size)) & ((1u << size) - 1));
+		if(value < (1 << (size - 1))) value -= (1 << size) - 1;
+		if(value >= -128 && value <= 127)
+			huffman->fast_ac[window] = (int16_t) (value * 256 + (int32_t) (run << 4) + (int32_t) (length + size));
+	}
+	return true;
+}
+
+void jpeg_refill(jpeg_bits *bits)
+{
+	// eight bytes without an 0xff can't hold stuffing or a marker, so they go in as one word
+	if(!bits->hit_marker && bits->src_end - bits->src >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, bits->src, sizeof(word));
+		uint64_t inverted = ~word;
+		bool has_ff = ((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) != 0;
+		if(!has_ff)
+		{
+			bits->bits |= sb_bswap64(word) >> bits->bit_count;
+			bits->src += (63 - bits->bit_count) >> 3;
+			bits->bit_count |= 56;
+			return;
+		}
+	}
+
+	while(bits->bit_count <= 56)
+	{
+		uint64_t byte = 0;
+		if(!bits->hit_marker && bits->src < bits->src_end)
+		{
+			byte = *bits->src;
+			if(byte != 0xFF) bits->src++;
+			else if(bits->src + 1 < bits->src_end && bits->src[1] == 0x00) bits->src += 2;
+			else
+			{
+				// the scan is over, the cursor stays on the marker and zeros pad out the last codes
+				bits->hit_marker = true;
+				byte = 0;
+			}
+		}
+		bits->bits |= byte << (56 - bits->bit_count);
+		bits->bit_count += 8;
+	}
+}
+
+int32_t jpeg_decode(jpeg_bits *bits, const jpeg_huffman *huffman)
+{
+	if(bits->bit_count < 16) jpeg_refill(bits);
+
+	uint32_t entry = huffman->fast[bits->bits >> (64 - 9)];
+	if(entry)
+	{
+		uint32_t length = entry >> 8;
+		bits->bits <<= length;
+		bits->bit_count -= length;
+		return entry & 0xFF;
+	}
+
+	for(uint32_t length = 10; length <= 16; length++)
+	{
+		int32_t code = (int32_t) (bits->bits >> (64 - length));
+		if(code <= huffman->max_code[length])
+		{
+			bits->bits <<= length;
+			bits->bit_count -= length;
+			return huffman->values[code + huffman->value_offset[length]];
+		}
+	}
+	return -1;
+}
+
+int32_t jpeg_receive_extend(jpeg_bits *bits, uint32_t size)
+{
+	if(bits->bit_count < size) jpeg_refill(bits);
+
+	int32_t value = (int32_t) (bits->bits >> (64 - size));
+	bits->bits <<= size;
+	bits->bit_count -= size;
+	return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+}
+
+bool jpeg_decode_block(jpeg_bits *bits, jpeg_decoder *decoder, jpeg_component *component, uint8_t *out, uint32_t stride)
+{
+	_Alignas(16) int16_t coefficients[64] = {0};
+	const uint16_t *quant = decoder->quant[component->quant_table];
+
+	int32_t dc_size = jpeg_decode(bits, &decoder->dc[component->dc_table]);
+	if(dc_size < 0 || dc_size > 11) return false;
+	if(dc_size > 0) component->dc_prediction += jpeg_receive_extend(bits, dc_size);
+	coefficients[0] = (int16_t) (component->dc_prediction * quant[0]);
+
+	const jpeg_huffman *ac = &decoder->ac[component->ac_table];
+	bool has_ac = false;
+	for(uint32_t k = 1; k < 64;)
+	{
+		if(bits->bit_count < 16) jpeg_refill(bits);
+		int32_t fast = ac->fast_ac[bits->bits >> (64 - 9)];
+		if(fast)
+		{
+			bits->bits <<= fast & 15;
+			bits->bit_count -= fast & 15;
+			k += (fast >> 4) & 15;
+			if(k > 63) return false;
+			coefficients[ZIGZAG[k]] = (int16_t) ((fast >> 8) * quant[k]);
+			has_ac = true;
+			k++;
+			continue;
+		}
+
+		int32_t run_size = jpeg_decode(bits, ac);
+		if(run_size < 0) return false;
+
+		uint32_t run = run_size >> 4;
+		uint32_t size = run_size & 15;
+		if(size == 0)
+		{
+			if(run != 15) break; // end of block
+			k += 16;
+			continue;
+		}
+
+		k += run;
+		if(k > 63) return false;
+		coefficients[ZIGZAG[k]] = (int16_t) (jpeg_receive_extend(bits, size) * quant[k]);
+		has_ac = true;
+		k++;
+	}
+
+	if(has_ac)
+	{
+		idct_block_sse2(coefficients, out, stride);
+		return true;
+	}
+
+	// a lone dc is flat, its idct is just the coefficient over eight
+	uint8_t value = clamp_byte(((coefficients[0] + 4) >> 3) + 128);
+	for(uint32_t row = 0; row < 8; row++)
+		memset(out + row * stride, value, 8);
+	return true;
+}
+
+// the islow integer idct from the ijg reference decoder, eight columns at a time in 16 bit lanes
+// with the rotations done as 32 bit multiply adds. 13 bits of constant precision, 2 extra bits between passes
+#define IDCT_FIX(x) ((int16_t) ((x) * 8192 + ((x) < 0 ? -0.5 : 0.5)))
+
+typedef struct
+{
+	__m128i lo;
+	__m128i hi;
+} idct_wide;
+
+static idct_wide idct_rotate(__m128i a, __m128i b, int16_t a_scale, int16_t b_scale)
+{
+	__m128i scales = _mm_setr_epi16(a_scale, b_scale, a_scale, b_scale, a_scale, b_scale, a_scale, b_scale);
+	idct_wide result = {
+		_mm_madd_epi16(_mm_unpacklo_epi16(a, b), scales),
+		_mm_madd_epi16(_mm_unpackhi_epi16(a, b), scales),
+	};
+	return result;
+}
+
+static idct_wide idct_add(idct_wide a, idct_wide b)
+{
+	idct_wide result = {_mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi)};
+	return result;
+}
+
+static idct_wide idct_sub(idct_wide a, idct_wide b)
+{
+	idct_wide result = {_mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi)};
+	return result;
+}
+
+static __m128i idct_descale(idct_wide value, int shift)
+{
+	__m128i bias = _mm_set1_epi32(1 << (shift - 1));
+	__m128i count = _mm_cvtsi32_si128(shift);
+	return _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(value.lo, bias), count), _mm_sra_epi32(_mm_add_epi32(value.hi, bias), count));
+}
+
+static void idct_pass(__m128i v[8], int shift)
+{
+	// even part, (x << 13) in 32 bits is the 16 bit value in the top half shifted back down by 3
+	idct_wide tmp3 = idct_rotate(v[2], v[6], IDCT_FIX(0.541196100 + 0.765366865), IDCT_FIX(0.541196100));
+	idct_wide tmp2 = idct_rotate(v[2], v[6], IDCT_FIX(0.541196100), IDCT_FIX(0.541196100 - 1.847759065));
+
+	__m128i zero = _mm_setzero_si128();
+	__m128i sum04 = _mm_add_epi16(v[0], v[4]);
+	__m128i difference04 = _mm_sub_epi16(v[0], v[4]);
+	idct_wide tmp0 = {_mm_srai_epi32(_mm_unpacklo_epi16(zero, sum04), 3), _mm_srai_epi32(_mm_unpackhi_epi16(zero, sum04), 3)};
+	idct_wide tmp1 = {_mm_srai_epi32(_mm_unpacklo_epi16(zero, difference04), 3), _mm_srai_epi32(_mm_unpackhi_epi16(zero, difference04), 3)};
+
+	idct_wide tmp10 = idct_add(tmp0, tmp3);
+	idct_wide tmp13 = idct_sub(tmp0, tmp3);
+	idct_wide tmp11 = idct_add(tmp1, tmp2);
+	idct_wide tmp12 = idct_sub(tmp1, tmp2);
+
+	// odd part, the shared (z3 + z4) * 1.175875602 term is folded into the z3 and z4 rotations
+	__m128i z3 = _mm_add_epi16(v[7], v[3]);
+	__m128i z4 = _mm_add_epi16(v[5], v[1]);
+	idct_wide z3_scaled = idct_rotate(z3, z4, IDCT_FIX(1.175875602 - 1.961570560), IDCT_FIX(1.175875602));
+	idct_wide z4_scaled = idct_rotate(z3, z4, IDCT_FIX(1.175875602), IDCT_FIX(1.175875602 - 0.390180644));
+
+	idct_wide odd0 = idct_add(idct_rotate(v[7], v[1], IDCT_FIX(0.298631336 - 0.899976223), IDCT_FIX(-0.899976223)), z3_scaled);
+	idct_wide odd3 = idct_add(idct_rotate(v[7], v[1], IDCT_FIX(-0.899976223), IDCT_FIX(1.501321110 - 0.899976223)), z4_scaled);
+	idct_wide odd1 = idct_add(idct_rotate(v[5], v[3], IDCT_FIX(2.053119869 - 2.562915447), IDCT_FIX(-2.562915447)), z4_scaled);
+	idct_wide odd2 = idct_add(idct_rotate(v[5], v[3], IDCT_FIX(-2.562915447), IDCT_FIX(3.072711026 - 2.562915447)), z3_scaled);
+
+	v[0] = idct_descale(idct_add(tmp10, odd3), shift);
+	v[7] = idct_descale(idct_sub(tmp10, odd3), shift);
+	v[1] = idct_descale(idct_add(tmp11, odd2), shift);
+	v[6] = idct_descale(idct_sub(tmp11, odd2), shift);
+	v[2] = idct_descale(idct_add(tmp12, odd1), shift);
+	v[5] = idct_descale(idct_sub(tmp12, odd1), shift);
+	v[3] = idct_descale(idct_add(tmp13, odd0), shift);
+	v[4] = idct_descale(idct_sub(tmp13, odd0), shift);
+}
+
+static void idct_transpose(__m128i v[8])
+{
+	__m128i a0 = _mm_unpacklo_epi16(v[0], v[1]);
+	__m128i a1 = _mm_unpackhi_epi16(v[0], v[1]);
+	__m128i a2 = _mm_unpacklo_epi16(v[2], v[3]);
+	__m128i a3 = _mm_unpackhi_epi16(v[2], v[3]);
+	__m128i a4 = _mm_unpacklo_epi16(v[4], v[5]);
+	__m128i a5 = _mm_unpackhi_epi16(v[4], v[5]);
+	__m128i a6 = _mm_unpacklo_epi16(v[6], v[7]);
+	__m128i a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	v[0] = _mm_unpacklo_epi64(b0, b4);
+	v[1] = _mm_unpackhi_epi64(b0, b4);
+	v[2] = _mm_unpacklo_epi64(b1, b5);
+	v[3] = _mm_unpackhi_epi64(b1, b5);
+	v[4] = _mm_unpacklo_epi64(b2, b6);
+	v[5] = _mm_unpackhi_epi64(b2, b6);
+	v[6] = _mm_unpacklo_epi64(b3, b7);
+	v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+void idct_block_sse2(const int16_t *coefficients, uint8_t *out, uint32_t stride)
+{
+	__m128i v[8];
+	for(uint32_t i = 0; i < 8; i++)
+		v[i] = _mm_loadu_si128((const __m128i*) (coefficients + i * 8));
+
+	// columns, then rows, each pass leaves its output transposed for the next
+	idct_pass(v, 13 - 2);
+	idct_transpose(v);
+	idct_pass(v, 13 + 2 + 3);
+	idct_transpose(v);
+
+	__m128i level_shift = _mm_set1_epi16(128);
+	for(uint32_t i = 0; i < 8; i += 2)
+	{
+		__m128i rows = _mm_packus_epi16(_mm_add_epi16(v[i], level_shift), _mm_add_epi16(v[i + 1], level_shift));
+		_mm_storel_epi64((__m128i*) (out + i * stride), rows);
+		_mm_storel_epi64((__m128i*) (out + (i + 1) * stride), _mm_unpackhi_epi64(rows, rows));
+	}
+}
+
+void jpeg_restart(jpeg_bits *bits, jpeg_decoder *decoder)
+{
+	// anything left in the bit buffer is padding before the restart marker
+	const uint8_t *cursor = bits->src;
+	while(bits->src_end - cursor >= 2 && !(cursor[0] == 0xFF && cursor[1] >= 0xD0 && cursor[1] <= 0xD7))
+		cursor++;
+
+	bits->src = SB_MIN(cursor + 2, bits->src_end);
+	bits->bits = 0;
+	bits->bit_count = 0;
+	bits->hit_marker = false;
+	for(uint32_t i = 0; i < decoder->scan_count; i++)
+		decoder->scan[i]->dc_prediction = 0;
+}
+
+bool jpeg_decode_scan(jpeg_decoder *decoder, const uint8_t **cursor, const uint8_t *end)
+{
+	jpeg_bits bits = {0};
+	bits.src = *cursor;
+	bits.src_end = end;
+	for(uint32_t i = 0; i < decoder->scan_count; i++)
+		decoder->scan[i]->dc_prediction = 0;
+
+	// a scan with one component walks that component's blocks rather than whole mcus
+	bool is_interleaved = decoder->scan_count > 1;
+	uint32_t units_x = decoder->mcu_x;
+	uint32_t units_y = decoder->mcu_y;
+	if(!is_interleaved)
+	{
+		units_x = (decoder->scan[0]->width + 7) / 8;
+		units_y = (decoder->scan[0]->height + 7) / 8;
+	}
+
+	uint32_t units_until_restart = decoder->restart_interval;
+	for(uint32_t unit_y = 0; unit_y < units_y; unit_y++)
+	{
+		for(uint32_t unit_x = 0; unit_x < units_x; unit_x++)
+		{
+			if(decoder->restart_interval)
+			{
+				if(units_until_restart == 0)
+				{
+					jpeg_restart(&bits, decoder);
+					units_until_restart = decoder->restart_interval;
+				}
+				units_until_restart--;
+			}
+
+			if(!is_interleaved)
+			{
+				jpeg_component *component = decoder->scan[0];
+				uint8_t *out = component->plane + (size_t) unit_y * 8 * component->stride + unit_x * 8;
+				if(!jpeg_decode_block(&bits, decoder, component, out, component->stride)) return false;
+				continue;
+			}
+
+			for(uint32_t i = 0; i < decoder->scan_count; i++)
+			{
+				jpeg_component *component = decoder->scan[i];
+				for(uint32_t block_y = 0; block_y < component->v; block_y++)
+					for(uint32_t block_x = 0; block_x < component->h; block_x++)
+					{
+						size_t row = (size_t) (unit_y * component->v + block_y) * 8;
+						uint8_t *out = component->plane + row * component->stride + (unit_x * component->h + block_x) * 8;
+						if(!jpeg_decode_block(&bits, decoder, component, out, component->stride)) return false;
+					}
+			}
+		}
+	}
+
+	// the next segment starts at the first marker that isn't stuffing or a restart
+	const uint8_t *next = bits.src;
+	while(end - next >= 2 && !(next[0] == 0xFF && next[1] != 0x00 && !(next[1] >= 0xD0 && next[1] <= 0xD7)))
+		next++;
+	*cursor = next;
+	return true;
+}
+
+const uint8_t *upsample_row(const jpeg_decoder *decoder, const jpeg_component *component, uint32_t y, int16_t *taps, uint8_t *out)
+{
+	uint32_t h_ratio = decoder->h_max / component->h;
+	uint32_t v_ratio = decoder->v_max / component->v;
+	if(h_ratio == 1 && v_ratio == 1) return component->plane + (size_t) y * component->stride;
+
+	// taps are four times the vertically filtered samples, the triangle filter weights the nearer
+	// chroma row or column by 3/4 and the farther one by 1/4. one tap of padding either side repeats the edge
+	uint32_t width = component->width;
+	uint32_t row = y / v_ratio;
+	const uint8_t *near = component->plane + (size_t) row * component->stride;
+	const uint8_t *far = near;
+	if(v_ratio == 2)
+	{
+		uint32_t far_row = (y & 1) ? SB_MIN(row + 1, component->height - 1) : (row > 0 ? row - 1 : 0);
+		far = component->plane + (size_t) far_row * component->stride;
+	}
+
+	__m128i zero = _mm_setzero_si128();
+	for(uint32_t x = 0; x < width; x += 8)
+	{
+		__m128i near_values = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (near + x)), zero);
+		__m128i far_values = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (far + x)), zero);
+		__m128i filtered = v_ratio == 2
+			? _mm_add_epi16(_mm_add_epi16(near_values, _mm_slli_epi16(near_values, 1)), far_values)
+			: _mm_slli_epi16(near_values, 2);
+		_mm_storeu_si128((__m128i*) (taps + x), filtered);
+	}
+	taps[-1] = taps[0];
+	taps[width] = taps[width - 1];
+
+	if(h_ratio == 1)
+	{
+		__m128i round = _mm_set1_epi16(2);
+		for(uint32_t x = 0; x < width; x += 8)
+		{
+			__m128i values = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*) (taps + x)), round), 2);
+			_mm_storel_epi64((__m128i*) (out + x), _mm_packus_epi16(values, values));
+		}
+		return out;
+	}
+
+	__m128i round_even = _mm_set1_epi16(8);
+	__m128i round_odd = _mm_set1_epi16(7);
+	for(uint32_t x = 0; x < width; x += 8)
+	{
+		__m128i center = _mm_loadu_si128((const __m128i*) (taps + x));
+		__m128i left = _mm_loadu_si128((const __m128i*) (taps + x - 1));
+		__m128i right = _mm_loadu_si128((const __m128i*) (taps + x + 1));
+		__m128i center3 = _mm_add_epi16(center, _mm_slli_epi16(center, 1));
+
+		__m128i even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(center3, left), round_even), 4);
+		__m128i odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(center3, right), round_odd), 4);
+		__m128i interleaved = _mm_unpacklo_epi8(_mm_packus_epi16(even, even), _mm_packus_epi16(odd, odd));
+		_mm_storeu_si128((__m128i*) (out + x * 2), interleaved);
+	}
+	return out;
+}
+
+// jfif ycbcr to rgb in 16 bit fixed point, luma carries 4 fractional bits and the chroma products
+// come out of mulhi at the same scale: ((c - 128) << 7) * (k << 13) >> 16 = (c - 128) * k * 16
+#define YCBCR_CR_TO_R 11485 // 1.402
+#define YCBCR_CB_TO_G -2819 // -0.344136
+#define YCBCR_CR_TO_G -5850 // -0.714136
+#define YCBCR_CB_TO_B 14516 // 1.772
+
+static void ycbcr_to_rgba_pixel(uint8_t *rgba, int32_t y, int32_t cb, int32_t cr)
+{
+	int32_t luma = (y << 4) + 8;
+	int32_t blue_difference = (cb - 128) * 128;
+	int32_t red_difference = (cr - 128) * 128;
+	rgba[0] = clamp_byte((luma + ((red_difference * YCBCR_CR_TO_R) >> 16)) >> 4);
+	rgba[1] = clamp_byte((luma + ((blue_difference * YCBCR_CB_TO_G) >> 16) + ((red_difference * YCBCR_CR_TO_G) >> 16)) >> 4);
+	rgba[2] = clamp_byte((luma + ((blue_difference * YCBCR_CB_TO_B) >> 16)) >> 4);
+	rgba[3] = 255;
+}
+
+void ycbcr_to_rgba_row_sse2(uint8_t *rgba, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint32_t width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i chroma_bias = _mm_set1_epi16(128);
+	const __m128i round = _mm_set1_epi16(8);
+	const __m128i alpha = _mm_set1_epi16(255);
+	const __m128i cr_to_r = _mm_set1_epi16(YCBCR_CR_TO_R);
+	const __m128i cb_to_g = _mm_set1_epi16(YCBCR_CB_TO_G);
+	const __m128i cr_to_g = _mm_set1_epi16(YCBCR_CR_TO_G);
+	const __m128i cb_to_b = _mm_set1_epi16(YCBCR_CB_TO_B);
+
+	uint32_t x = 0;
+	for(; x + 8 <= width; x += 8)
+	{
+		__m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (y + x)), zero);
+		__m128i blue = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (cb + x)), zero);
+		__m128i red = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (cr + x)), zero);
+		luma = _mm_add_epi16(_mm_slli_epi16(luma, 4), round);
+		blue = _mm_slli_epi16(_mm_sub_epi16(blue, chroma_bias), 7);
+		red = _mm_slli_epi16(_mm_sub_epi16(red, chroma_bias), 7);
+
+		__m128i r = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(red, cr_to_r)), 4);
+		__m128i g = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(blue, cb_to_g)), _mm_mulhi_epi16(red, cr_to_g)), 4);
+		__m128i b = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(blue, cb_to_b)), 4);
+
+		// r b and g a pairs interleave into rg and ba, which interleave into rgba
+		__m128i rb = _mm_packus_epi16(r, b);
+		__m128i ga = _mm_packus_epi16(g, alpha);
+		__m128i rg = _mm_unpacklo_epi8(rb, ga);
+		__m128i ba = _mm_unpackhi_epi8(rb, ga);
+		_mm_storeu_si128((__m128i*) (rgba + x * 4), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*) (rgba + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+	}
+	for(; x < width; x++)
+		ycbcr_to_rgba_pixel(rgba + x * 4, y[x], cb[x], cr[x]);
+}
+
+SB_AVX2_FUNCTION void ycbcr_to_rgba_row_avx2(uint8_t *rgba, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint32_t width)
+{
+	const __m256i chroma_bias = _mm256_set1_epi16(128);
+	const __m256i round = _mm256_set1_epi16(8);
+	const __m256i alpha = _mm256_set1_epi16(255);
+	const __m256i cr_to_r = _mm256_set1_epi16(YCBCR_CR_TO_R);
+	const __m256i cb_to_g = _mm256_set1_epi16(YCBCR_CB_TO_G);
+	const __m256i cr_to_g = _mm256_set1_epi16(YCBCR_CR_TO_G);
+	const __m256i cb_to_b = _mm256_set1_epi16(YCBCR_CB_TO_B);
+
+	uint32_t x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		__m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (y + x)));
+		__m256i blue = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (cb + x)));
+		__m256i red = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (cr + x)));
+		luma = _mm256_add_epi16(_mm256_slli_epi16(luma, 4), round);
+		blue = _mm256_slli_epi16(_mm256_sub_epi16(blue, chroma_bias), 7);
+		red = _mm256_slli_epi16(_mm256_sub_epi16(red, chroma_bias), 7);
+
+		__m256i r = _mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(red, cr_to_r)), 4);
+		__m256i g = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(blue, cb_to_g)), _mm256_mulhi_epi16(red, cr_to_g)), 4);
+		__m256i b = _mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(blue, cb_to_b)), 4);
+
+		// the packs and unpacks work per 128 bit lane, leaving pixels 0-3 and 8-11 in one register and 4-7 and 12-15 in the other
+		__m256i rb = _mm256_packus_epi16(r, b);
+		__m256i ga = _mm256_packus_epi16(g, alpha);
+		__m256i rg = _mm256_unpacklo_epi8(rb, ga);
+		__m256i ba = _mm256_unpackhi_epi8(rb, ga);
+		__m256i first = _mm256_unpacklo_epi16(rg, ba);
+		__m256i second = _mm256_unpackhi_epi16(rg, ba);
+		_mm256_storeu_si256((__m256i*) (rgba + x * 4), _mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256((__m256i*) (rgba + x * 4 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+	}
+	for(; x < width; x++)
+		ycbcr_to_rgba_pixel(rgba + x * 4, y[x], cb[x], cr[x]);
+}
+
+bool decode_jpeg(const uint8_t *data, size_t size, uint8_t *rgba, size_t rgba_size)
+{
+	sb_arena_temp scratch = sb_get_scratch();
+	jpeg_decoder *decoder = sb_arena_one(scratch.arena, jpeg_decoder);
+	SB_ZERO_STRUCT(decoder);
+
+	bool is_valid = true;
+	bool has_frame = false;
+	bool has_scan = false;
+	const uint8_t *cursor = data + 2;
+	const uint8_t *end = data + size;
+	while(is_valid)
+	{
+		// markers can be padded with any number of 0xff fill bytes
+		if(end - cursor < 2 || cursor[0] != 0xFF)
+		{
+			is_valid = false;
+			break;
+		}
+		while(cursor < end && *cursor == 0xFF)
+			cursor++;
+		if(cursor >= end)
+		{
+			is_valid = false;
+			break;
+		}
+
+		uint8_t marker = *cursor++;
+		if(marker == 0xD9) break; // end of image
+		if(marker >= 0xD0 && marker <= 0xD7) continue;
+
+		if(end - cursor < 2 || read_be16(cursor) < 2 || read_be16(cursor) > (size_t) (end - cursor))
+		{
+			is_valid = false;
+			break;
+		}
+		const uint8_t *segment = cursor + 2;
+		const uint8_t *segment_end = cursor + read_be16(cursor);
+		cursor = segment_end;
+
+		switch(marker)
+		{
+			case 0xDB: // quantisation tables
+				while(is_valid && segment < segment_end)
+				{
+					uint32_t precision = segment[0] >> 4;
+					uint32_t table = segment[0] & 15;
+					segment++;
+					is_valid = table < 4 && segment_end - segment >= (precision ? 128 : 64);
+					for(uint32_t k = 0; is_valid && k < 64; k++)
+						decoder->quant[table][k] = (uint16_t) (precision ? read_be16(segment + k * 2) : segment[k]);
+					segment += precision ? 128 : 64;
+				}
+				break;
+
+			case 0xC4: // huffman tables
+				while(is_valid && segment < segment_end)
+				{
+					uint32_t table_class = segment[0] >> 4;
+					uint32_t table = segment[0] & 15;
+					is_valid = table_class < 2 && table < 4 && segment_end - segment >= 17;
+					if(!is_valid) break;
+
+					const uint8_t *counts = segment + 1;
+					uint32_t value_count = 0;
+					for(uint32_t i = 0; i < 16; i++)
+						value_count += counts[i];
+					is_valid = value_count <= 256 && segment_end - (segment + 17) >= value_count;
+					if(!is_valid) break;
+
+					jpeg_huffman *huffman = table_class ? &decoder->ac[table] : &decoder->dc[table];
+					is_valid = build_jpeg_huffman(huffman, counts, segment + 17, value_count);
+					segment += 17 + value_count;
+				}
+				break;
+
+			case 0xC0: // baseline
+			case 0xC1: // extended sequential, still huffman and 8 bit here
+			{
+				is_valid = !has_frame && segment_end - segment >= 6 && segment[0] == 8;
+				if(!is_valid) break;
+
+				decoder->height = read_be16(segment + 1);
+				decoder->width = read_be16(segment + 3);
+				decoder->component_count = segment[5];
+				is_valid = decoder->width > 0 && decoder->height > 0 &&
+					(decoder->component_count == 1 || decoder->component_count == 3) &&
+					segment_end - segment >= 6 + 3 * decoder->component_count &&
+					(uint64_t) decoder->width * decoder->height * 4 <= rgba_size;
+				if(!is_valid) break;
+
+				decoder->h_max = 1;
+				decoder->v_max = 1;
+				for(uint32_t i = 0; i < decoder->component_count; i++)
+				{
+					jpeg_component *component = &decoder->components[i];
+					component->id = segment[6 + i * 3];
+					component->h = segment[7 + i * 3] >> 4;
+					component->v = segment[7 + i * 3] & 15;
+					component->quant_table = segment[8 + i * 3] & 3;
+					if(decoder->component_count == 1) component->h = component->v = 1; // a lone component is never interleaved
+
+					decoder->h_max = SB_MAX(decoder->h_max, component->h);
+					decoder->v_max = SB_MAX(decoder->v_max, component->v);
+				}
+
+				// full resolution luma, chroma at most halved in each direction
+				for(uint32_t i = 0; is_valid && i < decoder->component_count; i++)
+				{
+					jpeg_component *component = &decoder->components[i];
+					bool is_luma = i == 0;
+					is_valid = component->h > 0 && component->v > 0 &&
+						decoder->h_max % component->h == 0 && decoder->v_max % component->v == 0 &&
+						decoder->h_max / component->h <= 2 && decoder->v_max / component->v <= 2 &&
+						(!is_luma || (component->h == decoder->h_max && component->v == decoder->v_max));
+				}
+				if(!is_valid) break;
+
+				decoder->mcu_x = (decoder->width + decoder->h_max * 8 - 1) / (decoder->h_max * 8);
+				decoder->mcu_y = (decoder->height + decoder->v_max * 8 - 1) / (decoder->v_max * 8);
+				for(uint32_t i = 0; i < decoder->component_count; i++)
+				{
+					jpeg_component *component = &decoder->components[i];
+					component->width = (decoder->width * component->h + decoder->h_max - 1) / decoder->h_max;
+					component->height = (decoder->height * component->v + decoder->v_max - 1) / decoder->v_max;
+					component->stride = decoder->mcu_x * component->h * 8;
+
+					size_t plane_size = (size_t) component->stride * decoder->mcu_y * component->v * 8;
+					component->plane = sb_arena_push_aligned(scratch.arena, plane_size, 16);
+				}
+				// without an adobe segment saying otherwise, components named r g b are taken at their word
+				if(!decoder->has_adobe_transform && decoder->component_count == 3)
+					decoder->is_rgb = decoder->components[0].id == 'R' && decoder->components[1].id == 'G' && decoder->components[2].id == 'B';
+				has_frame = true;
+			} break;
+
+			case 0xDD: // restart interval
+				is_valid = segment_end - segment >= 2;
+				if(is_valid) decoder->restart_interval = read_be16(segment);
+				break;
+
+			case 0xDA: // start of scan, the entropy coded data follows the header
+			{
+				is_valid = has_frame && segment_end - segment >= 1;
+				if(!is_valid) break;
+
+				decoder->scan_count = segment[0];
+				is_valid = decoder->scan_count >= 1 && decoder->scan_count <= decoder->component_count &&
+					segment_end - segment >= 1 + 2 * decoder->scan_count + 3;
+				for(uint32_t i = 0; is_valid && i < decoder->scan_count; i++)
+				{
+					uint8_t id = segment[1 + i * 2];
+					uint8_t tables = segment[2 + i * 2];
+					jpeg_component *component = NULL;
+					for(uint32_t c = 0; c < decoder->component_count; c++)
+						if(decoder->components[c].id == id) component = &decoder->components[c];
+
+					is_valid = component && (tables >> 4) < 4 && (tables & 15) < 4;
+					if(!is_valid) break;
+					component->dc_table = tables >> 4;
+					component->ac_table = tables & 15;
+					decoder->scan[i] = component;
+				}
+
+				is_valid = is_valid && jpeg_decode_scan(decoder, &cursor, end);
+				has_scan = true;
+			} break;
+
+			case 0xEE: // adobe, a transform of 0 means the components are rgb rather than ycbcr
+				if(segment_end - segment >= 12 && memcmp(segment, "Adobe", 5) == 0)
+				{
+					decoder->has_adobe_transform = true;
+					decoder->is_rgb = segment[11] == 0;
+				}
+				break;
+
+			case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+			case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+				is_valid = false; // progressive, lossless and arithmetic coded frames aren't shipped
+				break;
+
+			default:
+				break; // app segments, comments
+		}
+	}
+
+	if(is_valid && has_frame && has_scan)
+	{
+		const jpeg_component *luma = &decoder->components[0];
+		size_t chroma_capacity = luma->stride + 32;
+		int16_t *taps = sb_arena_push(scratch.arena, int16_t, chroma_capacity + 16);
+		uint8_t *cb_row = sb_arena_push_aligned(scratch.arena, chroma_capacity * 2, 16);
+		uint8_t *cr_row = sb_arena_push_aligned(scratch.arena, chroma_capacity * 2, 16);
+		bool use_avx2 = has_avx2();
+
+		for(uint32_t y = 0; y < decoder->height; y++)
+		{
+			uint8_t *out = rgba + (size_t) y * decoder->width * 4;
+			const uint8_t *luma_row = luma->plane + (size_t) y * luma->stride;
+			if(decoder->component_count == 1)
+			{
+				grey_to_rgba_row(out, luma_row, decoder->width);
+				continue;
+			}
+
+			const uint8_t *cb = upsample_row(decoder, &decoder->components[1], y, taps + 8, cb_row);
+			const uint8_t *cr = upsample_row(decoder, &decoder->components[2], y, taps + 8, cr_row);
+			if(decoder->is_rgb)
+			{
+				for(uint32_t x = 0; x < decoder->width; x++)
+				{
+					out[x * 4 + 0] = luma_row[x];
+					out[x * 4 + 1] = cb[x];
+					out[x * 4 + 2] = cr[x];
+					out[x * 4 + 3] = 255;
+				}
+			}
+			else if(use_avx2) ycbcr_to_rgba_row_avx2(out, luma_row, cb, cr, decoder->width);
+			else ycbcr_to_rgba_row_sse2(out, luma_row, cb, cr, decoder->width);
+		}
+	}
+
+	sb_release_scratch(&scratch);
+	return is_valid && has_frame && has_scan;
+}
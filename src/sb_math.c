@@ -43,6 +43,55 @@ size_t sb_round_up(size_t n, size_t mult)
     return n + mult - remainder;
 }
 
+uint16_t sb_f32_to_f16(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7fffff;
+	int32_t exponent = (int32_t) ((bits >> 23) & 0xff) - 127 + 15;
+	if(((bits >> 23) & 0xff) == 0xff) return (uint16_t) (sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	if(exponent >= 31) return (uint16_t) (sign | 0x7c00);
+
+	if(exponent <= 0)
+	{
+		// subnormal, the implicit one is shifted down into the mantissa
+		if(exponent < -10) return (uint16_t) sign;
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t) (14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1U << shift) - 1);
+		uint32_t halfway = 1U << (shift - 1);
+		half += remainder > halfway || (remainder == halfway && (half & 1));
+		return (uint16_t) (sign | half);
+	}
+
+	// a carry out of the mantissa rounds up into the exponent, which is also right for the largest values
+	uint32_t half = (uint32_t) exponent << 10 | mantissa >> 13;
+	uint32_t remainder = mantissa & 0x1fff;
+	half += remainder > 0x1000 || (remainder == 0x1000 && (half & 1));
+	return (uint16_t) (sign | half);
+}
+
+float sb_f16_to_f32(uint16_t value)
+{
+	uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	float result;
+	if(exponent == 0) result = ldexpf((float) mantissa, -24);
+	else if(exponent == 31) result = mantissa ? NAN : INFINITY;
+	else result = ldexpf((float) (mantissa | 0x400), (int) exponent - 25);
+
+	uint32_t bits;
+	memcpy(&bits, &result, sizeof(bits));
+	bits |= sign;
+	memcpy(&result, &bits, sizeof(bits));
+	return result;
+}
+
 float sb_clamp(float d, float min, float max)
 {
   const float t = d < min ? min : d;
@@ -512,4 +561,81 @@ void sb_mat4_projection_perpective(sb_mat4 out, float aspect_ratio, float fov, f
     out[2][2] = far/(far-near);
     out[2][3] = 1.0f;
     out[3][2] = -(far*near) / (far - near);
-}
\ No newline at end of file
+}
+// rows of the matrix combined so the clip space tests -w <= x <= w, -w <= y <= w and 0 <= z <= w become planes
+sb_frustum sb_frustum_from_mat4(sb_mat4 m)
+{
+    sb_vec4 rows[4];
+    for(int i = 0; i < 4; i++)
+        rows[i] = (sb_vec4) {m[0][i], m[1][i], m[2][i], m[3][i]};
+
+    sb_frustum frustum;
+    frustum.planes[0] = (sb_vec4) {rows[3].x + rows[0].x, rows[3].y + rows[0].y, rows[3].z + rows[0].z, rows[3].w + rows[0].w};
+    frustum.planes[1] = (sb_vec4) {rows[3].x - rows[0].x, rows[3].y - rows[0].y, rows[3].z - rows[0].z, rows[3].w - rows[0].w};
+    frustum.planes[2] = (sb_vec4) {rows[3].x + rows[1].x, rows[3].y + rows[1].y, rows[3].z + rows[1].z, rows[3].w + rows[1].w};
+    frustum.planes[3] = (sb_vec4) {rows[3].x - rows[1].x, rows[3].y - rows[1].y, rows[3].z - rows[1].z, rows[3].w - rows[1].w};
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = (sb_vec4) {rows[3].x - rows[2].x, rows[3].y - rows[2].y, rows[3].z - rows[2].z, rows[3].w - rows[2].w};
+
+    for(int i = 0; i < 6; i++)
+    {
+        sb_vec4 plane = frustum.planes[i];
+        frustum.planes[i] = sb_vec4_mul_f32(plane, 1.0f / sb_vec3_magnitude((sb_vec3) {plane.x, plane.y, plane.z}));
+    }
+    return frustum;
+}
+
+bool sb_mat4_get_trs(sb_mat4 in, sb_vec3 *out_position, sb_vec4 *out_rotation, float *out_scale)
+{
+    if(in[0][3] != 0.0f || in[1][3] != 0.0f || in[2][3] != 0.0f || in[3][3] != 1.0f) return false;
+
+    sb_vec3 columns[3];
+    for(int i = 0; i < 3; i++)
+        columns[i] = (sb_vec3) {in[i][0], in[i][1], in[i][2]};
+
+    float scale = sb_vec3_magnitude(columns[0]);
+    *out_position = (sb_vec3) {in[3][0], in[3][1], in[3][2]};
+    *out_scale = scale;
+    *out_rotation = (sb_vec4) {0.0f, 0.0f, 0.0f, 1.0f};
+    if(scale < 1e-6f) return sb_vec3_magnitude(columns[1]) < 1e-6f && sb_vec3_magnitude(columns[2]) < 1e-6f;
+
+    // the columns have to be orthogonal, the same length and right handed
+    const float tolerance = 1e-3f;
+    for(int i = 1; i < 3; i++)
+        if(fabsf(sb_vec3_magnitude(columns[i]) - scale) > scale * tolerance) return false;
+    if(fabsf(sb_vec3_dot(columns[0], columns[1])) > scale * scale * tolerance
+        || fabsf(sb_vec3_dot(columns[0], columns[2])) > scale * scale * tolerance
+        || fabsf(sb_vec3_dot(columns[1], columns[2])) > scale * scale * tolerance
+        || sb_vec3_dot(sb_vec3_cross(columns[0], columns[1]), columns[2]) <= 0.0f) return false;
+
+    // r[row][column] of the unscaled rotation, the largest of w, x, y and z is solved first to keep the division stable
+    float r[3][3];
+    for(int column = 0; column < 3; column++)
+        for(int row = 0; row < 3; row++)
+            r[row][column] = in[column][row] / scale;
+
+    float trace = r[0][0] + r[1][1] + r[2][2];
+    sb_vec4 q;
+    if(trace > 0.0f)
+    {
+        float s = sqrtf(trace + 1.0f) * 2.0f;
+        q = (sb_vec4) {(r[2][1] - r[1][2]) / s, (r[0][2] - r[2][0]) / s, (r[1][0] - r[0][1]) / s, 0.25f * s};
+    }
+    else if(r[0][0] > r[1][1] && r[0][0] > r[2][2])
+    {
+        float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+        q = (sb_vec4) {0.25f * s, (r[0][1] + r[1][0]) / s, (r[0][2] + r[2][0]) / s, (r[2][1] - r[1][2]) / s};
+    }
+    else if(r[1][1] > r[2][2])
+    {
+        float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+        q = (sb_vec4) {(r[0][1] + r[1][0]) / s, 0.25f * s, (r[1][2] + r[2][1]) / s, (r[0][2] - r[2][0]) / s};
+    }
+    else
+    {
+        float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+        q = (sb_vec4) {(r[0][2] + r[2][0]) / s, (r[1][2] + r[2][1]) / s, 0.25f * s, (r[1][0] - r[0][1]) / s};
+    }
+    *out_rotation = sb_vec4_normalize(q);
+    return true;
+}
@@ -1,8 +1,10 @@
 #include "sb_mesh.h"
 
-sb_mesh_memory sb_alloc_mesh_memory(VkDevice device, const sb_memory_types *memory_types)
+sb_mesh_memory sb_alloc_mesh_memory(VkDevice device, const sb_memory_types *memory_types, VkIndexType index_type)
 {
     sb_mesh_memory meshes = {0};
+    meshes.fallback_mesh = SB_NULL_MESH_ID;
+    meshes.index_type = index_type;
 
     sb_memory_info index_buffer_info = {0};
     index_buffer_info.capacity = MB(64);
@@ -19,11 +21,18 @@ sb_mesh_memory sb_alloc_mesh_memory(VkDevice device, const sb_memory_types *memo
     sb_allocate_buffer(device, &vertex_buffer_info, &meshes.vertex_buffer);
 
     sb_memory_info handle_buffer_info = {0};
-    handle_buffer_info.capacity = sizeof(sb_mesh_handle)*SB_MAX_MESHES;
+    handle_buffer_info.capacity = sizeof(sb_mesh_handle)*(SB_MAX_MESHES + SB_MAX_MESH_PARTS);
     handle_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
     handle_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     handle_buffer_info.memory_types = memory_types;
     sb_allocate_buffer(device, &handle_buffer_info, &meshes.handle_buffer);
+
+    sb_memory_info cluster_buffer_info = {0};
+    cluster_buffer_info.capacity = sizeof(sb_mesh_cluster)*SB_MAX_MESH_CLUSTERS;
+    cluster_buffer_info.memory_usage = SB_MEMORY_USAGE_GPU;
+    cluster_buffer_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    cluster_buffer_info.memory_types = memory_types;
+    sb_allocate_buffer(device, &cluster_buffer_info, &meshes.cluster_buffer);
     return meshes;
 }
 
@@ -31,5 +40,5 @@ void sb_bind_mesh_buffers(VkCommandBuffer command_buffer, sb_mesh_memory *meshes
 {
     const VkDeviceSize vertexOffset = 0;
 	vkCmdBindVertexBuffers(command_buffer, 0, 1, &meshes->vertex_buffer.vk_buffer, &vertexOffset);
-	vkCmdBindIndexBuffer(command_buffer, meshes->index_buffer.vk_buffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(command_buffer, meshes->index_buffer.vk_buffer, 0, meshes->index_type);
 }
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "sb_mesh_file.h"
+#include "sb_common.h"
+#include "sb_file.h"
+
+#include <math.h>
+#include <string.h>
+
+uint32_t sb_get_mesh_file_vertex_count(const void *data)
+{
+	if(sb_is_mesh_file_v1(data)) return ((const sb_mesh_file_header_v1*) data)->vertex_count;
+	return ((const sb_mesh_file_header*) data)->vertex_count;
+}
+
+uint32_t sb_get_mesh_file_index_count(const void *data)
+{
+	if(sb_is_mesh_file_v1(data)) return ((const sb_mesh_file_header_v1*) data)->index_count;
+	return ((const sb_mesh_file_header*) data)->index_count;
+}
+
+uint32_t sb_get_mesh_file_index_size(const void *data)
+{
+	if(sb_is_mesh_file_v1(data)) return sizeof(uint32_t);
+	return sb_mesh_file_index_size(data);
+}
+
+const void *sb_get_mesh_file_indices(const void *data)
+{
+	if(!sb_is_mesh_file_v1(data)) return sb_mesh_file_indices(data);
+
+	const sb_mesh_file_header_v1 *header = data;
+	return (const sb_vertex*) (header + 1) + header->vertex_count;
+}
+
+uint32_t sb_get_mesh_file_cluster_count(const void *data)
+{
+	return sb_is_mesh_file_v1(data) ? 0 : sb_mesh_file_cluster_count(data);
+}
+
+bool sb_is_valid_mesh_file(const void *data, uint64_t size)
+{
+	if(size < sizeof(sb_mesh_file_header_v1)) return false;
+	if(sb_is_mesh_file_v1(data))
+	{
+		const sb_mesh_file_header_v1 *header = data;
+		uint64_t payload_size = (uint64_t) header->vertex_count * sizeof(sb_vertex) + (uint64_t) header->index_count * sizeof(uint32_t);
+		return size - sizeof(sb_mesh_file_header_v1) >= payload_size;
+	}
+
+	const sb_mesh_file_header *header = data;
+	if(size < sizeof(sb_mesh_file_header_v2) || header->version < 2 || header->version > SB_MESH_FILE_VERSION) return false;
+	uint64_t header_size = sb_mesh_file_header_size(header);
+	if(size < header_size) return false;
+	if(header->version >= 3 && (header->lod_count == 0 || header->lod_count > SB_MAX_MESH_LODS)) return false;
+
+	uint64_t payload_size = (uint64_t) sb_mesh_file_cluster_count(header) * sizeof(sb_mesh_cluster) +
+		(uint64_t) header->vertex_count * sizeof(sb_packed_vertex) + (uint64_t) header->index_count * sb_mesh_file_index_size(header);
+	return size - header_size >= payload_size;
+}
+
+uint32_t sb_get_mesh_file_lods(const void *data, uint32_t out_index_counts[SB_MAX_MESH_LODS], float out_errors[SB_MAX_MESH_LODS])
+{
+	const sb_mesh_file_header *header = data;
+	if(sb_is_mesh_file_v1(data) || header->version < 3)
+	{
+		out_index_counts[0] = sb_get_mesh_file_index_count(data);
+		out_errors[0] = 0.0f;
+		return 1;
+	}
+
+	assert(header->lod_count > 0 && header->lod_count <= SB_MAX_MESH_LODS);
+	memcpy(out_index_counts, header->lod_index_counts, header->lod_count * sizeof(uint32_t));
+	memcpy(out_errors, header->lod_errors, header->lod_count * sizeof(float));
+	return header->lod_count;
+}
+
+void sb_get_vertex_bounds(const sb_vertex *vertices, uint32_t vertex_count, sb_vec3 *out_min, sb_vec3 *out_max)
+{
+	sb_vec3 bounds_min = vertex_count > 0 ? vertices[0].position : (sb_vec3) {0};
+	sb_vec3 bounds_max = bounds_min;
+	for(uint32_t i = 1; i < vertex_count; i++)
+	{
+		sb_vec3 position = vertices[i].position;
+		bounds_min = (sb_vec3) {SB_MIN(bounds_min.x, position.x), SB_MIN(bounds_min.y, position.y), SB_MIN(bounds_min.z, position.z)};
+		bounds_max = (sb_vec3) {SB_MAX(bounds_max.x, position.x), SB_MAX(bounds_max.y, position.y), SB_MAX(bounds_max.z, position.z)};
+	}
+	*out_min = bounds_min;
+	*out_max = bounds_max;
+}
+
+void encode_octahedral(sb_vec3 normal, int16_t *out)
+{
+	// project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals
+	float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	float x = sum > 0.0f ? normal.x / sum : 0.0f;
+	float y = sum > 0.0f ? normal.y / sum : 0.0f;
+	if(normal.z < 0.0f)
+	{
+		float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = folded_x;
+	}
+	out[0] = (int16_t) lrintf(sb_clamp(x, -1.0f, 1.0f) * 32767.0f);
+	out[1] = (int16_t) lrintf(sb_clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+sb_vec3 decode_octahedral(const int16_t *encoded)
+{
+	sb_vec3 normal;
+	normal.x = SB_MAX(encoded[0] / 32767.0f, -1.0f);
+	normal.y = SB_MAX(encoded[1] / 32767.0f, -1.0f);
+	normal.z = 1.0f - fabsf(normal.x) - fabsf(normal.y);
+
+	float fold = SB_MAX(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	return sb_vec3_normalize(normal);
+}
+
+void sb_pack_vertices(sb_packed_vertex *out, const sb_vertex *vertices, uint32_t vertex_count, sb_vec3 bounds_min, sb_vec3 bounds_max)
+{
+	// a flat axis has no extent to spread across, everything on it packs to 0
+	sb_vec3 extent = sb_vec3_sub(bounds_max, bounds_min);
+	sb_vec3 scale = {
+		extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+		extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 65535.0f / extent.z : 0.0f,
+	};
+
+	for(uint32_t i = 0; i < vertex_count; i++)
+	{
+		const sb_vertex *vertex = &vertices[i];
+		sb_packed_vertex packed = {0};
+		packed.position[0] = (uint16_t) lrintf(sb_clamp((vertex->position.x - bounds_min.x) * scale.x, 0.0f, 65535.0f));
+		packed.position[1] = (uint16_t) lrintf(sb_clamp((vertex->position.y - bounds_min.y) * scale.y, 0.0f, 65535.0f));
+		packed.position[2] = (uint16_t) lrintf(sb_clamp((vertex->position.z - bounds_min.z) * scale.z, 0.0f, 65535.0f));
+		encode_octahedral(vertex->normal, packed.normal);
+		packed.uv[0] = sb_f32_to_f16(vertex->uv.x);
+		packed.uv[1] = sb_f32_to_f16(vertex->uv.y);
+
+		// one whole store per vertex, out is usually write combined staging memory
+		memcpy(&out[i], &packed, sizeof(packed));
+	}
+}
+
+sb_vertex sb_unpack_vertex(const sb_packed_vertex *vertex, sb_vec3 bounds_min, sb_vec3 bounds_max)
+{
+	sb_vec3 extent = sb_vec3_sub(bounds_max, bounds_min);
+
+	sb_vertex unpacked = {0};
+	unpacked.position.x = bounds_min.x + vertex->position[0] / 65535.0f * extent.x;
+	unpacked.position.y = bounds_min.y + vertex->position[1] / 65535.0f * extent.y;
+	unpacked.position.z = bounds_min.z + vertex->position[2] / 65535.0f * extent.z;
+	unpacked.normal = decode_octahedral(vertex->normal);
+	unpacked.uv.x = sb_f16_to_f32(vertex->uv[0]);
+	unpacked.uv.y = sb_f16_to_f32(vertex->uv[1]);
+	return unpacked;
+}
+
+const void *sb_upgrade_mesh_file(sb_arena *arena, const void *data, uint64_t *size)
+{
+	if(!sb_is_mesh_file_v1(data))
+	{
+		const sb_mesh_file_header *old_header = data;
+		if(old_header->version == SB_MESH_FILE_VERSION) return data;
+		assert(old_header->version == 2 || old_header->version == 3);
+
+		// the payload is the same, only the header grows. v2 gets a single lod, neither has clusters
+		uint64_t old_header_size = sb_mesh_file_header_size(old_header);
+		uint64_t payload_size = *size - old_header_size;
+		sb_mesh_file_header *header = sb_arena_push_aligned(arena, sizeof(sb_mesh_file_header) + payload_size, _Alignof(sb_mesh_file_header));
+		SB_ZERO_STRUCT(header);
+		memcpy(header, old_header, old_header_size);
+		if(old_header->version == 2)
+		{
+			header->lod_count = 1;
+			header->lod_index_counts[0] = header->index_count;
+		}
+		header->version = SB_MESH_FILE_VERSION;
+		memcpy(header + 1, (const uint8_t*) old_header + old_header_size, payload_size);
+
+		*size = sizeof(sb_mesh_file_header) + payload_size;
+		return header;
+	}
+
+	const sb_mesh_file_header_v1 *v1_header = data;
+	const sb_vertex *vertices = (const sb_vertex*) (v1_header + 1);
+	const uint32_t *indices = (const uint32_t*) (vertices + v1_header->vertex_count);
+	assert(*size == sizeof(*v1_header) + v1_header->vertex_count * sizeof(sb_vertex) + v1_header->index_count * sizeof(uint32_t));
+
+	bool has_16_bit_indices = v1_header->vertex_count <= SB_MESH_PART_MAX_VERTICES;
+	uint64_t index_size = has_16_bit_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint64_t upgraded_size = sizeof(sb_mesh_file_header) + v1_header->vertex_count * sizeof(sb_packed_vertex) + v1_header->index_count * index_size;
+	sb_mesh_file_header *header = sb_arena_push_aligned(arena, upgraded_size, _Alignof(sb_mesh_file_header));
+	SB_ZERO_STRUCT(header);
+	header->magic = SB_MESH_FILE_MAGIC;
+	header->version = SB_MESH_FILE_VERSION;
+	header->vertex_count = v1_header->vertex_count;
+	header->index_count = v1_header->index_count;
+	header->flags = has_16_bit_indices ? SB_MESH_FILE_16_BIT_INDICES_FLAG : 0;
+	header->lod_count = 1;
+	header->lod_index_counts[0] = header->index_count;
+	sb_get_vertex_bounds(vertices, header->vertex_count, &header->bounds_min, &header->bounds_max);
+
+	sb_pack_vertices((sb_packed_vertex*) (header + 1), vertices, header->vertex_count, header->bounds_min, header->bounds_max);
+	if(has_16_bit_indices)
+	{
+		uint16_t *narrow_indices = (uint16_t*) sb_mesh_file_indices(header);
+		for(uint32_t i = 0; i < header->index_count; i++)
+			narrow_indices[i] = (uint16_t) indices[i];
+	}
+	else memcpy((void*) sb_mesh_file_indices(header), indices, header->index_count * sizeof(uint32_t));
+
+	*size = upgraded_size;
+	return header;
+}
+
+void sb_write_mesh_file(const char *name, const sb_packed_vertex *vertices, uint32_t vertex_count,
+	const uint32_t *indices, uint32_t index_count, sb_vec3 bounds_min, sb_vec3 bounds_max)
+{
+	float error = 0.0f;
+	sb_write_mesh_file_lods(name, vertices, vertex_count, indices, &index_count, &error, 1, NULL, 0, bounds_min, bounds_max);
+}
+
+void sb_write_mesh_file_lods(const char *name, const sb_packed_vertex *vertices, uint32_t vertex_count, const uint32_t *indices,
+	const uint32_t *lod_index_counts, const float *lod_errors, uint32_t lod_count, const sb_mesh_cluster *clusters, uint32_t cluster_count,
+	sb_vec3 bounds_min, sb_vec3 bounds_max)
+{
+	assert(lod_count > 0 && lod_count <= SB_MAX_MESH_LODS);
+
+	sb_mesh_file_header header = {0};
+	header.magic = SB_MESH_FILE_MAGIC;
+	header.version = SB_MESH_FILE_VERSION;
+	header.vertex_count = vertex_count;
+	header.flags = vertex_count <= SB_MESH_PART_MAX_VERTICES ? SB_MESH_FILE_16_BIT_INDICES_FLAG : 0;
+	header.bounds_min = bounds_min;
+	header.bounds_max = bounds_max;
+	header.lod_count = lod_count;
+	header.cluster_count = cluster_count;
+	for(uint32_t lod = 0; lod < lod_count; lod++)
+	{
+		header.lod_index_counts[lod] = lod_index_counts[lod];
+		header.lod_errors[lod] = lod_errors[lod];
+		header.index_count += lod_index_counts[lod];
+	}
+	uint32_t index_count = header.index_count;
+
+	FILE *out = sb_fopen(name, "wb");
+	fwrite(&header, sizeof(header), 1, out);
+	if(cluster_count > 0) fwrite(clusters, sizeof(sb_mesh_cluster), cluster_count, out);
+	fwrite(vertices, sizeof(sb_packed_vertex), vertex_count, out);
+	if(header.flags & SB_MESH_FILE_16_BIT_INDICES_FLAG)
+	{
+		sb_arena_temp scratch = sb_get_scratch();
+		uint16_t *narrow_indices = sb_arena_push(scratch.arena, uint16_t, index_count);
+		for(uint32_t i = 0; i < index_count; i++)
+			narrow_indices[i] = (uint16_t) indices[i];
+		fwrite(narrow_indices, sizeof(uint16_t), index_count, out);
+		sb_release_scratch(&scratch);
+	}
+	else fwrite(indices, sizeof(uint32_t), index_count, out);
+	fclose(out);
+}
+
+uint32_t sb_split_mesh(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count,
+	sb_mesh_part *out_parts, uint32_t *out_source_vertices, uint16_t *out_indices, uint32_t *out_split_vertex_count)
+{
+	// stamping vertices with the part that last used them saves clearing the remap between parts
+	sb_arena_temp scratch = sb_get_scratch();
+	uint32_t *vertex_parts = sb_arena_push(scratch.arena, uint32_t, vertex_count);
+	uint32_t *part_vertices = sb_arena_push(scratch.arena, uint32_t, vertex_count);
+	memset(vertex_parts, 0xff, vertex_count * sizeof(uint32_t));
+
+	sb_mesh_part part = {0};
+	uint32_t part_count = 0;
+	for(uint32_t i = 0; i + 2 < index_count; i += 3)
+	{
+		// a whole triangle always fits once the part is closed
+		if(part.vertex_count + 3 > SB_MESH_PART_MAX_VERTICES)
+		{
+			if(out_parts) out_parts[part_count] = part;
+			part_count++;
+
+			part.first_vertex += part.vertex_count;
+			part.vertex_count = 0;
+			part.first_index = i;
+			part.index_count = 0;
+		}
+
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[i + corner];
+			if(vertex_parts[vertex] != part_count)
+			{
+				vertex_parts[vertex] = part_count;
+				part_vertices[vertex] = part.vertex_count++;
+				if(out_source_vertices) out_source_vertices[part.first_vertex + part_vertices[vertex]] = vertex;
+			}
+			if(out_indices) out_indices[i + corner] = (uint16_t) part_vertices[vertex];
+		}
+		part.index_count += 3;
+	}
+
+	if(out_parts) out_parts[part_count] = part;
+	part_count++;
+	if(out_split_vertex_count) *out_split_vertex_count = part.first_vertex + part.vertex_count;
+
+	sb_release_scratch(&scratch);
+	return part_count;
+}
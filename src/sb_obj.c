@@ -0,0 +1,370 @@
+#include "sb_obj.h"
+#include "sb_thread.h"
+#include "sb_common.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define sb_ctz32(x) _tzcnt_u32(x)
+#else
+#define sb_ctz32(x) ((uint32_t) __builtin_ctz(x))
+#endif
+
+#define NO_ATTRIBUTE UINT32_MAX
+#define MIN_CHUNK_SIZE KB(256) // below this a thread costs more to start than it saves
+
+static const uint32_t DIGIT_SCALES[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+static const double POWERS_OF_TEN[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+typedef struct
+{
+	uint32_t position;
+	uint32_t uv;
+	uint32_t normal;
+} obj_corner;
+
+typedef struct
+{
+	const char *begin;
+	const char *end;
+
+	// counted by the first pass, the prefix sums of them place each chunk in the shared arrays for the second
+	uint32_t position_count, uv_count, normal_count, triangle_count;
+	uint32_t first_position, first_uv, first_normal, first_triangle;
+
+	sb_vec3 *positions;
+	sb_vec2 *uvs;
+	sb_vec3 *normals;
+	obj_corner *corners; // three per triangle, indices already resolved to 0 based
+} obj_chunk;
+
+bool is_obj_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char *skip_obj_line(const char *at, const char *end)
+{
+	const char *newline = memchr(at, '\n', (size_t) (end - at));
+	return newline ? newline + 1 : end;
+}
+
+const char *skip_obj_spaces(const char *at, const char *end)
+{
+	while(at < end && is_obj_space(*at)) at++;
+	return at;
+}
+
+// the run of up to 8 digits at the start of 16 readable bytes, false when it's longer
+bool convert_digits(const char *at, uint32_t *out_value, uint32_t *out_count)
+{
+	__m128i digits = _mm_sub_epi8(_mm_loadu_si128((const __m128i*) at), _mm_set1_epi8('0'));
+	__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+	uint32_t count = sb_ctz32(~(uint32_t) _mm_movemask_epi8(is_digit));
+	if(count > 8) return false;
+
+	// right aligned in the low 8 bytes, which also zeroes whatever followed the digits,
+	// then pairs, quads and the whole run are multiply added together
+	__m128i aligned = _mm_sll_epi64(digits, _mm_cvtsi32_si128((int) (8 - count) * 8));
+	__m128i wide = _mm_unpacklo_epi8(aligned, _mm_setzero_si128());
+	__m128i pairs = _mm_madd_epi16(wide, _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+	__m128i quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+	__m128i eights = _mm_madd_epi16(_mm_packs_epi32(quads, quads), _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+	*out_value = (uint32_t) _mm_cvtsi128_si32(eights);
+	*out_count = count;
+	return true;
+}
+
+// digits of any length, for long numbers and the end of the text where 16 byte loads would read past it
+const char *parse_obj_decimal(const char *c, const char *end, uint64_t *out_mantissa, int32_t *out_exponent)
+{
+	uint64_t mantissa = 0;
+	int32_t exponent = 0;
+	for(; c < end && *c >= '0' && *c <= '9'; c++)
+	{
+		if(mantissa < 100000000000000000ULL) mantissa = mantissa * 10 + (uint64_t) (*c - '0');
+		else exponent++;
+	}
+	if(c < end && *c == '.')
+		for(c++; c < end && *c >= '0' && *c <= '9'; c++)
+			if(mantissa < 100000000000000000ULL)
+			{
+				mantissa = mantissa * 10 + (uint64_t) (*c - '0');
+				exponent--;
+			}
+
+	*out_mantissa = mantissa;
+	*out_exponent = exponent;
+	return c;
+}
+
+float parse_obj_float(const char **at, const char *end)
+{
+	const char *c = skip_obj_spaces(*at, end);
+	bool negative = c < end && *c == '-';
+	if(c < end && (*c == '-' || *c == '+')) c++;
+
+	// nearly every number an exporter writes has at most 8 digits on each side of the point
+	uint64_t mantissa = 0;
+	int32_t exponent = 0;
+	uint32_t integer = 0, integer_digits = 0, fraction = 0, fraction_digits = 0;
+	bool converted = end - c >= 33 && convert_digits(c, &integer, &integer_digits);
+	bool has_point = converted && c[integer_digits] == '.';
+	if(has_point) converted = convert_digits(c + integer_digits + 1, &fraction, &fraction_digits);
+
+	if(converted)
+	{
+		mantissa = (uint64_t) integer * DIGIT_SCALES[fraction_digits] + fraction;
+		exponent = -(int32_t) fraction_digits;
+		c += integer_digits + (has_point ? fraction_digits + 1 : 0);
+	}
+	else c = parse_obj_decimal(c, end, &mantissa, &exponent);
+
+	if(c < end && (*c == 'e' || *c == 'E'))
+	{
+		c++;
+		bool negative_exponent = c < end && *c == '-';
+		if(c < end && (*c == '-' || *c == '+')) c++;
+		int32_t written_exponent = 0;
+		for(; c < end && *c >= '0' && *c <= '9'; c++)
+			written_exponent = SB_MIN(written_exponent * 10 + (*c - '0'), 1000);
+		exponent += negative_exponent ? -written_exponent : written_exponent;
+	}
+	*at = c;
+
+	// mantissas stay below 2^53 and powers up to 1e22 are exact, so the common case rounds once
+	uint32_t magnitude = (uint32_t) (exponent < 0 ? -exponent : exponent);
+	double scale = magnitude < 23 ? POWERS_OF_TEN[magnitude] : pow(10.0, magnitude);
+	double value = exponent < 0 ? (double) mantissa / scale : (double) mantissa * scale;
+	return (float) (negative ? -value : value);
+}
+
+// 1 based, negative counts back from the attributes read so far. NO_ATTRIBUTE when there's no number here
+uint32_t parse_obj_index(const char **at, const char *end, uint32_t count)
+{
+	const char *c = *at;
+	bool negative = c < end && *c == '-';
+	if(negative) c++;
+
+	int64_t value = 0;
+	uint32_t converted_value = 0, digit_count = 0;
+	if(end - c >= 16 && convert_digits(c, &converted_value, &digit_count))
+	{
+		value = converted_value;
+		c += digit_count;
+	}
+	else
+	{
+		const char *digits = c;
+		for(; c < end && *c >= '0' && *c <= '9'; c++) value = SB_MIN(value * 10 + (*c - '0'), (int64_t) UINT32_MAX);
+		digit_count = (uint32_t) (c - digits);
+	}
+	*at = c;
+
+	if(digit_count == 0) return NO_ATTRIBUTE;
+	int64_t index = negative ? (int64_t) count - value : value - 1;
+	return index >= 0 && index < count ? (uint32_t) index : NO_ATTRIBUTE;
+}
+
+void count_obj_chunk(void *data)
+{
+	obj_chunk *chunk = data;
+	const char *end = chunk->end;
+	for(const char *line = chunk->begin; line < end; line = skip_obj_line(line, end))
+	{
+		const char *c = skip_obj_spaces(line, end);
+		if(end - c < 2) continue;
+
+		if(c[0] == 'v' && is_obj_space(c[1])) chunk->position_count++;
+		else if(c[0] == 'v' && c[1] == 't') chunk->uv_count++;
+		else if(c[0] == 'v' && c[1] == 'n') chunk->normal_count++;
+		else if(c[0] == 'f' && is_obj_space(c[1]))
+		{
+			uint32_t face_corners = 0;
+			for(c += 1; ; face_corners++)
+			{
+				c = skip_obj_spaces(c, end);
+				if(c == end || *c == '\n' || *c == '#') break;
+				while(c < end && !is_obj_space(*c) && *c != '\n') c++;
+			}
+			if(face_corners >= 3) chunk->triangle_count += face_corners - 2;
+		}
+	}
+}
+
+void parse_obj_chunk(void *data)
+{
+	obj_chunk *chunk = data;
+	const char *end = chunk->end;
+	sb_vec3 *positions = chunk->positions + chunk->first_position;
+	sb_vec2 *uvs = chunk->uvs + chunk->first_uv;
+	sb_vec3 *normals = chunk->normals + chunk->first_normal;
+	obj_corner *corners = chunk->corners + chunk->first_triangle * 3;
+
+	uint32_t positions_read = 0, uvs_read = 0, normals_read = 0, corners_written = 0;
+	for(const char *line = chunk->begin; line < end; line = skip_obj_line(line, end))
+	{
+		const char *c = skip_obj_spaces(line, end);
+		if(end - c < 2) continue;
+
+		if(c[0] == 'v' && is_obj_space(c[1]))
+		{
+			c += 1;
+			sb_vec3 *position = &positions[positions_read++];
+			position->x = parse_obj_float(&c, end);
+			position->y = parse_obj_float(&c, end);
+			position->z = parse_obj_float(&c, end);
+		}
+		else if(c[0] == 'v' && c[1] == 't')
+		{
+			c += 2;
+			sb_vec2 *uv = &uvs[uvs_read++];
+			uv->x = parse_obj_float(&c, end);
+			uv->y = 1.0f - parse_obj_float(&c, end);
+		}
+		else if(c[0] == 'v' && c[1] == 'n')
+		{
+			c += 2;
+			sb_vec3 *normal = &normals[normals_read++];
+			normal->x = parse_obj_float(&c, end);
+			normal->y = parse_obj_float(&c, end);
+			normal->z = parse_obj_float(&c, end);
+		}
+		else if(c[0] == 'f' && is_obj_space(c[1]))
+		{
+			// fanned around the first corner
+			obj_corner first = {0}, previous = {0};
+			uint32_t face_corners = 0;
+			for(c += 1; ; face_corners++)
+			{
+				c = skip_obj_spaces(c, end);
+				if(c == end || *c == '\n' || *c == '#') break;
+
+				obj_corner corner = {NO_ATTRIBUTE, NO_ATTRIBUTE, NO_ATTRIBUTE};
+				corner.position = parse_obj_index(&c, end, chunk->first_position + positions_read);
+				if(c < end && *c == '/')
+				{
+					c++;
+					corner.uv = parse_obj_index(&c, end, chunk->first_uv + uvs_read);
+					if(c < end && *c == '/')
+					{
+						c++;
+						corner.normal = parse_obj_index(&c, end, chunk->first_normal + normals_read);
+					}
+				}
+				while(c < end && !is_obj_space(*c) && *c != '\n') c++;
+				if(corner.position == NO_ATTRIBUTE) SB_PANIC("obj face references a vertex that doesn't exist");
+
+				if(face_corners >= 2)
+				{
+					corners[corners_written++] = first;
+					corners[corners_written++] = previous;
+					corners[corners_written++] = corner;
+				}
+				if(face_corners == 0) first = corner;
+				previous = corner;
+			}
+		}
+	}
+	assert(corners_written == chunk->triangle_count * 3);
+}
+
+static uint32_t hash_obj_corner(obj_corner corner)
+{
+	uint32_t hash = corner.position * 0x9e3779b1U ^ corner.uv * 0x85ebca77U ^ corner.normal * 0xc2b2ae3dU;
+	return hash ^ (hash >> 15);
+}
+
+bool sb_load_obj(sb_arena *arena, const char *text, uint64_t size, uint32_t thread_count, sb_obj_mesh *out_mesh)
+{
+	// chunks end on line breaks, each is counted and then parsed on its own thread
+	uint64_t chunk_limit = SB_MAX(size / MIN_CHUNK_SIZE, 1);
+	uint32_t chunk_count = (uint32_t) SB_MIN(SB_MIN(SB_MAX(thread_count, 1), SB_MAX_THREADS), chunk_limit);
+	obj_chunk chunks[SB_MAX_THREADS] = {0};
+	const char *end = text + size;
+	const char *chunk_begin = text;
+	for(uint32_t i = 0; i < chunk_count; i++)
+	{
+		const char *chunk_end = i + 1 < chunk_count ? text + size / chunk_count * (i + 1) : end;
+		if(chunk_end < chunk_begin) chunk_end = chunk_begin;
+		if(chunk_end < end && i + 1 < chunk_count) chunk_end = skip_obj_line(chunk_end, end);
+		chunks[i].begin = chunk_begin;
+		chunks[i].end = chunk_end;
+		chunk_begin = chunk_end;
+	}
+	sb_run_threads(count_obj_chunk, chunks, sizeof(obj_chunk), chunk_count);
+
+	uint32_t position_count = 0, uv_count = 0, normal_count = 0, triangle_count = 0;
+	for(uint32_t i = 0; i < chunk_count; i++)
+	{
+		chunks[i].first_position = position_count;
+		chunks[i].first_uv = uv_count;
+		chunks[i].first_normal = normal_count;
+		chunks[i].first_triangle = triangle_count;
+		position_count += chunks[i].position_count;
+		uv_count += chunks[i].uv_count;
+		normal_count += chunks[i].normal_count;
+		triangle_count += chunks[i].triangle_count;
+	}
+	if(triangle_count == 0 || position_count == 0) return false;
+
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	sb_vec3 *positions = sb_arena_push(scratch.arena, sb_vec3, position_count);
+	sb_vec2 *uvs = sb_arena_push(scratch.arena, sb_vec2, uv_count + 1);
+	sb_vec3 *normals = sb_arena_push(scratch.arena, sb_vec3, normal_count + 1);
+	obj_corner *corners = sb_arena_push(scratch.arena, obj_corner, triangle_count * 3);
+	for(uint32_t i = 0; i < chunk_count; i++)
+	{
+		chunks[i].positions = positions;
+		chunks[i].uvs = uvs;
+		chunks[i].normals = normals;
+		chunks[i].corners = corners;
+	}
+	sb_run_threads(parse_obj_chunk, chunks, sizeof(obj_chunk), chunk_count);
+
+	// distinct corners become vertices through an open addressed table of vertex index + 1, 0 is empty
+	uint32_t corner_count = triangle_count * 3;
+	uint32_t table_capacity = 1;
+	while(table_capacity < corner_count * 2) table_capacity <<= 1;
+	uint32_t *table = sb_arena_push(scratch.arena, uint32_t, table_capacity);
+	obj_corner *vertex_corners = sb_arena_push(scratch.arena, obj_corner, corner_count);
+
+	sb_obj_mesh mesh = {0};
+	mesh.indices = sb_arena_push(arena, uint32_t, corner_count);
+	mesh.index_count = corner_count;
+	for(uint32_t i = 0; i < corner_count; i++)
+	{
+		obj_corner corner = corners[i];
+		uint32_t slot = hash_obj_corner(corner) & (table_capacity - 1);
+		while(table[slot] != 0 && memcmp(&vertex_corners[table[slot] - 1], &corner, sizeof(corner)) != 0)
+			slot = (slot + 1) & (table_capacity - 1);
+		if(table[slot] == 0)
+		{
+			vertex_corners[mesh.vertex_count] = corner;
+			table[slot] = ++mesh.vertex_count;
+		}
+		mesh.indices[i] = table[slot] - 1;
+	}
+
+	// missing attributes read the zeroed slot past the end
+	mesh.vertices = sb_arena_push(arena, sb_vertex, mesh.vertex_count);
+	for(uint32_t i = 0; i < mesh.vertex_count; i++)
+	{
+		obj_corner corner = vertex_corners[i];
+		mesh.vertices[i].position = positions[corner.position];
+		mesh.vertices[i].uv = uvs[corner.uv == NO_ATTRIBUTE ? uv_count : corner.uv];
+		mesh.vertices[i].normal = normals[corner.normal == NO_ATTRIBUTE ? normal_count : corner.normal];
+	}
+
+	sb_release_scratch(&scratch);
+	*out_mesh = mesh;
+	return true;
+}
@@ -0,0 +1,79 @@
+#include "sb_pack.h"
+#include "sb_compression.h"
+#include "sb_common.h"
+
+#include <stdlib.h>
+
+bool sb_open_pack(const char *path, sb_pack *out_pack)
+{
+	SB_ZERO_STRUCT(out_pack);
+	if(!sb_file_exists(path)) return false;
+
+	out_pack->file = sb_map_file(path, SB_FILE_ACCESS_SEQUENTIAL);
+
+	const sb_pack_header *header = out_pack->file.data;
+	if(out_pack->file.size < sizeof(sb_pack_header) || header->magic != SB_PACK_MAGIC || header->version != SB_PACK_VERSION)
+		SB_PANIC("asset pack is corrupt or was built by a different packer version");
+
+	const uint8_t *base = out_pack->file.data;
+	out_pack->header = header;
+	out_pack->entries = (const sb_pack_entry*) (base + header->toc_offset);
+	out_pack->names = (const char*) (base + header->names_offset);
+	return true;
+}
+
+void sb_close_pack(sb_pack *pack)
+{
+	if(pack->file.data)
+		sb_unmap_file(&pack->file);
+	SB_ZERO_STRUCT(pack);
+}
+
+const sb_pack_entry *sb_pack_find(const sb_pack *pack, const char *path)
+{
+	if(!pack->header) return NULL;
+
+	sb_str8 name = sb_str8_from_cstr(path);
+	uint64_t hash = sb_str8_hash(name);
+
+	uint32_t low = 0;
+	uint32_t high = pack->header->entry_count;
+	while(low < high)
+	{
+		uint32_t mid = low + (high - low) / 2;
+		if(pack->entries[mid].path_hash < hash) low = mid + 1;
+		else high = mid;
+	}
+
+	for(uint32_t i = low; i < pack->header->entry_count && pack->entries[i].path_hash == hash; i++)
+	{
+		const sb_pack_entry *entry = &pack->entries[i];
+		if(sb_str8_eq(sb_pack_entry_name(pack, entry), name))
+			return entry;
+	}
+
+	return NULL;
+}
+
+const void *sb_pack_load(sb_arena *arena, const sb_pack *pack, const sb_pack_entry *entry)
+{
+	const void *stored = sb_pack_entry_stored(pack, entry);
+	if(!(entry->flags & SB_PACK_ENTRY_COMPRESSED_FLAG)) return stored;
+
+	void *raw = sb_arena_push_aligned(arena, entry->raw_size, SB_PACK_ALIGNMENT);
+	sb_decompress_blocks(stored, raw, entry->raw_size);
+	return raw;
+}
+
+const void *sb_pack_load_prefix(sb_arena *arena, const sb_pack *pack, const sb_pack_entry *entry, uint64_t size)
+{
+	const void *stored = sb_pack_entry_stored(pack, entry);
+	if(!(entry->flags & SB_PACK_ENTRY_COMPRESSED_FLAG)) return stored;
+
+	// blocks are independent, so the leading ones expand on their own
+	assert(size <= entry->raw_size);
+	uint64_t prefix_size = SB_MIN(sb_round_up(size, SB_COMPRESSION_BLOCK_SIZE), entry->raw_size);
+	void *raw = sb_arena_push_aligned(arena, prefix_size, SB_PACK_ALIGNMENT);
+	sb_decompress_blocks(stored, raw, prefix_size);
+	return raw;
+}
@@ -1,6 +1,24 @@
 #include "sb_string.h"
 
 #include <stdio.h>
+#include <string.h>
+
+sb_str8 sb_str8_from_cstr(const char *str)
+{
+    return (sb_str8) {(char*)str, strlen(str)};
+}
+
+sb_str8 sb_str8_copy(sb_arena *arena, sb_str8 s)
+{
+    sb_str8 ret;
+    ret.size = s.size;
+    ret.str = sb_arena_push(arena, char, ret.size + 1);
+
+    memcpy(ret.str, s.str, s.size);
+
+    ret.str[ret.size] = 0;
+    return ret;
+}
 
 sb_str8 sb_str8_concat(sb_arena *arena, sb_str8 s1, sb_str8 s2)
 {
@@ -24,3 +42,21 @@ sb_str8 sb_u8_to_str8(sb_arena *arena, uint8_t number)
 
     return (sb_str8) {str, len};
 }
+
+bool sb_str8_eq(sb_str8 lhs, sb_str8 rhs)
+{
+    return lhs.size == rhs.size && memcmp(lhs.str, rhs.str, lhs.size) == 0;
+}
+
+uint64_t sb_hash_bytes(const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
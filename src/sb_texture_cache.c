@@ -0,0 +1,104 @@
+#include "sb_texture_cache.h"
+#include "sb_common.h"
+#include "sb_math.h"
+#include "sb_string.h"
+
+#include <stdio.h>
+#include <string.h>
+
+uint64_t sb_get_texture_cache_key(const void *encoded, uint64_t encoded_size)
+{
+	// the decoded format is always rgba8, so the version is the only option besides the bytes themselves
+	uint64_t key = sb_hash_bytes(encoded, encoded_size) ^ (SB_TEXTURE_CACHE_VERSION * 0x9E3779B97F4A7C15ULL);
+	return key ? key : 1;
+}
+
+const char *sb_get_texture_cache_path(sb_arena *arena, uint64_t key)
+{
+	size_t path_size = sizeof(SB_TEXTURE_CACHE_DIRECTORY "/0123456789abcdef.sbt");
+	char *path = sb_arena_push(arena, char, path_size);
+	snprintf(path, path_size, SB_TEXTURE_CACHE_DIRECTORY "/%016llx.sbt", (unsigned long long) key);
+	return path;
+}
+
+uint64_t get_cache_data_offset(void)
+{
+	return sb_round_up(sizeof(sb_texture_file_header) + sizeof(sb_texture_file_level), SB_TEXTURE_FILE_ALIGNMENT);
+}
+
+// 0 when there's no entry, sb_map_file asserts on an empty file so the size is checked before mapping
+uint64_t get_cache_file_size(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if(!file) return 0;
+
+	fseek(file, 0, SEEK_END);
+	uint64_t size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+sb_mapped_file sb_open_texture_cache(uint64_t key, uint32_t width, uint32_t height)
+{
+	sb_mapped_file file = {0};
+	sb_arena_temp scratch = sb_get_scratch();
+	const char *path = sb_get_texture_cache_path(scratch.arena, key);
+
+	// entries are renamed into place once complete, anything else of the wrong size is a miss and gets rewritten
+	uint64_t expected_size = get_cache_data_offset() + (uint64_t) width * height * 4;
+	if(get_cache_file_size(path) == expected_size)
+	{
+		file = sb_map_file(path, SB_FILE_ACCESS_SEQUENTIAL);
+		const sb_texture_file_header *header = file.data;
+		bool is_complete = header->magic == SB_TEXTURE_FILE_MAGIC &&
+			header->version == SB_TEXTURE_FILE_VERSION && header->format == SB_TEXTURE_FILE_FORMAT_RGBA8 &&
+			header->mip_count == 1 && header->width == width && header->height == height;
+		if(!is_complete) sb_unmap_file(&file);
+	}
+	sb_release_scratch(&scratch);
+	return file;
+}
+
+void sb_write_texture_cache(uint64_t key, const uint8_t *rgba, uint32_t width, uint32_t height)
+{
+	sb_texture_file_header header = {0};
+	header.magic = SB_TEXTURE_FILE_MAGIC;
+	header.version = SB_TEXTURE_FILE_VERSION;
+	header.format = SB_TEXTURE_FILE_FORMAT_RGBA8;
+	header.mip_count = 1;
+	header.width = width;
+	header.height = height;
+
+	sb_texture_file_level level = {0};
+	level.offset = get_cache_data_offset();
+	level.size = (uint64_t) width * height * 4;
+
+	sb_arena_temp scratch = sb_get_scratch();
+	const char *path = sb_get_texture_cache_path(scratch.arena, key);
+	size_t temp_path_size = strlen(path) + sizeof(".tmp");
+	char *temp_path = sb_arena_push(scratch.arena, char, temp_path_size);
+	snprintf(temp_path, temp_path_size, "%s.tmp", path);
+	sb_create_directory(SB_TEXTURE_CACHE_DIRECTORY);
+
+	// written under a temporary name so a run killed partway never leaves a short entry at the real path.
+	// a read only install just goes without the cache
+	FILE *file = fopen(temp_path, "wb");
+	if(file)
+	{
+		static const uint8_t zeros[SB_TEXTURE_FILE_ALIGNMENT] = {0};
+		bool is_written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(&level, sizeof(level), 1, file) == 1 &&
+			fwrite(zeros, 1, level.offset - sizeof(header) - sizeof(level), file) == level.offset - sizeof(header) - sizeof(level) &&
+			fwrite(rgba, 1, level.size, file) == level.size;
+		is_written &= fclose(file) == 0;
+
+		// rename won't replace an existing file everywhere, a stale entry of the wrong size is removed first
+		if(is_written)
+		{
+			remove(path);
+			is_written = rename(temp_path, path) == 0;
+		}
+		if(!is_written) remove(temp_path);
+	}
+	sb_release_scratch(&scratch);
+}
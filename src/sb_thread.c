@@ -0,0 +1,94 @@
+#include "sb_thread.h"
+#include "sb_common.h"
+#include "sb_math.h"
+
+#include <assert.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+	sb_thread_proc *proc;
+	void *data;
+} thread_start;
+
+#if defined(_WIN32)
+uint32_t sb_get_processor_count(void)
+{
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	return SB_MAX(sys_info.dwNumberOfProcessors, 1);
+}
+
+static DWORD WINAPI run_thread_start(void *start)
+{
+	thread_start *thread = start;
+	thread->proc(thread->data);
+	return 0;
+}
+
+void sb_run_threads(sb_thread_proc *proc, void *data, size_t data_stride, uint32_t count)
+{
+	assert(count > 0 && count <= SB_MAX_THREADS);
+
+	thread_start starts[SB_MAX_THREADS];
+	HANDLE threads[SB_MAX_THREADS];
+	for(uint32_t i = 1; i < count; i++)
+	{
+		starts[i] = (thread_start) {proc, (char*) data + i * data_stride};
+		threads[i] = CreateThread(NULL, 0, run_thread_start, &starts[i], 0, NULL);
+		assert(threads[i]);
+	}
+
+	proc(data);
+
+	if(count > 1) WaitForMultipleObjects(count - 1, &threads[1], TRUE, INFINITE);
+	for(uint32_t i = 1; i < count; i++) CloseHandle(threads[i]);
+}
+
+uint32_t sb_atomic_add(volatile uint32_t *value, uint32_t amount)
+{
+	return (uint32_t) InterlockedExchangeAdd((volatile LONG*) value, (LONG) amount);
+}
+#else
+uint32_t sb_get_processor_count(void)
+{
+	long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+	return processor_count > 0 ? (uint32_t) processor_count : 1;
+}
+
+static void *run_thread_start(void *start)
+{
+	thread_start *thread = start;
+	thread->proc(thread->data);
+	return NULL;
+}
+
+void sb_run_threads(sb_thread_proc *proc, void *data, size_t data_stride, uint32_t count)
+{
+	assert(count > 0 && count <= SB_MAX_THREADS);
+
+	thread_start starts[SB_MAX_THREADS];
+	pthread_t threads[SB_MAX_THREADS];
+	for(uint32_t i = 1; i < count; i++)
+	{
+		starts[i] = (thread_start) {proc, (char*) data + i * data_stride};
+		int created = pthread_create(&threads[i], NULL, run_thread_start, &starts[i]);
+		assert(created == 0);
+	}
+
+	proc(data);
+
+	for(uint32_t i = 1; i < count; i++) pthread_join(threads[i], NULL);
+}
+
+uint32_t sb_atomic_add(volatile uint32_t *value, uint32_t amount)
+{
+	return __atomic_fetch_add(value, amount, __ATOMIC_SEQ_CST);
+}
+#endif
@@ -3,6 +3,10 @@
 #include "sb_common.h"
 #include "sb_arena.h"
 #include "sb_file.h"
+#include "sb_compression.h"
+#include "sb_texture_file.h"
+#include "sb_image.h"
+#include "sb_texture_cache.h"
 
 #include <memory.h>
 #include <stdio.h>
@@ -35,24 +39,247 @@ sb_transfer_buffer sb_create_transfer_buffer(VkDevice device,
 	staging_memory_info.memory_types = memory_types;
 	sb_allocate_device_arena(device, &staging_memory_info, &transfer_buffer.staging_memory);
 
+	sb_memory_info decompression_staging_info = {0};
+	decompression_staging_info.capacity = SB_DECOMPRESSION_MEMORY_SIZE;
+	decompression_staging_info.memory_usage = SB_MEMORY_USAGE_CPU;
+	decompression_staging_info.buffer_usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	decompression_staging_info.memory_types = memory_types;
+	sb_allocate_device_arena(device, &decompression_staging_info, &transfer_buffer.decompression_staging);
+
+	sb_memory_info decompression_input_info = {0};
+	decompression_input_info.capacity = SB_DECOMPRESSION_MEMORY_SIZE;
+	decompression_input_info.memory_usage = SB_MEMORY_USAGE_GPU;
+	decompression_input_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	decompression_input_info.memory_types = memory_types;
+	sb_allocate_buffer(device, &decompression_input_info, &transfer_buffer.decompression_input);
+
+	sb_memory_info decompression_output_info = {0};
+	decompression_output_info.capacity = SB_DECOMPRESSION_MEMORY_SIZE * 2;
+	decompression_output_info.memory_usage = SB_MEMORY_USAGE_GPU;
+	decompression_output_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	decompression_output_info.memory_types = memory_types;
+	sb_allocate_device_arena(device, &decompression_output_info, &transfer_buffer.decompression_output);
+
+	sb_memory_info decompression_blocks_info = {0};
+	decompression_blocks_info.capacity = sizeof(sb_decompression_blocks);
+	decompression_blocks_info.memory_usage = SB_MEMORY_USAGE_CPU;
+	decompression_blocks_info.buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	decompression_blocks_info.memory_types = memory_types;
+	sb_allocate_buffer(device, &decompression_blocks_info, &transfer_buffer.decompression_blocks);
+
 	return transfer_buffer;
 }
 
-void sb_queue_mesh_transfer(sb_transfer_buffer *transfer_buffer, const char *file_path)
+sb_mesh_transfer *insert_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_asset_priority priority)
+{
+	assert(transfer_buffer->mesh_transfer_count < SB_MAX_MESHES);
+
+	// the queue stays sorted so sb_transfer_assets only ever consumes a prefix of it
+	sb_mesh_transfer *queue = transfer_buffer->mesh_transfers;
+	uint32_t index = transfer_buffer->mesh_transfer_count;
+	while(index > 0 && queue[index - 1].priority < priority) index--;
+	memmove(&queue[index + 1], &queue[index], (transfer_buffer->mesh_transfer_count - index) * sizeof(sb_mesh_transfer));
+	transfer_buffer->mesh_transfer_count++;
+
+	sb_mesh_transfer *mesh_transfer = &queue[index];
+	SB_ZERO_STRUCT(mesh_transfer);
+	mesh_transfer->priority = priority;
+	return mesh_transfer;
+}
+
+sb_texture_transfer *insert_texture_transfer(sb_transfer_buffer *transfer_buffer, sb_asset_priority priority)
 {
-    sb_mesh_transfer *mesh_transfer = &transfer_buffer->mesh_transfers[transfer_buffer->mesh_transfer_count++];
+	assert(transfer_buffer->texture_transfer_count < SB_MAX_TEXTURES);
+
+	sb_texture_transfer *queue = transfer_buffer->texture_transfers;
+	uint32_t index = transfer_buffer->texture_transfer_count;
+	while(index > 0 && queue[index - 1].priority < priority) index--;
+	memmove(&queue[index + 1], &queue[index], (transfer_buffer->texture_transfer_count - index) * sizeof(sb_texture_transfer));
+	transfer_buffer->texture_transfer_count++;
+
+	sb_texture_transfer *texture_transfer = &queue[index];
+	SB_ZERO_STRUCT(texture_transfer);
+	texture_transfer->priority = priority;
+	return texture_transfer;
+}
 
-    mesh_transfer->mesh_file = sb_fopen(file_path, "rb");
+void sb_queue_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_mesh_id mesh_id, const char *file_path, sb_asset_priority priority)
+{
+    sb_mesh_transfer *mesh_transfer = insert_mesh_transfer(transfer_buffer, priority);
+    mesh_transfer->mesh_id = mesh_id;
+    mesh_transfer->mesh_file = sb_map_file(file_path, SB_FILE_ACCESS_SEQUENTIAL);
 
-    fread(mesh_transfer, sizeof(uint32_t), 2, mesh_transfer->mesh_file);
+    const void *file_data = mesh_transfer->mesh_file.data;
+    if(!sb_is_valid_mesh_file(file_data, mesh_transfer->mesh_file.size))
+        SB_PANIC("mesh file is truncated or was written by a newer version");
+    mesh_transfer->vertex_count = sb_get_mesh_file_vertex_count(file_data);
+    mesh_transfer->index_count = sb_get_mesh_file_index_count(file_data);
+    mesh_transfer->index_size = sb_get_mesh_file_index_size(file_data);
+    mesh_transfer->cluster_count = sb_get_mesh_file_cluster_count(file_data);
 
-	transfer_buffer->indices_to_transfer += mesh_transfer->index_count;
-	transfer_buffer->vertices_to_transfer += mesh_transfer->vertex_count;
+    // only meshes past what 16 bit indices address have 32 bit ones, counting their parts is a pass over lod 0's indices
+    if(mesh_transfer->vertex_count > SB_MESH_PART_MAX_VERTICES)
+    {
+        uint32_t lod_index_counts[SB_MAX_MESH_LODS];
+        float lod_errors[SB_MAX_MESH_LODS];
+        sb_get_mesh_file_lods(file_data, lod_index_counts, lod_errors);
+        uint32_t part_count = sb_split_mesh(sb_get_mesh_file_indices(file_data), lod_index_counts[0], mesh_transfer->vertex_count,
+            NULL, NULL, NULL, &mesh_transfer->split_vertex_count);
+        assert(part_count <= SB_MAX_MESH_PARTS);
+    }
 }
 
-sb_texture_transfer *sb_queue_texture_transfer(sb_transfer_buffer *transfer_buffer)
+void sb_queue_packed_mesh_transfer(sb_transfer_buffer *transfer_buffer, sb_mesh_id mesh_id, const sb_pack *pack, const sb_pack_entry *entry, sb_asset_priority priority)
 {
-	return &transfer_buffer->texture_transfers[transfer_buffer->texture_transfer_count++];
+    assert(entry->asset_type == SB_ASSET_TYPE_MESH);
+    sb_mesh_transfer *mesh_transfer = insert_mesh_transfer(transfer_buffer, priority);
+    mesh_transfer->mesh_id = mesh_id;
+
+    // counts come from the toc so nothing in the payload is touched until the transfer
+    mesh_transfer->pack = pack;
+    mesh_transfer->pack_entry = entry;
+    mesh_transfer->vertex_count = entry->metadata[0];
+    mesh_transfer->index_count = entry->metadata[1];
+    mesh_transfer->index_size = (entry->metadata[2] & SB_MESH_FILE_16_BIT_INDICES_FLAG) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // only meshes too big for 16 bit indices get split and only the ones that aren't have clusters, they share the slot
+    bool is_big = mesh_transfer->vertex_count > SB_MESH_PART_MAX_VERTICES;
+    mesh_transfer->split_vertex_count = is_big ? entry->metadata[3] : 0;
+    mesh_transfer->cluster_count = is_big ? 0 : entry->metadata[3];
+}
+
+sb_texture_transfer *sb_queue_texture_transfer(sb_transfer_buffer *transfer_buffer, sb_texture_id texture_id, sb_asset_priority priority)
+{
+	sb_texture_transfer *texture_transfer = insert_texture_transfer(transfer_buffer, priority);
+	texture_transfer->texture_id = texture_id;
+	return texture_transfer;
+}
+
+bool is_split_mesh(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer)
+{
+	return meshes->index_type == VK_INDEX_TYPE_UINT16 && transfer->split_vertex_count > 0;
+}
+
+bool can_copy_decompressed_mesh(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer)
+{
+	// the decompressed payload is copied as it is, so its indices have to be as wide as the index buffer's
+	return !is_split_mesh(meshes, transfer) && transfer->index_size == sb_get_index_size(meshes->index_type);
+}
+
+// split meshes have no clusters, their parts are drawn whole
+uint32_t get_mesh_cluster_count(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer)
+{
+	return is_split_mesh(meshes, transfer) ? 0 : transfer->cluster_count;
+}
+
+VkDeviceSize get_mesh_upload_size(const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer)
+{
+	uint32_t vertex_count = is_split_mesh(meshes, transfer) ? transfer->split_vertex_count : transfer->vertex_count;
+	return vertex_count * sizeof(sb_packed_vertex) + transfer->index_count * sb_get_index_size(meshes->index_type) +
+		get_mesh_cluster_count(meshes, transfer) * sizeof(sb_mesh_cluster);
+}
+
+VkDeviceSize get_mesh_staging_size(const sb_transfer_buffer *transfer_buffer, const sb_mesh_memory *meshes, const sb_mesh_transfer *transfer)
+{
+	// meshes the gpu expands only stage their compressed bytes, and their clusters from the cpu
+	const sb_pack_entry *entry = transfer->pack_entry;
+	if(is_gpu_decompressible(transfer_buffer, entry) && can_copy_decompressed_mesh(meshes, transfer))
+		return entry->stored_size + get_mesh_cluster_count(meshes, transfer) * sizeof(sb_mesh_cluster);
+
+	return get_mesh_upload_size(meshes, transfer);
+}
+
+void copy_indices(void *dst, uint32_t dst_index_size, const void *src, uint32_t src_index_size, uint32_t index_count)
+{
+	if(dst_index_size == src_index_size) memcpy(dst, src, index_count * dst_index_size);
+	else if(dst_index_size == sizeof(uint16_t))
+	{
+		// only meshes that fit in 16 bits get here unsplit
+		uint16_t *narrow = dst;
+		const uint32_t *wide = src;
+		for(uint32_t i = 0; i < index_count; i++)
+			narrow[i] = (uint16_t) wide[i];
+	}
+	else
+	{
+		uint32_t *wide = dst;
+		const uint16_t *narrow = src;
+		for(uint32_t i = 0; i < index_count; i++)
+			wide[i] = narrow[i];
+	}
+}
+
+uint32_t get_block_size(VkFormat format)
+{
+	switch(format)
+	{
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return 8;
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK: return 16;
+		default: return 0;
+	}
+}
+
+VkDeviceSize get_texture_staging_size(const sb_texture *texture)
+{
+	uint32_t block_size = get_block_size(texture->format);
+	if(block_size == 0) return (VkDeviceSize) texture->extent.width * texture->extent.height * 4;
+
+	// cooked chains are staged as laid out in the .sbt, every level padded to the file alignment
+	VkDeviceSize size = 0;
+	for(uint32_t level = 0; level < texture->mip_levels; level++)
+	{
+		VkOffset3D level_size = get_mip_size(texture->extent, level);
+		VkDeviceSize block_count = (VkDeviceSize) ((level_size.x + 3) / 4) * ((level_size.y + 3) / 4);
+		size += sb_round_up(block_count * block_size, SB_TEXTURE_FILE_ALIGNMENT);
+	}
+	return size;
+}
+
+void sb_host_copy_texture(VkDevice device, const sb_host_image_copy *host_image_copy, const sb_texture *texture, const void *const *level_pixels, uint32_t level_count)
+{
+	assert(texture->image_usage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT);
+	assert(level_count == texture->mip_levels && level_count <= SB_TEXTURE_FILE_MAX_LEVELS);
+
+	// nothing has been written yet so the transition can discard, the copy then lands in the layout the image is sampled in
+	VkHostImageLayoutTransitionInfoEXT transition = {0};
+	transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+	transition.image = texture->image;
+	transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	transition.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	transition.subresourceRange = (VkImageSubresourceRange) {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+	VK_CHECK(host_image_copy->transition_image_layout(device, 1, &transition));
+
+	VkMemoryToImageCopyEXT regions[SB_TEXTURE_FILE_MAX_LEVELS];
+	for(uint32_t level = 0; level < level_count; level++)
+	{
+		VkOffset3D level_size = get_mip_size(texture->extent, level);
+
+		VkMemoryToImageCopyEXT *region = &regions[level];
+		SB_ZERO_STRUCT(region);
+		region->sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+		region->pHostPointer = level_pixels[level];
+		region->imageSubresource = (VkImageSubresourceLayers) {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+		region->imageExtent = (VkExtent3D) {level_size.x, level_size.y, 1};
+	}
+
+	VkCopyMemoryToImageInfoEXT copy_info = {0};
+	copy_info.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+	copy_info.dstImage = texture->image;
+	copy_info.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	copy_info.regionCount = level_count;
+	copy_info.pRegions = regions;
+	VK_CHECK(host_image_copy->copy_memory_to_image(device, &copy_info));
+}
+
+bool fits_budget(const sb_transfer_buffer *transfer_buffer, sb_asset_priority priority, uint32_t assets_done, VkDeviceSize bytes_done, VkDeviceSize size, double start_ms)
+{
+	if(priority == SB_ASSET_PRIORITY_IMMEDIATE || assets_done == 0) return true;
+
+	const sb_transfer_budget *budget = &transfer_buffer->budget;
+	if(budget->bytes_per_frame > 0 && bytes_done + size > budget->bytes_per_frame) return false;
+	if(budget->ms_per_frame > 0.0f && sb_get_time_ms() - start_ms >= budget->ms_per_frame) return false;
+	return true;
 }
 
 VkBufferMemoryBarrier2 get_transfer_queue_release_barrier(sb_buffer *buffer, uint32_t transfer_index, uint32_t graphics_index)
@@ -70,38 +297,281 @@ VkBufferMemoryBarrier2 get_transfer_queue_release_barrier(sb_buffer *buffer, uin
 VkBufferMemoryBarrier2 get_graphics_queue_acquire_barrier(sb_buffer *buffer, uint32_t transfer_index, uint32_t graphics_index)
 {
 	VkBufferMemoryBarrier2KHR buffer_barrier = sb_get_buffer_barrier(buffer);
-    buffer_barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR;
-    buffer_barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR;
+    buffer_barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT |
+		VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_TRANSFER_WRITE_BIT;
     buffer_barrier.srcQueueFamilyIndex = transfer_index;
     buffer_barrier.dstQueueFamilyIndex = graphics_index;
 	return buffer_barrier;
 }
 
-void queue_image_transition_barriers(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], sb_texture_transfer *transfers, uint32_t transfer_count, const VkImageMemoryBarrier2 *template_barrier)
+// nothing waits on the upload's fence before drawing, the cull passes and the vertex stages read the mesh buffers
+// straight after it in submission order
+VkBufferMemoryBarrier2 get_mesh_upload_barrier(sb_buffer *buffer)
+{
+	VkBufferMemoryBarrier2 buffer_barrier = sb_get_buffer_barrier(buffer);
+	buffer_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	buffer_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	buffer_barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT |
+		VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	buffer_barrier.dstAccessMask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT;
+	return buffer_barrier;
+}
+
+void push_copy_region(sb_copy_regions *copies, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size)
+{
+	if(size == 0) return;
+
+	if(copies->count > 0)
+	{
+		VkBufferCopy *last = &copies->regions[copies->count - 1];
+		if(last->srcOffset + last->size == src_offset && last->dstOffset + last->size == dst_offset)
+		{
+			last->size += size;
+			return;
+		}
+	}
+
+	copies->regions[copies->count++] = (VkBufferCopy) {src_offset, dst_offset, size};
+}
+
+void copy_regions(VkCommandBuffer command_buffer, sb_buffer *src, sb_buffer *dst, const sb_copy_regions *copies)
+{
+	if(copies->count == 0) return;
+	vkCmdCopyBuffer(command_buffer, src->vk_buffer, dst->vk_buffer, copies->count, copies->regions);
+}
+
+bool is_gpu_decompressible(const sb_transfer_buffer *transfer_buffer, const sb_pack_entry *entry)
+{
+	return transfer_buffer->decompress_pipeline && entry && (entry->flags & SB_PACK_ENTRY_COMPRESSED_FLAG);
+}
+
+bool queue_gpu_decompression(sb_transfer_buffer *transfer_buffer, const sb_pack *pack, const sb_pack_entry *entry, VkDeviceSize *out_offset)
+{
+	if(!is_gpu_decompressible(transfer_buffer, entry)) return false;
+
+	sb_decompression_blocks *blocks = transfer_buffer->decompression_blocks.memory_ptr;
+	sb_device_arena *staging = &transfer_buffer->decompression_staging;
+	sb_device_arena *output = &transfer_buffer->decompression_output;
+	uint32_t block_count = sb_compression_block_count(entry->raw_size);
+
+	// whatever doesn't fit in this transfer gets expanded on the cpu instead
+	if(blocks->count + block_count > SB_MAX_DECOMPRESSION_BLOCKS
+		|| sb_round_up(staging->offset, 16) + entry->stored_size >= staging->capacity
+		|| sb_round_up(output->offset, 16) + entry->raw_size >= output->capacity)
+		return false;
+
+	VkDeviceSize input_offset = sb_offset_device_arena_aligned(staging, entry->stored_size, 16);
+	VkDeviceSize output_offset = sb_offset_device_arena_aligned(output, entry->raw_size, 16);
+	memcpy(sb_get_ptr(staging, input_offset), sb_pack_entry_stored(pack, entry), entry->stored_size);
+
+	// decompression_input mirrors the staging offsets, so all of staging goes over in a single copy
+	const uint32_t *block_offsets = sb_pack_entry_stored(pack, entry);
+	VkDeviceAddress input_address = transfer_buffer->decompression_input.address + input_offset;
+	VkDeviceAddress output_address = sb_get_address(output, output_offset);
+
+	for(uint32_t i = 0; i < block_count; i++)
+	{
+		uint64_t block_start = (uint64_t) i * SB_COMPRESSION_BLOCK_SIZE;
+
+		sb_decompression_block *block = &blocks->blocks[blocks->count++];
+		block->src = input_address + block_offsets[i];
+		block->dst = output_address + block_start;
+		block->stored_size = block_offsets[i + 1] - block_offsets[i];
+		block->raw_size = (uint32_t) SB_MIN(entry->raw_size - block_start, SB_COMPRESSION_BLOCK_SIZE);
+	}
+
+	*out_offset = output_offset;
+	return true;
+}
+
+void record_gpu_decompression(VkCommandBuffer command_buffer, sb_transfer_buffer *transfer_buffer)
+{
+	sb_buffer_copy_info input_copy = {0};
+	input_copy.src_buffer = (sb_buffer*) &transfer_buffer->decompression_staging;
+	input_copy.dst_buffer = &transfer_buffer->decompression_input;
+	input_copy.size = transfer_buffer->decompression_staging.offset;
+	sb_buffer_copy(command_buffer, &input_copy);
+
+	VkBufferMemoryBarrier2 input_barrier = sb_get_buffer_barrier(&transfer_buffer->decompression_input);
+	input_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	input_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	input_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	input_barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+	sb_buffer_barriers(command_buffer, &input_barrier, 1);
+
+	sb_decompression_blocks *blocks = transfer_buffer->decompression_blocks.memory_ptr;
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, transfer_buffer->decompress_pipeline);
+	vkCmdDispatch(command_buffer, (blocks->count + 63) / 64, 1, 1);
+
+	VkBufferMemoryBarrier2 output_barrier = sb_get_buffer_barrier((sb_buffer*) &transfer_buffer->decompression_output);
+	output_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	output_barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	output_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	output_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+	sb_buffer_barriers(command_buffer, &output_barrier, 1);
+}
+
+void queue_image_transition_barriers(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], sb_texture_transfer *transfers, uint32_t transfer_count, bool is_gpu_decompressed, const VkImageMemoryBarrier2 *template_barrier)
 {
 	sb_arena_temp scratch = sb_get_scratch();
 	VkImageMemoryBarrier2 *barriers = sb_arena_push(scratch.arena, VkImageMemoryBarrier2, transfer_count);
 
+	uint32_t barrier_count = 0;
 	for(uint16_t i = 0; i < transfer_count; i++)
 	{
 		sb_texture_transfer *transfer = &transfers[i];
+		if(transfer->is_host_copied || transfer->is_gpu_decompressed != is_gpu_decompressed) continue;
 		sb_texture *texture = &textures[transfer->texture_id];
 
-		VkImageMemoryBarrier2 *barrier = &barriers[i];
+		VkImageMemoryBarrier2 *barrier = &barriers[barrier_count++];
 		memcpy(barrier, template_barrier, sizeof(VkImageMemoryBarrier2));
 		barrier->image = texture->image;
 	}
 
-	sb_image_barriers(command_buffer, barriers, transfer_count);
+	sb_image_barriers(command_buffer, barriers, barrier_count);
+	sb_release_scratch(&scratch);
+}
+
+// image_copies holds every staged transfer's levels in queue order, only the ones coming out of src are recorded
+void record_texture_copies(VkCommandBuffer command_buffer, sb_buffer *src, sb_texture textures[SB_MAX_TEXTURES], const sb_texture_transfer *transfers, uint32_t transfer_count, bool is_gpu_decompressed, const VkBufferImageCopy2 *image_copies)
+{
+	uint32_t image_copy_index = 0;
+	for(uint32_t i = 0; i < transfer_count; i++)
+	{
+		const sb_texture_transfer *texture_transfer = &transfers[i];
+		if(texture_transfer->is_host_copied) continue;
+
+		const VkBufferImageCopy2 *regions = &image_copies[image_copy_index];
+		image_copy_index += texture_transfer->uploaded_levels;
+		if(texture_transfer->is_gpu_decompressed != is_gpu_decompressed) continue;
+
+		VkCopyBufferToImageInfo2 buffer_image_copy_info = {0};
+		buffer_image_copy_info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
+		buffer_image_copy_info.srcBuffer = src->vk_buffer;
+		buffer_image_copy_info.dstImage = textures[texture_transfer->texture_id].image;
+		buffer_image_copy_info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		buffer_image_copy_info.regionCount = texture_transfer->uploaded_levels;
+		buffer_image_copy_info.pRegions = regions;
+
+		vkCmdCopyBufferToImage2(command_buffer, &buffer_image_copy_info);
+	}
+}
+
+VkImageMemoryBarrier2 get_mip_barrier(const sb_texture *texture, uint32_t base_level, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout)
+{
+	VkImageMemoryBarrier2 barrier = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
+	barrier.image = texture->image;
+	barrier.subresourceRange.baseMipLevel = base_level;
+	barrier.subresourceRange.levelCount = level_count;
+	barrier.oldLayout = old_layout;
+	barrier.newLayout = new_layout;
+	return barrier;
+}
+
+VkOffset3D get_mip_size(VkExtent2D extent, uint32_t level)
+{
+	return (VkOffset3D) {SB_MAX(extent.width >> level, 1), SB_MAX(extent.height >> level, 1), 1};
+}
+
+void record_mip_generation(VkCommandBuffer command_buffer, sb_texture textures[SB_MAX_TEXTURES], const sb_texture_transfer *transfers, uint32_t transfer_count)
+{
+	sb_arena_temp scratch = sb_get_scratch();
+	VkImageMemoryBarrier2 *barriers = sb_arena_push(scratch.arena, VkImageMemoryBarrier2, transfer_count * 3);
+
+	uint32_t max_levels = 1;
+	for(uint32_t i = 0; i < transfer_count; i++)
+		max_levels = SB_MAX(max_levels, textures[transfers[i].texture_id].mip_levels);
+
+	// level by level across every texture, so each step waits on one barrier batch instead of one per image
+	for(uint32_t level = 1; level < max_levels; level++)
+	{
+		uint32_t barrier_count = 0;
+		for(uint32_t i = 0; i < transfer_count; i++)
+		{
+			const sb_texture *texture = &textures[transfers[i].texture_id];
+			if(texture->mip_levels <= level || transfers[i].uploaded_levels > level) continue;
+
+			VkImageMemoryBarrier2 *barrier = &barriers[barrier_count++];
+			*barrier = get_mip_barrier(texture, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			barrier->srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier->srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT;
+			barrier->dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+			barrier->dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+		}
+
+		sb_image_barriers(command_buffer, barriers, barrier_count);
+
+		for(uint32_t i = 0; i < transfer_count; i++)
+		{
+			const sb_texture *texture = &textures[transfers[i].texture_id];
+			if(texture->mip_levels <= level || transfers[i].uploaded_levels > level) continue;
+
+			VkImageBlit2 blit = {0};
+			blit.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
+			blit.srcSubresource = (VkImageSubresourceLayers) {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+			blit.srcOffsets[1] = get_mip_size(texture->extent, level - 1);
+			blit.dstSubresource = (VkImageSubresourceLayers) {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+			blit.dstOffsets[1] = get_mip_size(texture->extent, level);
+
+			VkBlitImageInfo2 blit_info = {0};
+			blit_info.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
+			blit_info.srcImage = texture->image;
+			blit_info.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			blit_info.dstImage = texture->image;
+			blit_info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			blit_info.regionCount = 1;
+			blit_info.pRegions = &blit;
+			blit_info.filter = VK_FILTER_LINEAR;
+
+			vkCmdBlitImage2(command_buffer, &blit_info);
+		}
+	}
+
+	// levels that were blit sources are in transfer src, everything else is still where its copy or blit left it
+	uint32_t barrier_count = 0;
+	for(uint32_t i = 0; i < transfer_count; i++)
+	{
+		if(transfers[i].is_host_copied) continue;
+		const sb_texture *texture = &textures[transfers[i].texture_id];
+		uint32_t last_level = texture->mip_levels - 1;
+		uint32_t first_source = transfers[i].uploaded_levels - 1;
+
+		if(first_source < last_level)
+		{
+			barriers[barrier_count++] = get_mip_barrier(texture, first_source, last_level - first_source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			barriers[barrier_count++] = get_mip_barrier(texture, last_level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			if(first_source > 0)
+				barriers[barrier_count++] = get_mip_barrier(texture, 0, first_source, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+		else barriers[barrier_count++] = get_mip_barrier(texture, 0, texture->mip_levels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	for(uint32_t i = 0; i < barrier_count; i++)
+	{
+		barriers[i].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barriers[i].srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT;
+		barriers[i].dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		barriers[i].dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	}
+
+	sb_image_barriers(command_buffer, barriers, barrier_count);
 	sb_release_scratch(&scratch);
 }
 
 void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb_mesh_memory *meshes, sb_texture textures[SB_MAX_TEXTURES])
 {
+	transfer_buffer->arrived_texture_count = 0;
+
 	bool has_mesh_transfers = transfer_buffer->mesh_transfer_count > 0;
 	bool has_texture_transfers = transfer_buffer->texture_transfer_count > 0;
+
+	// the previous upload usually finished alongside the last frame, when it hasn't everything but the fallbacks waits
+	if(!recycle_transfer(device, transfer_buffer, is_head_immediate(transfer_buffer))) return;
 	if(!has_mesh_transfers && !has_texture_transfers) return;
 
+	double start_ms = sb_get_time_ms();
+
 	VkCommandBuffer main_command_buffer = VK_NULL_HANDLE;
 	if(transfer_buffer->transfer_command_buffer)
 	{
@@ -112,71 +582,334 @@ void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb
 
 	sb_begin_command_buffer(main_command_buffer, true);
 
-	if(has_mesh_transfers)
+	sb_device_arena *staging = &transfer_buffer->staging_memory;
+	VkDeviceSize staging_reserve = sizeof(meshes->handles) + 64; // the handle upload and alignment padding
+
+	// meshes expanded on the gpu leave holes in staging, so the copies are split into runs around them
+	sb_arena_temp region_scratch = sb_get_scratch();
+	uint32_t region_capacity = transfer_buffer->mesh_transfer_count;
+	sb_copy_regions staging_vertex_regions = {sb_arena_push(region_scratch.arena, VkBufferCopy, region_capacity)};
+	sb_copy_regions staging_index_regions = {sb_arena_push(region_scratch.arena, VkBufferCopy, region_capacity)};
+	sb_copy_regions decompressed_vertex_regions = {sb_arena_push(region_scratch.arena, VkBufferCopy, region_capacity)};
+	sb_copy_regions decompressed_index_regions = {sb_arena_push(region_scratch.arena, VkBufferCopy, region_capacity)};
+	sb_copy_regions cluster_regions = {sb_arena_push(region_scratch.arena, VkBufferCopy, region_capacity)};
+	VkBufferImageCopy2 *image_copies = sb_arena_push(region_scratch.arena, VkBufferImageCopy2, transfer_buffer->texture_transfer_count * SB_TEXTURE_FILE_MAX_LEVELS);
+	uint32_t image_copy_count = 0;
+
+	sb_decompression_blocks *decompression_blocks = transfer_buffer->decompression_blocks.memory_ptr;
+	decompression_blocks->count = 0;
+
+	// both queues are sorted by priority, take from whichever head is more important until the budget runs out
+	uint32_t meshes_done = 0;
+	uint32_t textures_done = 0;
+	uint32_t staged_texture_count = 0;
+	VkDeviceSize bytes_done = 0;
+	while(meshes_done < transfer_buffer->mesh_transfer_count || textures_done < transfer_buffer->texture_transfer_count)
 	{
-		VkDeviceSize vertex_transfer_size = transfer_buffer->vertices_to_transfer * sizeof(sb_vertex);
-		VkDeviceSize index_transfer_size = transfer_buffer->indices_to_transfer * sizeof(uint32_t);
-		VkDeviceSize handle_transfer_size = transfer_buffer->mesh_transfer_count * sizeof(sb_mesh_handle);
+		sb_mesh_transfer *mesh_transfer = meshes_done < transfer_buffer->mesh_transfer_count ? &transfer_buffer->mesh_transfers[meshes_done] : NULL;
+		sb_texture_transfer *texture_transfer = textures_done < transfer_buffer->texture_transfer_count ? &transfer_buffer->texture_transfers[textures_done] : NULL;
+		bool is_mesh = mesh_transfer && (!texture_transfer || mesh_transfer->priority >= texture_transfer->priority);
+
+		sb_texture *texture = is_mesh ? NULL : &textures[texture_transfer->texture_id];
+		sb_asset_priority priority = is_mesh ? mesh_transfer->priority : texture_transfer->priority;
+		VkDeviceSize raw_size = is_mesh ? get_mesh_upload_size(meshes, mesh_transfer) : get_texture_staging_size(texture);
+		VkDeviceSize size = is_mesh ? get_mesh_staging_size(transfer_buffer, meshes, mesh_transfer) : raw_size;
+
+		uint32_t assets_done = meshes_done + textures_done;
+		if(!fits_budget(transfer_buffer, priority, assets_done, bytes_done, size, start_ms)) break;
+		bool is_host_copy = !is_mesh && (texture->image_usage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT);
+		if(!is_host_copy && staging->offset + raw_size + staging_reserve >= staging->capacity)
+		{
+			if(assets_done == 0) SB_PANIC("asset doesn't fit in the staging memory");
+			break;
+		}
+		bytes_done += size;
+
+		if(is_mesh)
+		{
+			uint32_t index_stride = (uint32_t) sb_get_index_size(meshes->index_type);
+			bool is_split = is_split_mesh(meshes, mesh_transfer);
+			uint32_t vertex_count = is_split ? mesh_transfer->split_vertex_count : mesh_transfer->vertex_count;
+			VkDeviceSize vertex_size = vertex_count * sizeof(sb_packed_vertex);
+			VkDeviceSize index_size = mesh_transfer->index_count * index_stride;
+			VkDeviceSize vertex_dst_offset = meshes->vertex_count * sizeof(sb_packed_vertex);
+			VkDeviceSize index_dst_offset = meshes->index_count * index_stride;
+
+			// clusters always come from the cpu, they sit before the vertices in the file
+			uint32_t cluster_count = get_mesh_cluster_count(meshes, mesh_transfer);
+			VkDeviceSize cluster_size = cluster_count * sizeof(sb_mesh_cluster);
+			VkDeviceSize cluster_staging_offset = sb_offset_device_arena_aligned(staging, cluster_size, _Alignof(sb_mesh_cluster));
+			assert(meshes->cluster_count + cluster_count <= SB_MAX_MESH_CLUSTERS);
+			push_copy_region(&cluster_regions, cluster_staging_offset, meshes->cluster_count * sizeof(sb_mesh_cluster), cluster_size);
+
+			// unsplit meshes are drawn as a single part
+			sb_mesh_part parts[SB_MAX_MESH_PARTS];
+			parts[0] = (sb_mesh_part) {0, vertex_count, 0, mesh_transfer->index_count};
+			uint32_t part_count = 1;
+
+			uint32_t lod_index_counts[SB_MAX_MESH_LODS];
+			float lod_errors[SB_MAX_MESH_LODS];
+			uint32_t lod_count;
+
+			sb_vec3 bounds_min, bounds_max;
+			VkDeviceSize decompressed_offset;
+			if(can_copy_decompressed_mesh(meshes, mesh_transfer) &&
+				queue_gpu_decompression(transfer_buffer, mesh_transfer->pack, mesh_transfer->pack_entry, &decompressed_offset))
+			{
+				// the handle needs the bounds on the cpu, only the block holding the header is expanded here
+				sb_arena_temp scratch = sb_get_scratch_with_conflicts(&region_scratch.arena, 1);
+				const sb_mesh_file_header *header = sb_pack_load_prefix(scratch.arena, mesh_transfer->pack, mesh_transfer->pack_entry, sizeof(sb_mesh_file_header) + cluster_size);
+				assert(!sb_is_mesh_file_v1(header) && header->version == SB_MESH_FILE_VERSION);
+				bounds_min = header->bounds_min;
+				bounds_max = header->bounds_max;
+				lod_count = sb_get_mesh_file_lods(header, lod_index_counts, lod_errors);
+				memcpy(sb_get_ptr(staging, cluster_staging_offset), sb_mesh_file_clusters(header), cluster_size);
+				sb_release_scratch(&scratch);
+
+				VkDeviceSize decompressed_vertices = decompressed_offset + sizeof(sb_mesh_file_header) + cluster_size;
+				push_copy_region(&decompressed_vertex_regions, decompressed_vertices, vertex_dst_offset, vertex_size);
+				push_copy_region(&decompressed_index_regions, decompressed_vertices + vertex_size, index_dst_offset, index_size);
+			}
+			else
+			{
+				// copy straight from the mapped file into staging, compressed pack entries go through scratch
+				sb_arena_temp scratch = sb_get_scratch_with_conflicts(&region_scratch.arena, 1);
+				const void *file_data = mesh_transfer->pack_entry
+					? sb_pack_load(scratch.arena, mesh_transfer->pack, mesh_transfer->pack_entry)
+					: mesh_transfer->mesh_file.data;
+
+				VkDeviceSize vertex_staging_offset = sb_offset_device_arena_aligned(staging, vertex_size, _Alignof(sb_packed_vertex));
+				VkDeviceSize index_staging_offset = sb_offset_device_arena_aligned(staging, index_size, index_stride);
+				sb_packed_vertex *staged_vertices = sb_get_ptr(staging, vertex_staging_offset);
+				void *staged_indices = sb_get_ptr(staging, index_staging_offset);
+
+				// v1 vertices are floats, they're packed on their way into staging after a first pass to find the bounds
+				const sb_vertex *vertices = NULL;
+				const sb_packed_vertex *packed_vertices = NULL;
+				if(sb_is_mesh_file_v1(file_data))
+				{
+					vertices = (const sb_vertex*) ((const sb_mesh_file_header_v1*) file_data + 1);
+					sb_get_vertex_bounds(vertices, mesh_transfer->vertex_count, &bounds_min, &bounds_max);
+				}
+				else
+				{
+					const sb_mesh_file_header *header = file_data;
+					bounds_min = header->bounds_min;
+					bounds_max = header->bounds_max;
+					packed_vertices = sb_mesh_file_vertices(header);
+				}
+				const void *indices = sb_get_mesh_file_indices(file_data);
+				lod_count = sb_get_mesh_file_lods(file_data, lod_index_counts, lod_errors);
+				if(cluster_count > 0) memcpy(sb_get_ptr(staging, cluster_staging_offset), sb_mesh_file_clusters(file_data), cluster_size);
 
-		VkDeviceSize vertex_scratch_offset = sb_offset_device_arena_aligned(&transfer_buffer->staging_memory, vertex_transfer_size, _Alignof(sb_vertex));
-		VkDeviceSize index_scratch_offset = sb_offset_device_arena_aligned(&transfer_buffer->staging_memory, index_transfer_size, _Alignof(uint32_t));
-		VkDeviceSize handle_scratch_offset = sb_offset_device_arena_aligned(&transfer_buffer->staging_memory, handle_transfer_size, _Alignof(sb_mesh_handle));
+				if(is_split)
+				{
+					// split meshes always have 32 bit indices in the file, they come out rebased to their part.
+					// only lod 0 is split, sbmopt doesn't give meshes this big any others
+					uint32_t *source_vertices = sb_arena_push(scratch.arena, uint32_t, vertex_count);
+					part_count = sb_split_mesh(indices, lod_index_counts[0], mesh_transfer->vertex_count, parts, source_vertices, staged_indices, NULL);
+					assert(meshes->part_count + part_count - 1 <= SB_MAX_MESH_PARTS);
 
-		sb_vertex *vertex_scratch = sb_get_ptr(&transfer_buffer->staging_memory, vertex_scratch_offset);
-		uint32_t *index_scratch = sb_get_ptr(&transfer_buffer->staging_memory, index_scratch_offset);
-		sb_mesh_handle *handle_scratch = sb_get_ptr(&transfer_buffer->staging_memory, handle_scratch_offset);
+					for(uint32_t i = 0; i < vertex_count; i++)
+					{
+						if(vertices) sb_pack_vertices(&staged_vertices[i], &vertices[source_vertices[i]], 1, bounds_min, bounds_max);
+						else memcpy(&staged_vertices[i], &packed_vertices[source_vertices[i]], sizeof(sb_packed_vertex));
+					}
+				}
+				else
+				{
+					if(vertices) sb_pack_vertices(staged_vertices, vertices, vertex_count, bounds_min, bounds_max);
+					else memcpy(staged_vertices, packed_vertices, vertex_size);
+					copy_indices(staged_indices, index_stride, indices, mesh_transfer->index_size, mesh_transfer->index_count);
+				}
 
-		uint32_t starting_vertex_offset = meshes->vertex_count * sizeof(sb_vertex);
-		uint32_t starting_index_offset = meshes->index_count * sizeof(uint32_t);
-		uint32_t starting_handle_offset = meshes->handle_count * sizeof(sb_mesh_handle);
+				push_copy_region(&staging_vertex_regions, vertex_staging_offset, vertex_dst_offset, vertex_size);
+				push_copy_region(&staging_index_regions, index_staging_offset, index_dst_offset, index_size);
 
-		uint32_t vertices_read = 0;
-		uint32_t indices_read = 0;
+				sb_release_scratch(&scratch);
+			}
 
-		for(int meshes_read = 0; meshes_read < transfer_buffer->mesh_transfer_count; meshes_read++)
+			// the mesh id's handle draws the first part and chains to the rest, built back to front to know the next one
+			uint32_t next_part = 0;
+			for(uint32_t part = part_count; part-- > 0;)
+			{
+				uint32_t handle_index = part == 0 ? mesh_transfer->mesh_id : SB_MAX_MESHES + meshes->part_count + part - 1;
+				sb_mesh_handle *handle = &meshes->handles[handle_index];
+				handle->vertex_offset = meshes->vertex_count + parts[part].first_vertex;
+				handle->vertex_count = parts[part].vertex_count;
+				handle->position_offset = bounds_min;
+				handle->position_scale = sb_vec3_sub(bounds_max, bounds_min);
+				handle->next_part = next_part;
+				handle->first_cluster = meshes->cluster_count;
+				handle->cluster_count = cluster_count;
+				next_part = handle_index;
+
+				// an unsplit mesh's lods follow each other from its first index
+				uint32_t first_index = meshes->index_count + parts[part].first_index;
+				handle->lod_count = is_split ? 1 : lod_count;
+				for(uint32_t lod = 0; lod < handle->lod_count; lod++)
+				{
+					uint32_t index_count = is_split ? parts[part].index_count : lod_index_counts[lod];
+					handle->lods[lod] = (sb_mesh_lod) {first_index, index_count};
+					handle->lod_errors[lod] = is_split ? 0.0f : lod_errors[lod];
+					first_index += index_count;
+				}
+			}
+
+			meshes->part_count += part_count - 1;
+			meshes->vertex_count += vertex_count;
+			meshes->index_count += mesh_transfer->index_count;
+			meshes->cluster_count += cluster_count;
+
+			if(!mesh_transfer->pack_entry)
+				sb_unmap_file(&mesh_transfer->mesh_file);
+			meshes_done++;
+		}
+		else
 		{
-			sb_mesh_transfer *mesh_transfer = &transfer_buffer->mesh_transfers[meshes_read];
+			sb_arena_temp scratch = sb_get_scratch_with_conflicts(&region_scratch.arena, 1);
+			const void *file_data = texture_transfer->image_file.data;
+			uint64_t file_size = texture_transfer->image_file.size;
+
+			// staged chains out of the pack are expanded by the gpu, the cpu only needs the level table to record the copies
+			VkDeviceSize decompressed_offset = 0;
+			bool is_gpu_decompressed = texture_transfer->is_texture_file && !is_host_copy &&
+				queue_gpu_decompression(transfer_buffer, texture_transfer->pack, texture_transfer->pack_entry, &decompressed_offset);
+			if(is_gpu_decompressed)
+			{
+				uint64_t table_size = sizeof(sb_texture_file_header) + SB_TEXTURE_FILE_MAX_LEVELS * sizeof(sb_texture_file_level);
+				file_data = sb_pack_load_prefix(scratch.arena, texture_transfer->pack, texture_transfer->pack_entry, SB_MIN(table_size, texture_transfer->pack_entry->raw_size));
+				file_size = texture_transfer->pack_entry->raw_size;
+			}
+			else if(texture_transfer->pack_entry)
+			{
+				file_data = sb_pack_load(scratch.arena, texture_transfer->pack, texture_transfer->pack_entry);
+				file_size = texture_transfer->pack_entry->raw_size;
+			}
+
+			uint32_t first_image_copy = image_copy_count;
+			if(texture_transfer->is_texture_file)
+			{
+				// cooked levels are already in the layout the copy wants, one memcpy stages the whole chain.
+				// cached textures only hold mip 0, the rest of a mipmapped chain is blitted from it like a decoded one
+				const sb_texture_file_header *header = file_data;
+				const sb_texture_file_level *levels = sb_texture_file_levels(header);
+				assert(header->mip_count <= texture->mip_levels);
+
+				if(is_host_copy)
+				{
+					const void *level_pixels[SB_TEXTURE_FILE_MAX_LEVELS];
+					for(uint32_t level = 0; level < header->mip_count; level++)
+						level_pixels[level] = (const uint8_t*) file_data + levels[level].offset;
+					sb_host_copy_texture(device, &transfer_buffer->host_image_copy, texture, level_pixels, header->mip_count);
+				}
+				else
+				{
+					uint64_t chain_start = levels[0].offset;
+					VkDeviceSize chain_offset = decompressed_offset + chain_start;
+					if(!is_gpu_decompressed)
+					{
+						uint64_t chain_size = levels[header->mip_count - 1].offset + levels[header->mip_count - 1].size - chain_start;
+						chain_offset = sb_offset_device_arena_aligned(staging, chain_size, SB_TEXTURE_FILE_ALIGNMENT);
+						memcpy(sb_get_ptr(staging, chain_offset), (const uint8_t*) file_data + chain_start, chain_size);
+					}
+
+					for(uint32_t level = 0; level < header->mip_count; level++)
+					{
+						VkOffset3D level_size = get_mip_size(texture->extent, level);
 
-			fread(&vertex_scratch[vertices_read], sizeof(sb_vertex), mesh_transfer->vertex_count, mesh_transfer->mesh_file);
-			fread(&index_scratch[indices_read], sizeof(uint32_t), mesh_transfer->index_count, mesh_transfer->mesh_file);
+						VkBufferImageCopy2 *buffer_image_copy = &image_copies[image_copy_count++];
+						SB_ZERO_STRUCT(buffer_image_copy);
+						buffer_image_copy->sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+						buffer_image_copy->bufferOffset = chain_offset + levels[level].offset - chain_start;
+						buffer_image_copy->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+						buffer_image_copy->imageSubresource.mipLevel = level;
+						buffer_image_copy->imageSubresource.layerCount = 1;
+						buffer_image_copy->imageExtent = (VkExtent3D) {level_size.x, level_size.y, 1};
+					}
+				}
+			}
+			else
+			{
+				// decoding happens here rather than at load time so it's paid for out of the frame budget. staged
+				// textures decode straight into the staging memory, the decoder only ever writes its output front to back
+				const uint8_t *pixels = texture_transfer->pixels;
+				if(!pixels && (is_host_copy || texture_transfer->cache_key))
+				{
+					// the cache is written from scratch memory, reading back out of write combined staging is slow
+					uint8_t *decoded = sb_arena_push(scratch.arena, uint8_t, raw_size);
+					bool is_decoded = sb_decode_image(file_data, file_size, decoded, raw_size);
+					assert(is_decoded);
+					pixels = decoded;
 
-			sb_mesh_handle *handle  = &handle_scratch[meshes_read];
-			handle->vertex_offset = meshes->vertex_count + vertices_read;
-			handle->vertex_count = mesh_transfer->vertex_count;
-			handle->first_index = meshes->index_count + indices_read;
-			handle->index_count = mesh_transfer->index_count;
+					if(texture_transfer->cache_key)
+						sb_write_texture_cache(texture_transfer->cache_key, pixels, texture->extent.width, texture->extent.height);
+				}
 
-			vertices_read += mesh_transfer->vertex_count;
-			indices_read += mesh_transfer->index_count;
+				if(is_host_copy)
+				{
+					const void *level_pixels[] = {pixels};
+					sb_host_copy_texture(device, &transfer_buffer->host_image_copy, texture, level_pixels, 1);
+				}
+				else
+				{
+					VkDeviceSize pixel_offset = sb_offset_device_arena_aligned(staging, raw_size, 16);
+					uint8_t *staged = sb_get_ptr(staging, pixel_offset);
+					if(pixels) memcpy(staged, pixels, raw_size);
+					else
+					{
+						bool is_decoded = sb_decode_image(file_data, file_size, staged, raw_size);
+						assert(is_decoded);
+					}
 
-			fclose(mesh_transfer->mesh_file);
+					VkBufferImageCopy2 *buffer_image_copy = &image_copies[image_copy_count++];
+					SB_ZERO_STRUCT(buffer_image_copy);
+					buffer_image_copy->sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+					buffer_image_copy->bufferOffset = pixel_offset;
+					buffer_image_copy->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					buffer_image_copy->imageSubresource.layerCount = 1;
+					buffer_image_copy->imageExtent = (VkExtent3D) {texture->extent.width, texture->extent.height, 1};
+				}
+			}
+
+			if(texture_transfer->image_file.data)
+				sb_unmap_file(&texture_transfer->image_file);
+			sb_release_scratch(&scratch);
+
+			// host copies are finished by the time the call returns, only staged textures wait on the submit below
+			texture_transfer->is_host_copied = is_host_copy;
+			texture_transfer->is_gpu_decompressed = is_gpu_decompressed;
+			texture_transfer->uploaded_levels = is_host_copy ? texture->mip_levels : image_copy_count - first_image_copy;
+			staged_texture_count += !is_host_copy;
+			texture->is_pending = false;
+			transfer_buffer->arrived_textures[transfer_buffer->arrived_texture_count++] = texture_transfer->texture_id;
+			textures_done++;
 		}
+	}
+
+	if(has_mesh_transfers)
+	{
+		// whatever is still queued draws the fallback, set after the loop in case the fallback itself just arrived
+		sb_mesh_handle fallback_handle = {0};
+		if(meshes->fallback_mesh != SB_NULL_MESH_ID)
+			fallback_handle = meshes->handles[meshes->fallback_mesh];
+
+		for(uint32_t i = meshes_done; i < transfer_buffer->mesh_transfer_count; i++)
+			meshes->handles[transfer_buffer->mesh_transfers[i].mesh_id] = fallback_handle;
 
-		meshes->vertex_count += vertices_read;
-		meshes->index_count  += indices_read;
-		meshes->handle_count += transfer_buffer->mesh_transfer_count;
-
-		sb_buffer_copy_info vertex_copy = {0};
-		vertex_copy.src_buffer = &transfer_buffer->staging_memory;
-		vertex_copy.src_offset = vertex_scratch_offset;
-		vertex_copy.dst_buffer = &meshes->vertex_buffer;
-		vertex_copy.dst_offset = starting_vertex_offset;
-		vertex_copy.size = vertex_transfer_size;
-		sb_buffer_copy(main_command_buffer, &vertex_copy);
-
-		sb_buffer_copy_info index_copy = {0};
-		index_copy.src_buffer = &transfer_buffer->staging_memory;
-		index_copy.src_offset = index_scratch_offset;
-		index_copy.dst_buffer = &meshes->index_buffer;
-		index_copy.dst_offset = starting_index_offset;
-		index_copy.size = index_transfer_size;
-		sb_buffer_copy(main_command_buffer, &index_copy);
+		// part handles sit after every mesh id, so they only go over once a mesh has been split
+		VkDeviceSize handle_transfer_size = (meshes->part_count > 0 ? SB_MAX_MESHES + meshes->part_count : meshes->mesh_count) * sizeof(sb_mesh_handle);
+		VkDeviceSize handle_scratch_offset = sb_offset_device_arena_aligned(staging, handle_transfer_size, _Alignof(sb_mesh_handle));
+		memcpy(sb_get_ptr(staging, handle_scratch_offset), meshes->handles, handle_transfer_size);
+
+		copy_regions(main_command_buffer, (sb_buffer*) staging, &meshes->vertex_buffer, &staging_vertex_regions);
+		copy_regions(main_command_buffer, (sb_buffer*) staging, &meshes->index_buffer, &staging_index_regions);
+		copy_regions(main_command_buffer, (sb_buffer*) staging, &meshes->cluster_buffer, &cluster_regions);
 
 		sb_buffer_copy_info handle_copy = {0};
-		handle_copy.src_buffer = &transfer_buffer->staging_memory;
+		handle_copy.src_buffer = staging;
 		handle_copy.src_offset = handle_scratch_offset;
 		handle_copy.dst_buffer = &meshes->handle_buffer;
-		handle_copy.dst_offset = starting_handle_offset;
 		handle_copy.size = handle_transfer_size;
 		sb_buffer_copy(main_command_buffer, &handle_copy);
 
@@ -186,6 +919,7 @@ void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb
 				get_transfer_queue_release_barrier(&meshes->vertex_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 				get_transfer_queue_release_barrier(&meshes->index_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 				get_transfer_queue_release_barrier(&meshes->handle_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
+				get_transfer_queue_release_barrier(&meshes->cluster_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 			};
 
 			sb_buffer_barriers(transfer_buffer->transfer_command_buffer, transfer_release, COUNTOF(transfer_release));
@@ -194,13 +928,44 @@ void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb
 				get_graphics_queue_acquire_barrier(&meshes->vertex_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 				get_graphics_queue_acquire_barrier(&meshes->index_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 				get_graphics_queue_acquire_barrier(&meshes->handle_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
+				get_graphics_queue_acquire_barrier(&meshes->cluster_buffer, transfer_buffer->transfer_queue_index, transfer_buffer->graphics_queue_index),
 			};
 
 			sb_buffer_barriers(transfer_buffer->graphics_command_buffer, graphics_acquire, COUNTOF(graphics_acquire));
 		}
+		else
+		{
+			VkBufferMemoryBarrier2 upload_barriers[] = {
+				get_mesh_upload_barrier(&meshes->vertex_buffer),
+				get_mesh_upload_barrier(&meshes->index_buffer),
+				get_mesh_upload_barrier(&meshes->handle_buffer),
+				get_mesh_upload_barrier(&meshes->cluster_buffer),
+			};
+
+			sb_buffer_barriers(main_command_buffer, upload_barriers, COUNTOF(upload_barriers));
+		}
 	}
 
-	if(has_texture_transfers)
+	// compute can't run on a dedicated transfer queue, so decompression is recorded after the acquire on the graphics queue
+	if(decompression_blocks->count > 0)
+		record_gpu_decompression(transfer_buffer->graphics_command_buffer, transfer_buffer);
+
+	if(decompressed_vertex_regions.count > 0 || decompressed_index_regions.count > 0)
+	{
+		VkCommandBuffer graphics_command_buffer = transfer_buffer->graphics_command_buffer;
+		copy_regions(graphics_command_buffer, (sb_buffer*) &transfer_buffer->decompression_output, &meshes->vertex_buffer, &decompressed_vertex_regions);
+		copy_regions(graphics_command_buffer, (sb_buffer*) &transfer_buffer->decompression_output, &meshes->index_buffer, &decompressed_index_regions);
+
+		// the copies land after the acquire, so they need their own barrier before anything draws from them
+		VkBufferMemoryBarrier2 decompressed_barriers[] = {
+			get_mesh_upload_barrier(&meshes->vertex_buffer),
+			get_mesh_upload_barrier(&meshes->index_buffer),
+		};
+
+		sb_buffer_barriers(graphics_command_buffer, decompressed_barriers, COUNTOF(decompressed_barriers));
+	}
+
+	if(staged_texture_count > 0)
 	{
 		VkImageMemoryBarrier2 transfer_barrier = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
 		transfer_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
@@ -210,107 +975,127 @@ void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb
 		queue_image_transition_barriers(main_command_buffer,
 			textures,
 			transfer_buffer->texture_transfers,
-			transfer_buffer->texture_transfer_count,
+			textures_done,
+			false,
 			&transfer_barrier
 		);
 
-		for(uint16_t i = 0; i < transfer_buffer->texture_transfer_count; i++)
-		{
-			sb_texture_transfer *transfer = &transfer_buffer->texture_transfers[i];
-			sb_texture *texture = &textures[transfer->texture_id];
-
-		   //TODO: remove stb_image as a dependency so i can just directly read into the staging memory. this is super annoying
-			VkDeviceSize pixel_memory_size = texture->extent.width * texture->extent.height * 4;
-			VkDeviceSize pixel_scratch_offset = sb_offset_device_arena(&transfer_buffer->staging_memory, char, pixel_memory_size);
-			void *pixel_scratch = sb_get_ptr(&transfer_buffer->staging_memory, pixel_scratch_offset);
-			memcpy(pixel_scratch, transfer->pixels, pixel_memory_size); 
-			free(transfer->pixels);
-
-			VkBufferImageCopy2 buffer_image_copy = {0};
-			buffer_image_copy.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
-			buffer_image_copy.bufferOffset = pixel_scratch_offset;
-			buffer_image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			buffer_image_copy.imageSubresource.layerCount = 1;
-			buffer_image_copy.imageExtent = (VkExtent3D) {texture->extent.width, texture->extent.height, 1};
-
-
-			VkCopyBufferToImageInfo2 buffer_image_copy_info = {0};
-			buffer_image_copy_info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
-			buffer_image_copy_info.srcBuffer = transfer_buffer->staging_memory.vk_buffer;
-			buffer_image_copy_info.dstImage = texture->image;
-			buffer_image_copy_info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			buffer_image_copy_info.regionCount = 1;
-			buffer_image_copy_info.pRegions = &buffer_image_copy;
-
-			vkCmdCopyBufferToImage2(main_command_buffer, &buffer_image_copy_info);
-		}
-
-		VkImageMemoryBarrier2 shader_read_only_barrier = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
-		shader_read_only_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		shader_read_only_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		shader_read_only_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		shader_read_only_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		shader_read_only_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-		shader_read_only_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-		shader_read_only_barrier.srcQueueFamilyIndex = transfer_buffer->transfer_queue_index;
-		shader_read_only_barrier.dstQueueFamilyIndex = transfer_buffer->graphics_queue_index;
-
-		queue_image_transition_barriers(main_command_buffer,
+		record_texture_copies(main_command_buffer,
+			(sb_buffer*) staging,
 			textures,
 			transfer_buffer->texture_transfers,
-			transfer_buffer->texture_transfer_count,
-			&shader_read_only_barrier
+			textures_done,
+			false,
+			image_copies
 		);
 
 		if(transfer_buffer->transfer_queue)
 		{
-			VkImageMemoryBarrier2 ownership_transfer = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
-			ownership_transfer.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			ownership_transfer.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			ownership_transfer.srcAccessMask = 0;
-			ownership_transfer.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			ownership_transfer.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			ownership_transfer.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-			ownership_transfer.srcQueueFamilyIndex = transfer_buffer->transfer_queue_index;
-			ownership_transfer.dstQueueFamilyIndex = transfer_buffer->graphics_queue_index;
+			// ownership moves over still in transfer dst, the blits and the sampling both happen on the graphics queue
+			VkImageMemoryBarrier2 transfer_release = sb_get_image_layout_transition_barrier(VK_IMAGE_ASPECT_COLOR_BIT);
+			transfer_release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			transfer_release.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			transfer_release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			transfer_release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			transfer_release.srcQueueFamilyIndex = transfer_buffer->transfer_queue_index;
+			transfer_release.dstQueueFamilyIndex = transfer_buffer->graphics_queue_index;
 
 			queue_image_transition_barriers(main_command_buffer,
 				textures,
 				transfer_buffer->texture_transfers,
-				transfer_buffer->texture_transfer_count,
-				&ownership_transfer
+				textures_done,
+				false,
+				&transfer_release
+			);
+
+			VkImageMemoryBarrier2 graphics_acquire = transfer_release;
+			graphics_acquire.srcAccessMask = 0;
+			graphics_acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			graphics_acquire.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			graphics_acquire.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+
+			queue_image_transition_barriers(transfer_buffer->graphics_command_buffer,
+				textures,
+				transfer_buffer->texture_transfers,
+				textures_done,
+				false,
+				&graphics_acquire
+			);
+		}
+
+		// chains expanded on the gpu never leave the graphics queue, they're copied once the decompression barrier is through
+		if(decompression_blocks->count > 0)
+		{
+			queue_image_transition_barriers(transfer_buffer->graphics_command_buffer,
+				textures,
+				transfer_buffer->texture_transfers,
+				textures_done,
+				true,
+				&transfer_barrier
+			);
+
+			record_texture_copies(transfer_buffer->graphics_command_buffer,
+				(sb_buffer*) &transfer_buffer->decompression_output,
+				textures,
+				transfer_buffer->texture_transfers,
+				textures_done,
+				true,
+				image_copies
 			);
 		}
+
+		record_mip_generation(transfer_buffer->graphics_command_buffer,
+			textures,
+			transfer_buffer->texture_transfers,
+			textures_done
+		);
 	}
 
-	sb_end_command_buffer(main_command_buffer);
+	sb_release_scratch(&region_scratch);
 
+	sb_end_command_buffer(main_command_buffer);
 	if(transfer_buffer->transfer_queue)
-	{
 		sb_end_command_buffer(transfer_buffer->graphics_command_buffer);
 
+	// when every texture went through host copies and no meshes are queued, nothing was recorded and there's nothing to wait for
+	if(has_mesh_transfers || staged_texture_count > 0)
+	{
+		if(transfer_buffer->transfer_queue)
+		{
+			sb_queue_submit_info submit_info = {0};
+			submit_info.command_buffer = transfer_buffer->transfer_command_buffer;
+			submit_info.signal_semaphore = transfer_buffer->transfer_queue_finished;
+			sb_queue_submit(transfer_buffer->transfer_queue, &submit_info);
+		}
+
 		sb_queue_submit_info submit_info = {0};
-		submit_info.command_buffer = transfer_buffer->transfer_command_buffer;
-		submit_info.signal_semaphore = transfer_buffer->transfer_queue_finished;
-		sb_queue_submit(transfer_buffer->transfer_queue, &submit_info);
+		submit_info.command_buffer = transfer_buffer->graphics_command_buffer;
+		submit_info.wait_semaphore = transfer_buffer->transfer_queue_finished;
+		submit_info.wait_stage_mask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		submit_info.fence = transfer_buffer->transfer_fully_finished;
+		sb_queue_submit(transfer_buffer->graphics_queue, &submit_info);
+		transfer_buffer->is_in_flight = true;
 	}
+	else reset_transfer_memory(device, transfer_buffer);
 
-	sb_queue_submit_info submit_info = {0};
-	submit_info.command_buffer = main_command_buffer;
-	submit_info.wait_semaphore = transfer_buffer->transfer_queue_finished;
-	submit_info.wait_stage_mask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
-	submit_info.fence = transfer_buffer->transfer_fully_finished;
-	sb_queue_submit(transfer_buffer->graphics_queue, &submit_info);
-
-	sb_wait_for_fence(device, transfer_buffer->transfer_fully_finished);
-	sb_reset_fence(device, transfer_buffer->transfer_fully_finished);
+	// whatever didn't fit the budget moves to the front and goes out next frame
+	transfer_buffer->mesh_transfer_count -= meshes_done;
+	memmove(transfer_buffer->mesh_transfers, &transfer_buffer->mesh_transfers[meshes_done], transfer_buffer->mesh_transfer_count * sizeof(sb_mesh_transfer));
+	transfer_buffer->texture_transfer_count -= textures_done;
+	memmove(transfer_buffer->texture_transfers, &transfer_buffer->texture_transfers[textures_done], transfer_buffer->texture_transfer_count * sizeof(sb_texture_transfer));
+}
 
-	transfer_buffer->indices_to_transfer = 0;
-	transfer_buffer->vertices_to_transfer = 0;
-	transfer_buffer->mesh_transfer_count = 0;
-	transfer_buffer->texture_transfer_count = 0;
+bool is_head_immediate(const sb_transfer_buffer *transfer_buffer)
+{
+	return (transfer_buffer->mesh_transfer_count > 0 && transfer_buffer->mesh_transfers[0].priority == SB_ASSET_PRIORITY_IMMEDIATE) ||
+		(transfer_buffer->texture_transfer_count > 0 && transfer_buffer->texture_transfers[0].priority == SB_ASSET_PRIORITY_IMMEDIATE);
+}
 
+void reset_transfer_memory(VkDevice device, sb_transfer_buffer *transfer_buffer)
+{
 	sb_reset_device_arena(&transfer_buffer->staging_memory);
+	sb_reset_device_arena(&transfer_buffer->decompression_staging);
+	sb_reset_device_arena(&transfer_buffer->decompression_output);
 
 	sb_reset_command_pool(device, transfer_buffer->graphics_command_pool);
 	sb_create_command_buffers(device, transfer_buffer->graphics_command_pool, &transfer_buffer->graphics_command_buffer, 1);
@@ -320,4 +1105,22 @@ void sb_transfer_assets(VkDevice device, sb_transfer_buffer *transfer_buffer, sb
 		sb_reset_command_pool(device, transfer_buffer->transfer_command_pool);
 		sb_create_command_buffers(device, transfer_buffer->transfer_command_pool, &transfer_buffer->transfer_command_buffer, 1);
 	}
-}
\ No newline at end of file
+}
+
+// false while the last submit is still running and should_wait isn't set
+bool recycle_transfer(VkDevice device, sb_transfer_buffer *transfer_buffer, bool should_wait)
+{
+	if(!transfer_buffer->is_in_flight) return true;
+	if(!should_wait && vkGetFenceStatus(device, transfer_buffer->transfer_fully_finished) != VK_SUCCESS) return false;
+
+	sb_wait_for_fence(device, transfer_buffer->transfer_fully_finished);
+	sb_reset_fence(device, transfer_buffer->transfer_fully_finished);
+	reset_transfer_memory(device, transfer_buffer);
+	transfer_buffer->is_in_flight = false;
+	return true;
+}
+
+bool sb_is_streaming(const sb_transfer_buffer *transfer_buffer)
+{
+	return transfer_buffer->is_in_flight || transfer_buffer->mesh_transfer_count > 0 || transfer_buffer->texture_transfer_count > 0;
+}
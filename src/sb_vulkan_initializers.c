@@ -4,6 +4,7 @@
 #include "sb_file.h"
 #include "sb_common.h"
 #include "sb_texture.h"
+#include "sb_math.h"
 
 
 #define MAX_QUEUE_CREATE_INFOS 2U
@@ -36,6 +37,7 @@ VkPhysicalDeviceVulkan12Features get_vulkan_12_features(void)
 	features.descriptorBindingPartiallyBound = VK_TRUE;
 	features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
 	features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
 	features.drawIndirectCount = VK_TRUE;
 	features.bufferDeviceAddress = VK_TRUE;
 	return features;
@@ -45,6 +47,7 @@ VkPhysicalDeviceFeatures get_vulkan_10_features(void)
 {
 	VkPhysicalDeviceFeatures features = {0};
 	features.shaderInt64 = VK_TRUE;
+	features.shaderStorageImageArrayDynamicIndexing = VK_TRUE;
 	return features;
 }
 VkInstance sb_create_instance(const char *app_name)
@@ -250,7 +253,89 @@ VkDeviceQueueCreateInfo get_queue_create_info(uint32_t family_index)
 	return queue_create_info;
 }
 
-VkDevice sb_create_device(VkPhysicalDevice physical_device, uint32_t transfer_queue_index, uint32_t graphics_queue_index)
+bool supports_extension(VkPhysicalDevice physical_device, const char *extension_name)
+{
+	uint32_t device_extension_count;
+	if (vkEnumerateDeviceExtensionProperties(physical_device, NULL, &device_extension_count, NULL) != VK_SUCCESS) return false;
+
+	sb_arena_temp scratch = sb_get_scratch();
+	VkExtensionProperties *extensions = sb_arena_push(scratch.arena, VkExtensionProperties, device_extension_count);
+	bool found_extension = false;
+	if (vkEnumerateDeviceExtensionProperties(physical_device, NULL, &device_extension_count, extensions) == VK_SUCCESS)
+	{
+		for (uint32_t i = 0; i < device_extension_count && !found_extension; i++)
+			found_extension = strcmp(extensions[i].extensionName, extension_name) == 0;
+	}
+
+	sb_release_scratch(&scratch);
+	return found_extension;
+}
+
+bool sb_supports_host_image_copy(VkPhysicalDevice physical_device)
+{
+	if (!supports_extension(physical_device, VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME)) return false;
+
+	VkPhysicalDeviceHostImageCopyFeaturesEXT host_image_copy_features = {0};
+	host_image_copy_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2 features_2 = {0};
+	features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features_2.pNext = &host_image_copy_features;
+	vkGetPhysicalDeviceFeatures2(physical_device, &features_2);
+	if (!host_image_copy_features.hostImageCopy) return false;
+
+	// uploads copy straight into the layout the textures are sampled in, so that one has to be a valid copy destination
+	VkPhysicalDeviceHostImageCopyPropertiesEXT host_image_copy_properties = {0};
+	host_image_copy_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties_2 = {0};
+	properties_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties_2.pNext = &host_image_copy_properties;
+	vkGetPhysicalDeviceProperties2(physical_device, &properties_2);
+
+	sb_arena_temp scratch = sb_get_scratch();
+	host_image_copy_properties.pCopySrcLayouts = sb_arena_push(scratch.arena, VkImageLayout, host_image_copy_properties.copySrcLayoutCount);
+	host_image_copy_properties.pCopyDstLayouts = sb_arena_push(scratch.arena, VkImageLayout, host_image_copy_properties.copyDstLayoutCount);
+	vkGetPhysicalDeviceProperties2(physical_device, &properties_2);
+
+	bool is_read_only_destination = false;
+	for (uint32_t i = 0; i < host_image_copy_properties.copyDstLayoutCount; i++)
+		is_read_only_destination |= host_image_copy_properties.pCopyDstLayouts[i] == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	sb_release_scratch(&scratch);
+	return is_read_only_destination;
+}
+
+bool sb_supports_host_image_copy_format(VkPhysicalDevice physical_device, VkFormat format)
+{
+	VkFormatProperties3 format_properties_3 = {0};
+	format_properties_3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+	VkFormatProperties2 format_properties_2 = {0};
+	format_properties_2.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+	format_properties_2.pNext = &format_properties_3;
+	vkGetPhysicalDeviceFormatProperties2(physical_device, format, &format_properties_2);
+
+	return (format_properties_3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) != 0;
+}
+
+bool sb_supports_bc_textures(VkPhysicalDevice physical_device)
+{
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(physical_device, &features);
+	return features.textureCompressionBC;
+}
+
+sb_host_image_copy sb_load_host_image_copy(VkDevice device)
+{
+	sb_host_image_copy host_image_copy = {0};
+	host_image_copy.copy_memory_to_image = (PFN_vkCopyMemoryToImageEXT) vkGetDeviceProcAddr(device, "vkCopyMemoryToImageEXT");
+	host_image_copy.transition_image_layout = (PFN_vkTransitionImageLayoutEXT) vkGetDeviceProcAddr(device, "vkTransitionImageLayoutEXT");
+	assert(host_image_copy.copy_memory_to_image && host_image_copy.transition_image_layout);
+	return host_image_copy;
+}
+
+VkDevice sb_create_device(VkPhysicalDevice physical_device, uint32_t transfer_queue_index, uint32_t graphics_queue_index, bool enable_host_image_copy, bool enable_bc_textures)
 {	
 	uint32_t queue_create_info_count = 0;
 	VkDeviceQueueCreateInfo queue_create_infos[MAX_QUEUE_CREATE_INFOS];
@@ -262,14 +347,28 @@ VkDevice sb_create_device(VkPhysicalDevice physical_device, uint32_t transfer_qu
 	VkPhysicalDeviceVulkan12Features vk12_features = get_vulkan_12_features();
 	vk12_features.pNext = &vk13_features;
 	VkPhysicalDeviceFeatures vk_features = get_vulkan_10_features();
+	vk_features.textureCompressionBC = enable_bc_textures;
+
+	const char *extensions[COUNTOF(ENABLED_DEVICE_EXTENSIONS) + 1];
+	memcpy(extensions, ENABLED_DEVICE_EXTENSIONS, sizeof(ENABLED_DEVICE_EXTENSIONS));
+	uint32_t extension_count = ENABLED_DEVICE_EXTENSION_COUNT;
+
+	VkPhysicalDeviceHostImageCopyFeaturesEXT host_image_copy_features = {0};
+	host_image_copy_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+	host_image_copy_features.hostImageCopy = VK_TRUE;
+	if(enable_host_image_copy)
+	{
+		extensions[extension_count++] = VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME;
+		vk13_features.pNext = &host_image_copy_features;
+	}
 
 	VkDeviceCreateInfo device_create_info = {0};
 	device_create_info.pNext = &vk12_features;
 	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	device_create_info.queueCreateInfoCount = queue_create_info_count;
 	device_create_info.pQueueCreateInfos = queue_create_infos;
-	device_create_info.enabledExtensionCount = ENABLED_DEVICE_EXTENSION_COUNT;
-	device_create_info.ppEnabledExtensionNames = ENABLED_DEVICE_EXTENSIONS;
+	device_create_info.enabledExtensionCount = extension_count;
+	device_create_info.ppEnabledExtensionNames = extensions;
 	device_create_info.pEnabledFeatures = &vk_features;
 
 	VkDevice device;
@@ -285,7 +384,7 @@ VkImageMemoryBarrier2 sb_get_image_layout_transition_barrier(VkImageAspectFlags
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
 	barrier.subresourceRange.baseMipLevel = 0;
 	barrier.subresourceRange.aspectMask = aspect_flags;
 	return barrier;
@@ -361,28 +460,32 @@ VkQueue sb_get_queue(VkDevice device, uint32_t family_index)
 
 VkShaderModule sb_create_shader_module(VkDevice device, const char *name)
 {
-	sb_arena_temp scratch = sb_get_scratch();
-
-	uint64_t size;
-	void *buffer = sb_read_file_binary(scratch.arena, name, &size);
+	// the driver copies the spirv during creation, so the mapped view only has to live for this call
+	sb_mapped_file file = sb_map_file(name, SB_FILE_ACCESS_SEQUENTIAL);
 
 	VkShaderModuleCreateInfo create_info = { 0 };
 	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	create_info.codeSize = size;
-	create_info.pCode = (uint32_t*) buffer;
+	create_info.codeSize = file.size;
+	create_info.pCode = (const uint32_t*) file.data;
 
 	VkShaderModule module;
 	VK_CHECK(vkCreateShaderModule(device, &create_info, NULL, &module));
-	sb_release_scratch(&scratch);
+	sb_unmap_file(&file);
 	return module;
 }
 
 VkPipelineLayout sb_create_pipeline_layout(VkDevice device, VkDescriptorSetLayout set_layout)
 {
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.size = SB_PUSH_CONSTANT_SIZE;
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info = {0};
 	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipeline_layout_create_info.pSetLayouts = &set_layout;
 	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
 
 	VkPipelineLayout pipeline_layout;
 	VK_CHECK(vkCreatePipelineLayout(device, &pipeline_layout_create_info, NULL, &pipeline_layout));
@@ -425,7 +528,9 @@ VkDescriptorPool sb_create_descriptor_pool(VkDevice device)
 {
     VkDescriptorPoolSize pool_sizes[] = {
 		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
-		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SB_MAX_TEXTURES},
+		{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, SB_MAX_TEXTURES},
+		{VK_DESCRIPTOR_TYPE_SAMPLER, SB_MAX_TEXTURES},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, SB_MAX_DEPTH_PYRAMID_LEVELS},
 	};
 
 	VkDescriptorPoolCreateInfo pool_create_info = {0};
@@ -440,7 +545,7 @@ VkDescriptorPool sb_create_descriptor_pool(VkDevice device)
     return pool;
 }
 
-VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlags samples)
+VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlags samples, uint32_t mip_levels)
 {
 	VkExtent3D image_extent = { 0 };
 	image_extent.width = extent.width;
@@ -452,7 +557,7 @@ VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkI
 	image_create_info.extent = image_extent;
 	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	image_create_info.imageType = VK_IMAGE_TYPE_2D;
-	image_create_info.mipLevels = 1;
+	image_create_info.mipLevels = mip_levels;
 	image_create_info.usage = usage;//VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	image_create_info.arrayLayers = 1;
 	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -465,7 +570,7 @@ VkImage sb_create_image(VkDevice device, VkExtent2D extent, VkFormat format, VkI
 	return texture_image;
 }
 
-VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag)
+VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag, uint32_t mip_levels)
 {
 	VkImageViewCreateInfo view_create_info = { 0 };
 	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -474,6 +579,24 @@ VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format
 	view_create_info.format = format;
 	view_create_info.subresourceRange.aspectMask = aspect_flag;
 	view_create_info.subresourceRange.baseMipLevel = 0;
+	view_create_info.subresourceRange.levelCount = mip_levels;
+	view_create_info.subresourceRange.baseArrayLayer = 0;
+	view_create_info.subresourceRange.layerCount = 1;
+
+	VkImageView view;
+	VK_CHECK(vkCreateImageView(device, &view_create_info, NULL, &view));
+	return view;
+}
+
+VkImageView sb_create_image_level_view(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect_flag, uint32_t mip_level)
+{
+	VkImageViewCreateInfo view_create_info = { 0 };
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = image;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format = format;
+	view_create_info.subresourceRange.aspectMask = aspect_flag;
+	view_create_info.subresourceRange.baseMipLevel = mip_level;
 	view_create_info.subresourceRange.levelCount = 1;
 	view_create_info.subresourceRange.baseArrayLayer = 0;
 	view_create_info.subresourceRange.layerCount = 1;
@@ -483,31 +606,56 @@ VkImageView sb_create_image_view(VkDevice device, VkImage image, VkFormat format
 	return view;
 }
 
-VkSampler sb_create_sampler(VkDevice device, VkSamplerAddressMode address_mode,VkBorderColor border_color)
+uint32_t sb_get_mip_level_count(VkExtent2D extent)
+{
+	// halve down to 1x1, floor(log2(max)) + 1
+	uint32_t largest = SB_MAX(extent.width, extent.height);
+	uint32_t level_count = 1;
+	while(largest > 1)
+	{
+		largest >>= 1;
+		level_count++;
+	}
+	return level_count;
+}
+
+VkSampler sb_create_sampler(VkDevice device, const sb_sampler_state *state)
 {
 	VkSamplerCreateInfo sampler_info = {0};
 	sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	sampler_info.magFilter = VK_FILTER_LINEAR;
-	sampler_info.minFilter = VK_FILTER_LINEAR;
-	sampler_info.addressModeU = address_mode;
-	sampler_info.addressModeV = address_mode;
-	sampler_info.addressModeW = address_mode;
+	sampler_info.magFilter = state->filter;
+	sampler_info.minFilter = state->filter;
+	sampler_info.addressModeU = state->address_mode;
+	sampler_info.addressModeV = state->address_mode;
+	sampler_info.addressModeW = state->address_mode;
 	sampler_info.anisotropyEnable = VK_FALSE;
 	sampler_info.maxAnisotropy = 1.0f;
-	sampler_info.borderColor = border_color;;
+	sampler_info.borderColor = state->border_color;
 	sampler_info.unnormalizedCoordinates = VK_FALSE;
 	sampler_info.compareEnable = VK_FALSE;
 	sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_info.mipmapMode = state->mipmap_mode;
 	sampler_info.mipLodBias = 0.0f;
 	sampler_info.minLod = 0.0f;
-	sampler_info.maxLod = 0.0f;
+	sampler_info.maxLod = state->is_base_level_only ? 0.0f : VK_LOD_CLAMP_NONE;
 
 	VkSampler sampler;
 	VK_CHECK(vkCreateSampler(device, &sampler_info, NULL, &sampler));
 	return sampler;
 }
 
+VkQueryPool sb_create_timestamp_query_pool(VkDevice device, uint32_t query_count)
+{
+	VkQueryPoolCreateInfo query_pool_info = {0};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = query_count;
+
+	VkQueryPool query_pool;
+	VK_CHECK(vkCreateQueryPool(device, &query_pool_info, NULL, &query_pool));
+	return query_pool;
+}
+
 void sb_queue_submit(VkQueue queue, const sb_queue_submit_info *queue_submit)
 {
 	VkSemaphoreSubmitInfo wait_info = {0};
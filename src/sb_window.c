@@ -56,6 +56,14 @@ float sb_get_dt(sb_window *window)
     return sb_clamp(dt_seconds, 0.00033f,0.40f);
 }
 
+double sb_get_time_ms(void)
+{
+    LARGE_INTEGER frequency, tick_count;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&tick_count);
+    return (double) tick_count.QuadPart * 1000.0 / (double) frequency.QuadPart;
+}
+
 bool sb_poll_events(sb_window *window, sb_window_event *event)
 {
     // dt implementation
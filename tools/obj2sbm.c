@@ -0,0 +1,122 @@
+// converts wavefront .obj files into the v2 .sbm files sb_queue_mesh_transfer loads: packed vertices across the mesh
+// bounds and 16 bit indices whenever the vertex count allows. sbmopt then reorders them for the gpu
+// usage: obj2sbm <input.obj> <output.sbm>
+//        obj2sbm <input directory> <output directory>, every .obj in it, one file per core at a time
+// a single file is split across every core instead, the .obj is memory mapped either way
+
+#include "sb_mesh_file.h"
+#include "sb_obj.h"
+#include "sb_common.h"
+#include "sb_thread.h"
+#include "sb_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+	const char *input_directory;
+	const char *output_directory;
+	const sb_str8 *names;
+	uint32_t name_count;
+	volatile uint32_t *next_name;
+
+	uint32_t converted_count;
+	uint64_t triangle_count;
+} batch_worker;
+
+static double get_time_ms(void)
+{
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return (double) now.tv_sec * 1000.0 + (double) now.tv_nsec / 1000000.0;
+}
+
+static uint32_t convert(sb_arena *arena, const char *input, const char *output, uint32_t thread_count)
+{
+	sb_mapped_file file = sb_map_file(input, SB_FILE_ACCESS_SEQUENTIAL);
+	sb_obj_mesh obj = {0};
+	bool loaded = sb_load_obj(arena, file.data, file.size, thread_count, &obj);
+	sb_unmap_file(&file);
+	if(!loaded)
+	{
+		fprintf(stderr, "%s has no faces, skipped\n", input);
+		return 0;
+	}
+
+	sb_vec3 bounds_min, bounds_max;
+	sb_get_vertex_bounds(obj.vertices, obj.vertex_count, &bounds_min, &bounds_max);
+	sb_packed_vertex *vertices = sb_arena_push(arena, sb_packed_vertex, obj.vertex_count);
+	sb_pack_vertices(vertices, obj.vertices, obj.vertex_count, bounds_min, bounds_max);
+	sb_write_mesh_file(output, vertices, obj.vertex_count, obj.indices, obj.index_count, bounds_min, bounds_max);
+	return obj.index_count / 3;
+}
+
+// files are handed out one at a time so a big one doesn't hold up everything queued behind it
+static void run_batch_worker(void *data)
+{
+	batch_worker *worker = data;
+	sb_arena *arena = sb_arena_alloc();
+	for(uint32_t i = sb_atomic_add(worker->next_name, 1); i < worker->name_count; i = sb_atomic_add(worker->next_name, 1))
+	{
+		const char *name = worker->names[i].str;
+		size_t stem_length = worker->names[i].size - 4;
+
+		char input[1024], output[1024];
+		snprintf(input, sizeof(input), "%s/%s", worker->input_directory, name);
+		snprintf(output, sizeof(output), "%s/%.*s.sbm", worker->output_directory, (int) stem_length, name);
+
+		uint32_t triangle_count = convert(arena, input, output, 1);
+		worker->converted_count += triangle_count > 0;
+		worker->triangle_count += triangle_count;
+		sb_reset_arena(arena);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "usage: obj2sbm <input.obj> <output.sbm>\n       obj2sbm <input directory> <output directory>\n");
+		return 1;
+	}
+
+	sb_arena *arena = sb_arena_alloc();
+	uint32_t processor_count = SB_MIN(sb_get_processor_count(), SB_MAX_THREADS);
+	double start = get_time_ms();
+
+	size_t input_length = strlen(argv[1]);
+	if(input_length > 4 && strcmp(argv[1] + input_length - 4, ".obj") == 0)
+	{
+		uint32_t triangle_count = convert(arena, argv[1], argv[2], processor_count);
+		if(triangle_count == 0) return 1;
+
+		printf("%s: %u triangles in %.1f ms\n", argv[2], triangle_count, get_time_ms() - start);
+		return 0;
+	}
+
+	uint32_t name_count = 0;
+	sb_str8 *names = sb_list_directory(arena, argv[1], ".obj", &name_count);
+	sb_create_directory(argv[2]);
+
+	batch_worker workers[SB_MAX_THREADS] = {0};
+	uint32_t worker_count = SB_MAX(SB_MIN(processor_count, name_count), 1);
+	volatile uint32_t next_name = 0;
+	for(uint32_t i = 0; i < worker_count; i++)
+		workers[i] = (batch_worker) {.input_directory = argv[1], .output_directory = argv[2], .names = names, .name_count = name_count,
+			.next_name = &next_name};
+	sb_run_threads(run_batch_worker, workers, sizeof(batch_worker), worker_count);
+
+	uint32_t converted_count = 0;
+	uint64_t triangle_count = 0;
+	for(uint32_t i = 0; i < worker_count; i++)
+	{
+		converted_count += workers[i].converted_count;
+		triangle_count += workers[i].triangle_count;
+	}
+
+	printf("%s: %u of %u objs, %llu triangles in %.1f ms on %u threads\n", argv[2], converted_count, name_count,
+		(unsigned long long) triangle_count, get_time_ms() - start, worker_count);
+	return converted_count == name_count ? 0 : 1;
+}
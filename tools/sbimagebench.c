@@ -0,0 +1,112 @@
+// times sb_image against stb_image on the same encoded images, the best of several runs of each
+// also reports the largest per channel difference between the two, png should always be 0 and jpeg a few levels
+// usage: sbimagebench <image>... [--runs <count>]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "sb_image.h"
+#include "sb_common.h"
+#include "sb_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double get_time_ms(void)
+{
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return (double) now.tv_sec * 1000.0 + (double) now.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 2)
+	{
+		fprintf(stderr, "usage: sbimagebench <image>... [--runs <count>]\n");
+		return 1;
+	}
+
+	uint32_t run_count = 10;
+	for(int i = 1; i + 1 < argc; i++)
+		if(strcmp(argv[i], "--runs") == 0) run_count = (uint32_t) SB_MAX(atoi(argv[i + 1]), 1);
+
+	sb_arena *arena = sb_arena_alloc();
+	double total_sb_ms = 0.0;
+	double total_stb_ms = 0.0;
+
+	printf("%-24s %11s %10s %10s %8s %9s\n", "image", "size", "sb ms", "stb ms", "speedup", "max diff");
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--runs") == 0)
+		{
+			i++;
+			continue;
+		}
+
+		sb_arena_temp temp = sb_arena_temp_begin(arena);
+		uint64_t encoded_size = 0;
+		const void *encoded = sb_read_file_binary(arena, argv[i], &encoded_size);
+
+		sb_image_info info = {0};
+		if(!sb_get_image_info(encoded, encoded_size, &info))
+		{
+			printf("%-24s not an image sb_image decodes\n", argv[i]);
+			sb_arena_temp_end(&temp);
+			continue;
+		}
+
+		size_t rgba_size = (size_t) info.width * info.height * 4;
+		uint8_t *rgba = sb_arena_push(arena, uint8_t, rgba_size);
+		uint8_t *reference = NULL;
+
+		// the first run of each warms the caches and the scratch arenas and isn't counted
+		double best_sb_ms = 1e30;
+		double best_stb_ms = 1e30;
+		bool is_decoded = true;
+		for(uint32_t run = 0; run <= run_count; run++)
+		{
+			double start = get_time_ms();
+			is_decoded &= sb_decode_image(encoded, encoded_size, rgba, rgba_size);
+			double sb_ms = get_time_ms() - start;
+
+			start = get_time_ms();
+			int width, height, channels;
+			stbi_image_free(reference);
+			reference = stbi_load_from_memory(encoded, (int) encoded_size, &width, &height, &channels, STBI_rgb_alpha);
+			double stb_ms = get_time_ms() - start;
+
+			if(run == 0) continue;
+			best_sb_ms = SB_MIN(best_sb_ms, sb_ms);
+			best_stb_ms = SB_MIN(best_stb_ms, stb_ms);
+		}
+
+		if(!is_decoded || !reference)
+		{
+			printf("%-24s failed to decode with %s\n", argv[i], is_decoded ? "stb_image" : "sb_image");
+			stbi_image_free(reference);
+			sb_arena_temp_end(&temp);
+			continue;
+		}
+
+		int max_difference = 0;
+		for(size_t byte = 0; byte < rgba_size; byte++)
+			max_difference = SB_MAX(max_difference, abs((int) rgba[byte] - (int) reference[byte]));
+		stbi_image_free(reference);
+
+		const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+		char size[32];
+		snprintf(size, sizeof(size), "%ux%u", info.width, info.height);
+		printf("%-24s %11s %10.2f %10.2f %7.2fx %9d\n", name, size, best_sb_ms, best_stb_ms, best_stb_ms / best_sb_ms, max_difference);
+
+		total_sb_ms += best_sb_ms;
+		total_stb_ms += best_stb_ms;
+		sb_arena_temp_end(&temp);
+	}
+
+	if(total_sb_ms > 0.0)
+		printf("%-24s %11s %10.2f %10.2f %7.2fx\n", "total", "", total_sb_ms, total_stb_ms, total_stb_ms / total_sb_ms);
+	return 0;
+}
@@ -0,0 +1,874 @@
+// optimizes an .sbm, or converts an .obj into one, for the way the gpu draws it: welds vertices that packed to the same
+// bytes, orders triangles for the post-transform vertex cache (tipsify), regroups those clusters so outward facing ones
+// draw first to cut overdraw, then lays the vertices out in the order they're fetched. an order that measures worse than
+// the one the mesh came in with is dropped. acmr and atvr are measured against a fifo cache before and after. lods are simplified from the welded mesh by edge collapses before any of the
+// ordering, each one about half the triangles of the last, and every lod is ordered on its own. last, lod 0's ordered
+// triangles are cut into runs of at most SB_MESH_CLUSTER_MAX_VERTICES vertices and SB_MESH_CLUSTER_MAX_TRIANGLES
+// triangles, with the bounds and normal cone the gpu culls each one by
+// usage: sbmopt <input.sbm|input.obj> <output.sbm> [--cache <size>] [--overdraw <threshold>] [--lods <count>]
+// cache is the fifo size to tune for (16 by default), threshold is how much acmr the overdraw pass may give up (1.05),
+// count is how many lods to keep at most, lod 0 included (SB_MAX_MESH_LODS)
+
+#include "sb_mesh_file.h"
+#include "sb_obj.h"
+#include "sb_common.h"
+#include "sb_string.h"
+#include "sb_file.h"
+#include "sb_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#define NO_VERTEX UINT32_MAX
+#define MAX_VALENCE 32 // vertices with more neighbours than this are never collapsed
+#define LOD_MAX_ERROR 0.05f // of the bounds diagonal, no collapse strays further from the surface
+
+typedef struct
+{
+	sb_packed_vertex *vertices;
+	uint32_t vertex_count;
+	uint32_t *indices; // widened to 32 bits while optimizing
+	uint32_t index_count;
+	sb_vec3 bounds_min;
+	sb_vec3 bounds_max;
+} mesh;
+
+// a vertex is cached while fewer than size misses happened after its own
+typedef struct
+{
+	uint32_t *entered;
+	uint32_t time;
+	uint32_t size;
+} fifo_cache;
+
+typedef struct
+{
+	float key;
+	uint32_t first_triangle;
+	uint32_t triangle_count;
+} cluster;
+
+// the upper triangle of a symmetric 4x4, a sum of area weighted plane quadrics (garland and heckbert 1997)
+typedef struct
+{
+	double q[10];
+	double weight;
+} quadric;
+
+typedef struct
+{
+	double cost;
+	uint32_t vertex;
+	uint32_t target;
+} collapse;
+
+typedef struct
+{
+	uint32_t *offsets; // vertex_count + 1 of them
+	uint32_t *triangles;
+} vertex_triangles;
+
+// state that carries over from one lod to the next, quadrics keep summing so later lods measure against lod 0
+typedef struct
+{
+	uint32_t vertex_count;
+	sb_vec3 *positions;
+	quadric *quadrics;
+	bool *locked; // shares its position with another vertex, a uv or normal seam, collapsing it would tear the seam open
+} simplifier;
+
+static mesh load_mesh(sb_arena *arena, const char *name)
+{
+	mesh result = {0};
+	size_t name_length = strlen(name);
+	if(name_length > 4 && strcmp(name + name_length - 4, ".obj") == 0)
+	{
+		sb_mapped_file file = sb_map_file(name, SB_FILE_ACCESS_SEQUENTIAL);
+		sb_obj_mesh obj = {0};
+		if(!sb_load_obj(arena, file.data, file.size, sb_get_processor_count(), &obj)) SB_PANIC("input obj has no faces");
+		sb_unmap_file(&file);
+
+		result.vertex_count = obj.vertex_count;
+		result.indices = obj.indices;
+		result.index_count = obj.index_count;
+		sb_get_vertex_bounds(obj.vertices, obj.vertex_count, &result.bounds_min, &result.bounds_max);
+		result.vertices = sb_arena_push(arena, sb_packed_vertex, obj.vertex_count);
+		sb_pack_vertices(result.vertices, obj.vertices, obj.vertex_count, result.bounds_min, result.bounds_max);
+		return result;
+	}
+
+	uint64_t size = 0;
+	const void *data = sb_read_file_binary(arena, name, &size);
+	if(!sb_is_valid_mesh_file(data, size)) SB_PANIC("input sbm is truncated or corrupt");
+	const sb_mesh_file_header *header = sb_upgrade_mesh_file(arena, data, &size);
+	result.vertex_count = header->vertex_count;
+	result.index_count = header->lod_index_counts[0]; // lods are built again from lod 0
+	result.bounds_min = header->bounds_min;
+	result.bounds_max = header->bounds_max;
+
+	result.vertices = sb_arena_push(arena, sb_packed_vertex, header->vertex_count);
+	memcpy(result.vertices, sb_mesh_file_vertices(header), header->vertex_count * sizeof(sb_packed_vertex));
+	result.indices = sb_arena_push(arena, uint32_t, result.index_count);
+	if(sb_mesh_file_index_size(header) == sizeof(uint16_t))
+	{
+		const uint16_t *narrow_indices = sb_mesh_file_indices(header);
+		for(uint32_t i = 0; i < result.index_count; i++) result.indices[i] = narrow_indices[i];
+	}
+	else memcpy(result.indices, sb_mesh_file_indices(header), result.index_count * sizeof(uint32_t));
+	return result;
+}
+
+static fifo_cache alloc_cache(sb_arena *arena, uint32_t vertex_count, uint32_t size)
+{
+	fifo_cache cache = {0};
+	cache.entered = sb_arena_push(arena, uint32_t, vertex_count);
+	memset(cache.entered, 0, vertex_count * sizeof(uint32_t));
+	cache.time = size + 1;
+	cache.size = size;
+	return cache;
+}
+
+static void flush_cache(fifo_cache *cache)
+{
+	cache->time += cache->size + 1;
+}
+
+static uint32_t cache_triangle(fifo_cache *cache, const uint32_t *triangle)
+{
+	uint32_t misses = 0;
+	for(uint32_t corner = 0; corner < 3; corner++)
+	{
+		uint32_t vertex = triangle[corner];
+		if(cache->time - cache->entered[vertex] > cache->size)
+		{
+			cache->entered[vertex] = cache->time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+// vertices transformed per triangle (acmr) and per vertex (atvr), 0.5 and 1 are the ideal for a regular grid
+static void get_cache_stats(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size, float *out_acmr, float *out_atvr)
+{
+	sb_arena_temp scratch = sb_get_scratch();
+	fifo_cache cache = alloc_cache(scratch.arena, vertex_count, cache_size);
+
+	uint32_t transformed = 0;
+	for(uint32_t i = 0; i + 2 < index_count; i += 3) transformed += cache_triangle(&cache, &indices[i]);
+	*out_acmr = index_count >= 3 ? (float) transformed / (float) (index_count / 3) : 0.0f;
+	*out_atvr = vertex_count > 0 ? (float) transformed / (float) vertex_count : 0.0f;
+
+	sb_release_scratch(&scratch);
+}
+
+// identical packed vertices become one and triangles that collapse because of it are dropped
+static void weld_vertices(mesh *m)
+{
+	sb_arena_temp scratch = sb_get_scratch();
+	uint32_t table_capacity = 1;
+	while(table_capacity < m->vertex_count * 2) table_capacity <<= 1;
+	uint32_t *table = sb_arena_push(scratch.arena, uint32_t, table_capacity);
+	uint32_t *remap = sb_arena_push(scratch.arena, uint32_t, m->vertex_count);
+	memset(table, 0xff, table_capacity * sizeof(uint32_t));
+
+	// compacted in place, a vertex only ever moves towards the front
+	uint32_t welded_count = 0;
+	for(uint32_t i = 0; i < m->vertex_count; i++)
+	{
+		uint32_t slot = (uint32_t) sb_hash_bytes(&m->vertices[i], sizeof(sb_packed_vertex)) & (table_capacity - 1);
+		while(table[slot] != NO_VERTEX && memcmp(&m->vertices[table[slot]], &m->vertices[i], sizeof(sb_packed_vertex)) != 0)
+			slot = (slot + 1) & (table_capacity - 1);
+
+		if(table[slot] == NO_VERTEX)
+		{
+			m->vertices[welded_count] = m->vertices[i];
+			table[slot] = welded_count++;
+		}
+		remap[i] = table[slot];
+	}
+
+	uint32_t index_count = 0;
+	for(uint32_t i = 0; i + 2 < m->index_count; i += 3)
+	{
+		uint32_t a = remap[m->indices[i + 0]], b = remap[m->indices[i + 1]], c = remap[m->indices[i + 2]];
+		if(a == b || b == c || c == a) continue;
+		m->indices[index_count++] = a;
+		m->indices[index_count++] = b;
+		m->indices[index_count++] = c;
+	}
+
+	m->vertex_count = welded_count;
+	m->index_count = index_count;
+	sb_release_scratch(&scratch);
+}
+
+// tipsify (sander, nehab and barczak 2007): fans around the vertex that'll still be cached after its remaining triangles
+static uint32_t *order_for_vertex_cache(sb_arena *arena, const mesh *m, uint32_t cache_size)
+{
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	uint32_t triangle_count = m->index_count / 3;
+
+	uint32_t *live = sb_arena_push(scratch.arena, uint32_t, m->vertex_count);
+	uint32_t *adjacency_offsets = sb_arena_push(scratch.arena, uint32_t, m->vertex_count + 1);
+	uint32_t *adjacency = sb_arena_push(scratch.arena, uint32_t, m->index_count);
+	memset(live, 0, m->vertex_count * sizeof(uint32_t));
+	for(uint32_t i = 0; i < m->index_count; i++) live[m->indices[i]]++;
+
+	adjacency_offsets[0] = 0;
+	for(uint32_t v = 0; v < m->vertex_count; v++) adjacency_offsets[v + 1] = adjacency_offsets[v] + live[v];
+	uint32_t *adjacency_fill = sb_arena_push(scratch.arena, uint32_t, m->vertex_count);
+	memcpy(adjacency_fill, adjacency_offsets, m->vertex_count * sizeof(uint32_t));
+	for(uint32_t i = 0; i < m->index_count; i++) adjacency[adjacency_fill[m->indices[i]]++] = i / 3;
+
+	bool *emitted = sb_arena_push(scratch.arena, bool, triangle_count);
+	memset(emitted, 0, triangle_count * sizeof(bool));
+	uint32_t *dead_ends = sb_arena_push(scratch.arena, uint32_t, m->index_count);
+	uint32_t *candidates = sb_arena_push(scratch.arena, uint32_t, m->index_count);
+	uint32_t *ordered = sb_arena_push(arena, uint32_t, m->index_count);
+	fifo_cache cache = alloc_cache(scratch.arena, m->vertex_count, cache_size);
+
+	uint32_t ordered_count = 0, dead_end_count = 0;
+	uint32_t next_unvisited = 0;
+	while(next_unvisited < m->vertex_count && live[next_unvisited] == 0) next_unvisited++;
+	uint32_t fanning = next_unvisited < m->vertex_count ? next_unvisited : NO_VERTEX;
+
+	while(fanning != NO_VERTEX)
+	{
+		uint32_t candidate_count = 0;
+		for(uint32_t a = adjacency_offsets[fanning]; a < adjacency_offsets[fanning + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if(emitted[triangle]) continue;
+			emitted[triangle] = true;
+
+			const uint32_t *corners = &m->indices[triangle * 3];
+			memcpy(&ordered[ordered_count], corners, 3 * sizeof(uint32_t));
+			ordered_count += 3;
+			for(uint32_t corner = 0; corner < 3; corner++)
+			{
+				dead_ends[dead_end_count++] = corners[corner];
+				candidates[candidate_count++] = corners[corner];
+				live[corners[corner]]--;
+			}
+			cache_triangle(&cache, corners);
+		}
+
+		// prefer the candidate that's been cached longest while all its remaining triangles still fit behind it
+		fanning = NO_VERTEX;
+		int64_t best_priority = -1;
+		for(uint32_t i = 0; i < candidate_count; i++)
+		{
+			uint32_t vertex = candidates[i];
+			if(live[vertex] == 0) continue;
+
+			int64_t priority = 0;
+			uint32_t age = cache.time - cache.entered[vertex];
+			if(age + 2 * live[vertex] <= cache_size) priority = age;
+			if(priority > best_priority)
+			{
+				best_priority = priority;
+				fanning = vertex;
+			}
+		}
+		if(fanning != NO_VERTEX) continue;
+
+		while(dead_end_count > 0 && fanning == NO_VERTEX)
+		{
+			uint32_t vertex = dead_ends[--dead_end_count];
+			if(live[vertex] > 0) fanning = vertex;
+		}
+		while(next_unvisited < m->vertex_count && fanning == NO_VERTEX)
+		{
+			if(live[next_unvisited] > 0) fanning = next_unvisited;
+			next_unvisited++;
+		}
+	}
+	assert(ordered_count == m->index_count);
+
+	sb_release_scratch(&scratch);
+	return ordered;
+}
+
+static int compare_clusters(const void *lhs, const void *rhs)
+{
+	const cluster *a = lhs, *b = rhs;
+	if(a->key != b->key) return a->key > b->key ? -1 : 1;
+	return a->first_triangle < b->first_triangle ? -1 : 1;
+}
+
+static sb_vec3 get_position(const mesh *m, uint32_t vertex)
+{
+	sb_vec3 extent = sb_vec3_sub(m->bounds_max, m->bounds_min);
+	const uint16_t *position = m->vertices[vertex].position;
+	return (sb_vec3) {
+		m->bounds_min.x + position[0] / 65535.0f * extent.x,
+		m->bounds_min.y + position[1] / 65535.0f * extent.y,
+		m->bounds_min.z + position[2] / 65535.0f * extent.z,
+	};
+}
+
+// sander et al. 2007 again: the tipsify clusters are split further wherever a cluster started from a cold cache stays
+// within threshold of the acmr the whole cluster had, then clusters facing away from the mesh center draw first,
+// since on a mostly convex mesh they're the ones that occlude the rest
+static void order_for_overdraw(sb_arena *arena, mesh *m, uint32_t cache_size, float threshold)
+{
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	uint32_t triangle_count = m->index_count / 3;
+	cluster *clusters = sb_arena_push(scratch.arena, cluster, triangle_count);
+	uint32_t *hard_clusters = sb_arena_push(scratch.arena, uint32_t, triangle_count);
+	fifo_cache cache = alloc_cache(scratch.arena, m->vertex_count, cache_size);
+
+	// a triangle missing on all three vertices starts a patch disjoint from what's cached, moving those around is free
+	uint32_t hard_cluster_count = 0;
+	for(uint32_t t = 0; t < triangle_count; t++)
+		if(cache_triangle(&cache, &m->indices[t * 3]) == 3 || t == 0) hard_clusters[hard_cluster_count++] = t;
+
+	uint32_t cluster_count = 0;
+	for(uint32_t h = 0; h < hard_cluster_count; h++)
+	{
+		uint32_t start = hard_clusters[h];
+		uint32_t end = h + 1 < hard_cluster_count ? hard_clusters[h + 1] : triangle_count;
+
+		flush_cache(&cache);
+		uint32_t cluster_misses = 0;
+		for(uint32_t t = start; t < end; t++) cluster_misses += cache_triangle(&cache, &m->indices[t * 3]);
+		float target_acmr = threshold * (float) cluster_misses / (float) (end - start);
+
+		flush_cache(&cache);
+		clusters[cluster_count++] = (cluster) {0.0f, start, 0};
+		uint32_t running_misses = 0, running_triangles = 0;
+		for(uint32_t t = start; t < end; t++)
+		{
+			running_misses += cache_triangle(&cache, &m->indices[t * 3]);
+			running_triangles++;
+			if(t + 1 < end && (float) running_misses <= target_acmr * (float) running_triangles)
+			{
+				clusters[cluster_count - 1].triangle_count = running_triangles;
+				clusters[cluster_count++] = (cluster) {0.0f, t + 1, 0};
+				flush_cache(&cache);
+				running_misses = running_triangles = 0;
+			}
+		}
+		// the tail never reached the target on its own, it stays behind the cluster that warmed the cache for it
+		uint32_t first_cluster = cluster_count - 1;
+		while(clusters[first_cluster].first_triangle != start) first_cluster--;
+		if(cluster_count - 1 > first_cluster && (float) running_misses > target_acmr * (float) running_triangles)
+		{
+			cluster_count--;
+			clusters[cluster_count - 1].triangle_count += running_triangles;
+		}
+		else clusters[cluster_count - 1].triangle_count = running_triangles;
+	}
+
+	// area weighted centers and normals, a triangle's cross product is both its normal and twice its area
+	sb_vec3 *centers = sb_arena_push(scratch.arena, sb_vec3, cluster_count);
+	sb_vec3 *normals = sb_arena_push(scratch.arena, sb_vec3, cluster_count);
+	sb_vec3 mesh_center = {0};
+	float mesh_area = 0.0f;
+	for(uint32_t c = 0; c < cluster_count; c++)
+	{
+		sb_vec3 center = {0}, normal = {0};
+		float area = 0.0f;
+		for(uint32_t t = clusters[c].first_triangle; t < clusters[c].first_triangle + clusters[c].triangle_count; t++)
+		{
+			sb_vec3 p0 = get_position(m, m->indices[t * 3 + 0]);
+			sb_vec3 p1 = get_position(m, m->indices[t * 3 + 1]);
+			sb_vec3 p2 = get_position(m, m->indices[t * 3 + 2]);
+			sb_vec3 cross = sb_vec3_cross(sb_vec3_sub(p1, p0), sb_vec3_sub(p2, p0));
+			float triangle_area = sb_vec3_magnitude(cross);
+
+			sb_vec3 triangle_center = sb_vec3_mul_f32(sb_vec3_add(sb_vec3_add(p0, p1), p2), 1.0f / 3.0f);
+			center = sb_vec3_add(center, sb_vec3_mul_f32(triangle_center, triangle_area));
+			normal = sb_vec3_add(normal, cross);
+			area += triangle_area;
+		}
+
+		mesh_center = sb_vec3_add(mesh_center, center);
+		mesh_area += area;
+		centers[c] = area > 0.0f ? sb_vec3_mul_f32(center, 1.0f / area) : center;
+		normals[c] = normal;
+	}
+	if(mesh_area > 0.0f) mesh_center = sb_vec3_mul_f32(mesh_center, 1.0f / mesh_area);
+
+	for(uint32_t c = 0; c < cluster_count; c++)
+	{
+		float normal_length = sb_vec3_magnitude(normals[c]);
+		sb_vec3 offset = sb_vec3_sub(centers[c], mesh_center);
+		clusters[c].key = normal_length > 0.0f ? sb_vec3_dot(offset, normals[c]) / normal_length : 0.0f;
+	}
+	qsort(clusters, cluster_count, sizeof(cluster), compare_clusters);
+
+	uint32_t *ordered = sb_arena_push(arena, uint32_t, m->index_count);
+	uint32_t ordered_count = 0;
+	for(uint32_t c = 0; c < cluster_count; c++)
+	{
+		memcpy(&ordered[ordered_count], &m->indices[clusters[c].first_triangle * 3], clusters[c].triangle_count * 3 * sizeof(uint32_t));
+		ordered_count += clusters[c].triangle_count * 3;
+	}
+	assert(ordered_count == m->index_count);
+
+	m->indices = ordered;
+	sb_release_scratch(&scratch);
+}
+
+// vertices in the order the index buffer first reaches them, unreferenced ones are dropped
+static void order_for_vertex_fetch(sb_arena *arena, mesh *m)
+{
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	uint32_t *remap = sb_arena_push(scratch.arena, uint32_t, m->vertex_count);
+	memset(remap, 0xff, m->vertex_count * sizeof(uint32_t));
+
+	sb_packed_vertex *vertices = sb_arena_push(arena, sb_packed_vertex, m->vertex_count);
+	uint32_t vertex_count = 0;
+	for(uint32_t i = 0; i < m->index_count; i++)
+	{
+		uint32_t vertex = m->indices[i];
+		if(remap[vertex] == NO_VERTEX)
+		{
+			remap[vertex] = vertex_count;
+			vertices[vertex_count++] = m->vertices[vertex];
+		}
+		m->indices[i] = remap[vertex];
+	}
+
+	m->vertices = vertices;
+	m->vertex_count = vertex_count;
+	sb_release_scratch(&scratch);
+}
+
+// acmr of m's triangles in their current order
+static float get_acmr(const mesh *m, const uint32_t *indices, uint32_t cache_size)
+{
+	float acmr, unused_atvr;
+	get_cache_stats(indices, m->index_count, m->vertex_count, cache_size, &acmr, &unused_atvr);
+	return acmr;
+}
+
+// small exported meshes often come out of the modeler in strips tipsify can't beat, those keep their order. the
+// overdraw regroup is only kept while it stays within threshold of that order and never costs more than the order the
+// mesh came in with, so a mesh that's already been through here comes out no worse. the fetch reorder after this only
+// renames vertices, which leaves acmr where it is
+static void order_for_draw(sb_arena *arena, mesh *m, uint32_t cache_size, float threshold)
+{
+	float source_acmr = get_acmr(m, m->indices, cache_size);
+	uint32_t *tipsified = order_for_vertex_cache(arena, m, cache_size);
+	float tipsified_acmr = get_acmr(m, tipsified, cache_size);
+	if(tipsified_acmr < source_acmr) m->indices = tipsified;
+	float cache_acmr = SB_MIN(source_acmr, tipsified_acmr);
+
+	uint32_t *cache_ordered = m->indices;
+	order_for_overdraw(arena, m, cache_size, threshold);
+	float overdraw_acmr = get_acmr(m, m->indices, cache_size);
+	if(overdraw_acmr > threshold * cache_acmr || overdraw_acmr > source_acmr) m->indices = cache_ordered;
+}
+
+static void add_plane_quadric(quadric *out, sb_vec3 p0, sb_vec3 p1, sb_vec3 p2)
+{
+	sb_vec3 cross = sb_vec3_cross(sb_vec3_sub(p1, p0), sb_vec3_sub(p2, p0));
+	double area = sb_vec3_magnitude(cross);
+	if(area <= 0.0) return;
+
+	double plane[4] = {cross.x / area, cross.y / area, cross.z / area, 0.0};
+	plane[3] = -(plane[0] * p0.x + plane[1] * p0.y + plane[2] * p0.z);
+	for(uint32_t i = 0, k = 0; i < 4; i++)
+		for(uint32_t j = i; j < 4; j++) out->q[k++] += area * plane[i] * plane[j];
+	out->weight += area;
+}
+
+// the area weighted mean squared distance from position to the planes in a and b
+static double get_quadric_error(const quadric *a, const quadric *b, sb_vec3 position)
+{
+	double v[4] = {position.x, position.y, position.z, 1.0};
+	double error = 0.0;
+	for(uint32_t i = 0, k = 0; i < 4; i++)
+		for(uint32_t j = i; j < 4; j++, k++) error += (i == j ? 1.0 : 2.0) * (a->q[k] + b->q[k]) * v[i] * v[j];
+
+	double weight = a->weight + b->weight;
+	return weight > 0.0 ? SB_MAX(error, 0.0) / weight : 0.0;
+}
+
+static simplifier make_simplifier(sb_arena *arena, const mesh *m)
+{
+	simplifier s = {0};
+	s.vertex_count = m->vertex_count;
+	s.positions = sb_arena_push(arena, sb_vec3, m->vertex_count);
+	s.quadrics = sb_arena_push(arena, quadric, m->vertex_count);
+	s.locked = sb_arena_push(arena, bool, m->vertex_count);
+	memset(s.quadrics, 0, m->vertex_count * sizeof(quadric));
+	memset(s.locked, 0, m->vertex_count * sizeof(bool));
+	for(uint32_t v = 0; v < m->vertex_count; v++) s.positions[v] = get_position(m, v);
+
+	for(uint32_t i = 0; i + 2 < m->index_count; i += 3)
+	{
+		quadric plane = {0};
+		add_plane_quadric(&plane, s.positions[m->indices[i + 0]], s.positions[m->indices[i + 1]], s.positions[m->indices[i + 2]]);
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			quadric *q = &s.quadrics[m->indices[i + corner]];
+			for(uint32_t k = 0; k < 10; k++) q->q[k] += plane.q[k];
+			q->weight += plane.weight;
+		}
+	}
+
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	uint32_t table_capacity = 1;
+	while(table_capacity < m->vertex_count * 2) table_capacity <<= 1;
+	uint32_t *table = sb_arena_push(scratch.arena, uint32_t, table_capacity);
+	memset(table, 0xff, table_capacity * sizeof(uint32_t));
+	for(uint32_t v = 0; v < m->vertex_count; v++)
+	{
+		const uint16_t *position = m->vertices[v].position;
+		uint32_t slot = (uint32_t) sb_hash_bytes(position, 3 * sizeof(uint16_t)) & (table_capacity - 1);
+		while(table[slot] != NO_VERTEX && memcmp(m->vertices[table[slot]].position, position, 3 * sizeof(uint16_t)) != 0)
+			slot = (slot + 1) & (table_capacity - 1);
+
+		if(table[slot] == NO_VERTEX) table[slot] = v;
+		else s.locked[v] = s.locked[table[slot]] = true;
+	}
+	sb_release_scratch(&scratch);
+	return s;
+}
+
+static vertex_triangles get_vertex_triangles(sb_arena *arena, const uint32_t *indices, uint32_t index_count, uint32_t vertex_count)
+{
+	vertex_triangles adjacency = {0};
+	adjacency.offsets = sb_arena_push(arena, uint32_t, vertex_count + 1);
+	adjacency.triangles = sb_arena_push(arena, uint32_t, index_count);
+	memset(adjacency.offsets, 0, (vertex_count + 1) * sizeof(uint32_t));
+	for(uint32_t i = 0; i < index_count; i++) adjacency.offsets[indices[i] + 1]++;
+	for(uint32_t v = 0; v < vertex_count; v++) adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+	uint32_t *fill = sb_arena_push(arena, uint32_t, vertex_count);
+	memcpy(fill, adjacency.offsets, vertex_count * sizeof(uint32_t));
+	for(uint32_t i = 0; i < index_count; i++) adjacency.triangles[fill[indices[i]]++] = i / 3;
+	return adjacency;
+}
+
+// the other corners of every triangle around vertex, and how many of those triangles share each edge to them.
+// false when there are more than MAX_VALENCE
+static bool get_vertex_ring(const vertex_triangles *adjacency, const uint32_t *indices, uint32_t vertex,
+	uint32_t *out_neighbours, uint32_t *out_edge_counts, uint32_t *out_count)
+{
+	uint32_t count = 0;
+	for(uint32_t a = adjacency->offsets[vertex]; a < adjacency->offsets[vertex + 1]; a++)
+	{
+		const uint32_t *corners = &indices[adjacency->triangles[a] * 3];
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t other = corners[corner];
+			if(other == vertex) continue;
+
+			uint32_t n = 0;
+			while(n < count && out_neighbours[n] != other) n++;
+			if(n == count)
+			{
+				if(count == MAX_VALENCE) return false;
+				out_neighbours[count] = other;
+				out_edge_counts[count++] = 0;
+			}
+			out_edge_counts[n]++;
+		}
+	}
+	*out_count = count;
+	return true;
+}
+
+// vertex and target may only share the two corners opposite their edge, anything more pinches the surface, and no
+// triangle left around vertex may turn over or get close to it
+static bool can_collapse(const simplifier *s, const vertex_triangles *adjacency, const uint32_t *indices,
+	uint32_t vertex, const uint32_t *ring, uint32_t ring_count, uint32_t target)
+{
+	uint32_t target_ring[MAX_VALENCE], target_edge_counts[MAX_VALENCE], target_ring_count;
+	if(!get_vertex_ring(adjacency, indices, target, target_ring, target_edge_counts, &target_ring_count)) return false;
+
+	uint32_t shared_count = 0;
+	for(uint32_t i = 0; i < ring_count; i++)
+		for(uint32_t j = 0; j < target_ring_count; j++) shared_count += ring[i] == target_ring[j];
+	if(shared_count != 2) return false;
+
+	for(uint32_t a = adjacency->offsets[vertex]; a < adjacency->offsets[vertex + 1]; a++)
+	{
+		const uint32_t *corners = &indices[adjacency->triangles[a] * 3];
+		if(corners[0] == target || corners[1] == target || corners[2] == target) continue;
+
+		sb_vec3 before[3], after[3];
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			before[corner] = s->positions[corners[corner]];
+			after[corner] = corners[corner] == vertex ? s->positions[target] : before[corner];
+		}
+		sb_vec3 before_normal = sb_vec3_cross(sb_vec3_sub(before[1], before[0]), sb_vec3_sub(before[2], before[0]));
+		sb_vec3 after_normal = sb_vec3_cross(sb_vec3_sub(after[1], after[0]), sb_vec3_sub(after[2], after[0]));
+		if(sb_vec3_dot(before_normal, after_normal) <= 0.25f * sb_vec3_magnitude(before_normal) * sb_vec3_magnitude(after_normal))
+			return false;
+	}
+	return true;
+}
+
+static int compare_collapses(const void *lhs, const void *rhs)
+{
+	const collapse *a = lhs, *b = rhs;
+	if(a->cost != b->cost) return a->cost < b->cost ? -1 : 1;
+	return a->vertex < b->vertex ? -1 : 1;
+}
+
+// half edge collapses in passes: every collapsible vertex finds its cheapest neighbour to move onto, then the cheapest
+// collapses whose rings don't overlap are made, until indices is down to target_index_count or the next one would
+// stray further than max_error. only vertices inside a closed patch of triangles move, so borders and seams stay
+// where they are. error is the largest distance any collapse has strayed so far, returns the new index count
+static uint32_t simplify(simplifier *s, uint32_t *indices, uint32_t index_count, uint32_t target_index_count, float max_error, float *error)
+{
+	double max_cost = (double) max_error * max_error;
+	while(index_count > target_index_count)
+	{
+		sb_arena_temp scratch = sb_get_scratch();
+		vertex_triangles adjacency = get_vertex_triangles(scratch.arena, indices, index_count, s->vertex_count);
+
+		collapse *collapses = sb_arena_push(scratch.arena, collapse, s->vertex_count);
+		uint32_t collapse_count = 0;
+		for(uint32_t v = 0; v < s->vertex_count; v++)
+		{
+			uint32_t ring[MAX_VALENCE], edge_counts[MAX_VALENCE], ring_count;
+			if(s->locked[v] || adjacency.offsets[v] == adjacency.offsets[v + 1]) continue;
+			if(!get_vertex_ring(&adjacency, indices, v, ring, edge_counts, &ring_count)) continue;
+
+			bool is_interior = true;
+			for(uint32_t n = 0; n < ring_count; n++) is_interior &= edge_counts[n] == 2;
+			if(!is_interior) continue;
+
+			collapse best = {DBL_MAX, v, NO_VERTEX};
+			for(uint32_t n = 0; n < ring_count; n++)
+			{
+				double cost = get_quadric_error(&s->quadrics[v], &s->quadrics[ring[n]], s->positions[ring[n]]);
+				if(cost < best.cost && cost <= max_cost && can_collapse(s, &adjacency, indices, v, ring, ring_count, ring[n]))
+					best = (collapse) {cost, v, ring[n]};
+			}
+			if(best.target != NO_VERTEX) collapses[collapse_count++] = best;
+		}
+		qsort(collapses, collapse_count, sizeof(collapse), compare_collapses);
+
+		uint32_t *remap = sb_arena_push(scratch.arena, uint32_t, s->vertex_count);
+		bool *touched = sb_arena_push(scratch.arena, bool, s->vertex_count);
+		memset(touched, 0, s->vertex_count * sizeof(bool));
+		for(uint32_t v = 0; v < s->vertex_count; v++) remap[v] = v;
+
+		// every collapse takes the two triangles on its edge with it
+		uint32_t remaining_count = index_count;
+		for(uint32_t c = 0; c < collapse_count && remaining_count > target_index_count; c++)
+		{
+			uint32_t vertex = collapses[c].vertex, target = collapses[c].target;
+			if(touched[vertex] || touched[target]) continue;
+
+			uint32_t ring[MAX_VALENCE], edge_counts[MAX_VALENCE], ring_count;
+			get_vertex_ring(&adjacency, indices, vertex, ring, edge_counts, &ring_count);
+			for(uint32_t n = 0; n < ring_count; n++) touched[ring[n]] = true;
+			touched[vertex] = true;
+
+			remap[vertex] = target;
+			for(uint32_t k = 0; k < 10; k++) s->quadrics[target].q[k] += s->quadrics[vertex].q[k];
+			s->quadrics[target].weight += s->quadrics[vertex].weight;
+			*error = SB_MAX(*error, (float) sqrt(collapses[c].cost));
+			remaining_count -= 6;
+		}
+		sb_release_scratch(&scratch);
+		if(remaining_count == index_count) break;
+
+		uint32_t kept_count = 0;
+		for(uint32_t i = 0; i + 2 < index_count; i += 3)
+		{
+			uint32_t a = remap[indices[i + 0]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+			if(a == b || b == c || c == a) continue;
+			indices[kept_count++] = a;
+			indices[kept_count++] = b;
+			indices[kept_count++] = c;
+		}
+		index_count = kept_count;
+	}
+	return index_count;
+}
+
+// greedy runs of the final triangle order, which tipsify already keeps spatially close, so clustering costs nothing in
+// cache or overdraw. a mesh that fits in one cluster gets none, culling it whole is the same test. returns the count
+static uint32_t build_clusters(sb_arena *arena, const mesh *m, uint32_t index_count, sb_mesh_cluster **out_clusters)
+{
+	*out_clusters = NULL;
+	if(m->vertex_count > SB_MESH_PART_MAX_VERTICES) return 0;
+
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	uint32_t *seen = sb_arena_push(scratch.arena, uint32_t, m->vertex_count);
+	memset(seen, 0xff, m->vertex_count * sizeof(uint32_t));
+
+	uint32_t triangle_count = index_count / 3;
+	sb_mesh_cluster *clusters = sb_arena_push(arena, sb_mesh_cluster, triangle_count);
+	uint32_t cluster_count = 0;
+	for(uint32_t t = 0; t < triangle_count;)
+	{
+		// vertices seen in this cluster are tagged with its index, so nothing needs clearing between clusters
+		uint32_t first_triangle = t, vertex_count = 0;
+		for(; t < triangle_count && t - first_triangle < SB_MESH_CLUSTER_MAX_TRIANGLES; t++)
+		{
+			const uint32_t *corners = &m->indices[t * 3];
+			uint32_t new_count = 0;
+			for(uint32_t corner = 0; corner < 3; corner++) new_count += seen[corners[corner]] != cluster_count;
+			if(vertex_count + new_count > SB_MESH_CLUSTER_MAX_VERTICES) break;
+
+			for(uint32_t corner = 0; corner < 3; corner++) seen[corners[corner]] = cluster_count;
+			vertex_count += new_count;
+		}
+
+		sb_vec3 bounds_min = get_position(m, m->indices[first_triangle * 3]), bounds_max = bounds_min;
+		sb_vec3 normal_sum = {0};
+		for(uint32_t i = first_triangle * 3; i < t * 3; i += 3)
+		{
+			sb_vec3 p[3];
+			for(uint32_t corner = 0; corner < 3; corner++)
+			{
+				p[corner] = get_position(m, m->indices[i + corner]);
+				bounds_min = (sb_vec3) {SB_MIN(bounds_min.x, p[corner].x), SB_MIN(bounds_min.y, p[corner].y), SB_MIN(bounds_min.z, p[corner].z)};
+				bounds_max = (sb_vec3) {SB_MAX(bounds_max.x, p[corner].x), SB_MAX(bounds_max.y, p[corner].y), SB_MAX(bounds_max.z, p[corner].z)};
+			}
+			sb_vec3 normal = sb_vec3_cross(sb_vec3_sub(p[1], p[0]), sb_vec3_sub(p[2], p[0]));
+			float area = sb_vec3_magnitude(normal);
+			if(area > 0.0f) normal_sum = sb_vec3_add(normal_sum, sb_vec3_mul_f32(normal, 1.0f / area));
+		}
+
+		sb_mesh_cluster *cluster = &clusters[cluster_count++];
+		cluster->center = sb_vec3_mul_f32(sb_vec3_add(bounds_min, bounds_max), 0.5f);
+		cluster->first_index = first_triangle * 3;
+		cluster->index_count = (t - first_triangle) * 3;
+
+		// the cone holds every normal, its cutoff is how far from the axis the widest one leans
+		float axis_length = sb_vec3_magnitude(normal_sum);
+		cluster->cone_axis = axis_length > 0.0f ? sb_vec3_mul_f32(normal_sum, 1.0f / axis_length) : (sb_vec3) {0.0f, 1.0f, 0.0f};
+		float min_dot = axis_length > 0.0f ? 1.0f : -1.0f;
+		for(uint32_t i = first_triangle * 3; i < t * 3; i += 3)
+		{
+			sb_vec3 p[3];
+			for(uint32_t corner = 0; corner < 3; corner++)
+			{
+				p[corner] = get_position(m, m->indices[i + corner]);
+				cluster->radius = SB_MAX(cluster->radius, sb_vec3_magnitude(sb_vec3_sub(p[corner], cluster->center)));
+			}
+			sb_vec3 normal = sb_vec3_cross(sb_vec3_sub(p[1], p[0]), sb_vec3_sub(p[2], p[0]));
+			float area = sb_vec3_magnitude(normal);
+			if(area > 0.0f) min_dot = SB_MIN(min_dot, sb_vec3_dot(normal, cluster->cone_axis) / area);
+		}
+		cluster->cone_cutoff = min_dot <= 0.0f ? 1.0f : sqrtf(1.0f - min_dot * min_dot);
+	}
+
+	sb_release_scratch(&scratch);
+	if(cluster_count < 2) return 0;
+
+	*out_clusters = clusters;
+	return cluster_count;
+}
+
+// lod 0 is the mesh itself, each lod after it is simplified from the one before to about half its triangles. stops
+// early once a lod doesn't come out meaningfully smaller. meshes past SB_MESH_PART_MAX_VERTICES only ever have lod 0,
+// their parts get split from it at load
+static uint32_t *build_lods(sb_arena *arena, const mesh *m, uint32_t max_lod_count, uint32_t *out_index_counts, float *out_errors, uint32_t *out_lod_count)
+{
+	uint32_t *lod_indices = sb_arena_push(arena, uint32_t, m->index_count * max_lod_count);
+	memcpy(lod_indices, m->indices, m->index_count * sizeof(uint32_t));
+	out_index_counts[0] = m->index_count;
+	out_errors[0] = 0.0f;
+	*out_lod_count = 1;
+	if(max_lod_count < 2 || m->vertex_count > SB_MESH_PART_MAX_VERTICES) return lod_indices;
+
+	sb_arena_temp scratch = sb_get_scratch_with_conflicts(&arena, 1);
+	simplifier s = make_simplifier(scratch.arena, m);
+	float max_error = LOD_MAX_ERROR * sb_vec3_magnitude(sb_vec3_sub(m->bounds_max, m->bounds_min));
+	float error = 0.0f;
+
+	uint32_t first_index = 0;
+	while(*out_lod_count < max_lod_count)
+	{
+		uint32_t previous_count = out_index_counts[*out_lod_count - 1];
+		uint32_t *indices = &lod_indices[first_index + previous_count];
+		memcpy(indices, &lod_indices[first_index], previous_count * sizeof(uint32_t));
+
+		uint32_t index_count = simplify(&s, indices, previous_count, previous_count / 6 * 3, max_error, &error);
+		if(index_count == 0 || index_count * 5 > previous_count * 4) break;
+
+		first_index += previous_count;
+		out_index_counts[*out_lod_count] = index_count;
+		out_errors[*out_lod_count] = error;
+		(*out_lod_count)++;
+	}
+
+	sb_release_scratch(&scratch);
+	return lod_indices;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "usage: sbmopt <input.sbm|input.obj> <output.sbm> [--cache <size>] [--overdraw <threshold>] [--lods <count>]\n");
+		return 1;
+	}
+
+	uint32_t cache_size = 16;
+	float threshold = 1.05f;
+	uint32_t max_lod_count = SB_MAX_MESH_LODS;
+	for(int i = 3; i + 1 < argc; i += 2)
+	{
+		if(strcmp(argv[i], "--cache") == 0) cache_size = (uint32_t) SB_MAX(atoi(argv[i + 1]), 3);
+		else if(strcmp(argv[i], "--overdraw") == 0) threshold = (float) SB_MAX(atof(argv[i + 1]), 1.0);
+		else if(strcmp(argv[i], "--lods") == 0) max_lod_count = (uint32_t) SB_MIN(SB_MAX(atoi(argv[i + 1]), 1), (int) SB_MAX_MESH_LODS);
+	}
+
+	sb_arena *arena = sb_arena_alloc();
+	mesh m = load_mesh(arena, argv[1]);
+	uint32_t source_vertex_count = m.vertex_count;
+	uint32_t source_triangle_count = m.index_count / 3;
+
+	float source_acmr, source_atvr;
+	get_cache_stats(m.indices, m.index_count, m.vertex_count, cache_size, &source_acmr, &source_atvr);
+
+	weld_vertices(&m);
+
+	uint32_t lod_index_counts[SB_MAX_MESH_LODS];
+	float lod_errors[SB_MAX_MESH_LODS];
+	uint32_t lod_count = 0;
+	uint32_t *lod_indices = build_lods(arena, &m, max_lod_count, lod_index_counts, lod_errors, &lod_count);
+
+	uint32_t first_index = 0;
+	for(uint32_t lod = 0; lod < lod_count; lod++)
+	{
+		mesh lod_mesh = m;
+		lod_mesh.indices = &lod_indices[first_index];
+		lod_mesh.index_count = lod_index_counts[lod];
+		order_for_draw(arena, &lod_mesh, cache_size, threshold);
+		memcpy(&lod_indices[first_index], lod_mesh.indices, lod_mesh.index_count * sizeof(uint32_t));
+		first_index += lod_mesh.index_count;
+	}
+
+	// lod 0 reaches every vertex the others do, so the fetch order is lod 0's
+	m.indices = lod_indices;
+	m.index_count = first_index;
+	order_for_vertex_fetch(arena, &m);
+
+	float acmr, atvr;
+	get_cache_stats(m.indices, lod_index_counts[0], m.vertex_count, cache_size, &acmr, &atvr);
+
+	sb_mesh_cluster *clusters;
+	uint32_t cluster_count = build_clusters(arena, &m, lod_index_counts[0], &clusters);
+
+	sb_write_mesh_file_lods(argv[2], m.vertices, m.vertex_count, m.indices, lod_index_counts, lod_errors, lod_count,
+		clusters, cluster_count, m.bounds_min, m.bounds_max);
+
+	char lod_triangles[64] = {0};
+	for(uint32_t lod = 1, length = 0; lod < lod_count; lod++)
+		length += snprintf(lod_triangles + length, sizeof(lod_triangles) - length, "%s%u", lod == 1 ? ", lods " : "/", lod_index_counts[lod] / 3);
+
+	printf("%s: %u -> %u triangles%s, %u -> %u vertices, %u clusters, acmr %.3f -> %.3f, atvr %.3f -> %.3f (fifo of %u)\n",
+		argv[2], source_triangle_count, lod_index_counts[0] / 3, lod_triangles, source_vertex_count, m.vertex_count,
+		cluster_count, source_acmr, acmr, source_atvr, atvr, cache_size);
+	if(acmr > source_acmr) fprintf(stderr, "%s: acmr went up from %.3f to %.3f\n", argv[2], source_acmr, acmr);
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+// builds an .sbpak from a manifest of asset paths, one per line, '#' starts a comment
+// the manifest order is the payload order, list assets in the order the game loads them
+// usage: sbpak <manifest> <output.sbpak> [--compress]
+
+#include "sb_pack.h"
+#include "sb_compression.h"
+#include "sb_mesh_file.h"
+#include "sb_texture_file.h"
+#include "sb_common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SB_PACK_MAX_ENTRIES 4096
+
+typedef struct
+{
+	sb_pack_entry entry;
+	const void *payload;
+} pack_item;
+
+static bool ends_with(sb_str8 str, const char *suffix)
+{
+	size_t suffix_size = strlen(suffix);
+	return str.size >= suffix_size && memcmp(str.str + str.size - suffix_size, suffix, suffix_size) == 0;
+}
+
+static sb_asset_type get_asset_type(sb_str8 path)
+{
+	if(ends_with(path, ".sbm")) return SB_ASSET_TYPE_MESH;
+	if(ends_with(path, ".png") || ends_with(path, ".jpg") || ends_with(path, ".jpeg") || ends_with(path, ".sbt")) return SB_ASSET_TYPE_TEXTURE;
+	if(ends_with(path, ".spv")) return SB_ASSET_TYPE_SHADER;
+	if(ends_with(path, ".txt")) return SB_ASSET_TYPE_LEVEL;
+	return SB_ASSET_TYPE_UNKNOWN;
+}
+
+static int compare_items(const void *lhs, const void *rhs)
+{
+	uint64_t a = ((const pack_item*)lhs)->entry.path_hash;
+	uint64_t b = ((const pack_item*)rhs)->entry.path_hash;
+	return (a > b) - (a < b);
+}
+
+static void write_padding(FILE *file, uint64_t *cursor, uint64_t alignment)
+{
+	static const uint8_t zeros[SB_PACK_ALIGNMENT] = {0};
+	uint64_t aligned = sb_round_up(*cursor, alignment);
+	fwrite(zeros, 1, aligned - *cursor, file);
+	*cursor = aligned;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "usage: sbpak <manifest> <output.sbpak> [--compress]\n");
+		return 1;
+	}
+
+	bool compress = argc > 3 && strcmp(argv[3], "--compress") == 0;
+
+	sb_arena *arena = sb_arena_alloc();
+	sb_str8 manifest = sb_read_file_string(arena, argv[1]);
+
+	pack_item *items = sb_arena_push(arena, pack_item, SB_PACK_MAX_ENTRIES);
+	uint32_t item_count = 0;
+
+	char *names = sb_arena_push(arena, char, manifest.size);
+	uint32_t names_size = 0;
+
+	uint64_t raw_total = 0;
+	uint64_t stored_total = 0;
+
+	for(size_t line_start = 0; line_start < manifest.size;)
+	{
+		size_t line_end = line_start;
+		while(line_end < manifest.size && manifest.str[line_end] != '\n') line_end++;
+
+		sb_str8 path = {manifest.str + line_start, line_end - line_start};
+		line_start = line_end + 1;
+
+		while(path.size > 0 && (path.str[path.size - 1] == '\r' || path.str[path.size - 1] == ' ')) path.size--;
+		if(path.size == 0 || path.str[0] == '#') continue;
+
+		if(item_count == SB_PACK_MAX_ENTRIES) SB_PANIC("too many manifest entries");
+		pack_item *item = &items[item_count++];
+
+		// the mapping stays alive until the pack is written
+		char *c_path = sb_arena_push(arena, char, path.size + 1);
+		memcpy(c_path, path.str, path.size);
+		sb_mapped_file file = sb_map_file(c_path, SB_FILE_ACCESS_SEQUENTIAL);
+		const void *payload = file.data;
+		uint64_t payload_size = file.size;
+
+		sb_pack_entry *entry = &item->entry;
+		entry->path_hash = sb_str8_hash(path);
+		entry->name_offset = names_size;
+		entry->name_size = (uint32_t) path.size;
+		entry->asset_type = get_asset_type(path);
+
+		// v1 meshes are packed here, the gpu decompression path copies vertices straight out of the payload
+		if(entry->asset_type == SB_ASSET_TYPE_MESH)
+		{
+			if(!sb_is_valid_mesh_file(payload, payload_size)) SB_PANIC("mesh in the manifest is truncated or corrupt");
+			payload = sb_upgrade_mesh_file(arena, payload, &payload_size);
+			const sb_mesh_file_header *header = payload;
+			entry->metadata[0] = header->vertex_count;
+			entry->metadata[1] = header->index_count;
+			entry->metadata[2] = header->flags;
+			// only lod 0 is split, the transfer drops the others. meshes that don't need splitting have their cluster count
+			// in the same slot instead
+			if(header->vertex_count > SB_MESH_PART_MAX_VERTICES)
+				sb_split_mesh(sb_mesh_file_indices(header), header->lod_index_counts[0], header->vertex_count, NULL, NULL, NULL, &entry->metadata[3]);
+			else entry->metadata[3] = header->cluster_count;
+		}
+
+		entry->raw_size = payload_size;
+		entry->stored_size = payload_size;
+		item->payload = payload;
+
+		memcpy(names + names_size, path.str, path.size);
+		names_size += (uint32_t) path.size;
+
+		// cooked textures describe their image in the toc, so creating one doesn't touch the payload
+		if(ends_with(path, ".sbt"))
+		{
+			const sb_texture_file_header *header = file.data;
+			if(header->magic != SB_TEXTURE_FILE_MAGIC) SB_PANIC("not an sbt file");
+			entry->metadata[0] = header->width;
+			entry->metadata[1] = header->height;
+			entry->metadata[2] = header->format;
+			entry->metadata[3] = header->mip_count;
+		}
+
+		// only keep the compressed payload when it saves at least an eighth, jpeg and png barely shrink
+		if(compress)
+		{
+			size_t capacity = sb_compress_blocks_bound(payload_size);
+			void *compressed = sb_arena_push_aligned(arena, capacity, SB_PACK_ALIGNMENT);
+			size_t compressed_size = sb_compress_blocks(payload, payload_size, compressed, capacity);
+			if(compressed_size <= payload_size - payload_size / 8)
+			{
+				entry->flags |= SB_PACK_ENTRY_COMPRESSED_FLAG;
+				entry->stored_size = compressed_size;
+				item->payload = compressed;
+			}
+		}
+
+		raw_total += entry->raw_size;
+		stored_total += entry->stored_size;
+	}
+
+	// payload offsets follow manifest order, then the toc gets sorted by hash for lookup
+	sb_pack_header header = {0};
+	header.magic = SB_PACK_MAGIC;
+	header.version = SB_PACK_VERSION;
+	header.entry_count = item_count;
+	header.toc_offset = sizeof(sb_pack_header);
+	header.names_offset = header.toc_offset + item_count * sizeof(sb_pack_entry);
+	header.data_offset = sb_round_up(header.names_offset + names_size, SB_PACK_ALIGNMENT);
+
+	uint64_t data_cursor = header.data_offset;
+	for(uint32_t i = 0; i < item_count; i++)
+	{
+		items[i].entry.offset = data_cursor;
+		data_cursor = sb_round_up(data_cursor + items[i].entry.stored_size, SB_PACK_ALIGNMENT);
+	}
+	header.data_size = data_cursor - header.data_offset;
+
+	sb_pack_entry *toc = sb_arena_push(arena, sb_pack_entry, item_count);
+	pack_item *sorted = sb_arena_push(arena, pack_item, item_count);
+	memcpy(sorted, items, item_count * sizeof(pack_item));
+	qsort(sorted, item_count, sizeof(pack_item), compare_items);
+	for(uint32_t i = 0; i < item_count; i++)
+	{
+		toc[i] = sorted[i].entry;
+		if(i > 0 && toc[i].path_hash == toc[i - 1].path_hash
+			&& toc[i].name_size == toc[i - 1].name_size
+			&& memcmp(names + toc[i].name_offset, names + toc[i - 1].name_offset, toc[i].name_size) == 0)
+			SB_PANIC("duplicate path in manifest");
+	}
+
+	FILE *out = sb_fopen(argv[2], "wb");
+	uint64_t cursor = 0;
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(toc, sizeof(sb_pack_entry), item_count, out);
+	fwrite(names, 1, names_size, out);
+	cursor = header.names_offset + names_size;
+
+	for(uint32_t i = 0; i < item_count; i++)
+	{
+		write_padding(out, &cursor, SB_PACK_ALIGNMENT);
+		assert(cursor == items[i].entry.offset);
+
+		fwrite(items[i].payload, 1, items[i].entry.stored_size, out);
+		cursor += items[i].entry.stored_size;
+	}
+	write_padding(out, &cursor, SB_PACK_ALIGNMENT);
+	fclose(out);
+
+	printf("packed %u assets into %s: %llu bytes raw, %llu bytes stored\n",
+		item_count, argv[2], (unsigned long long) raw_total, (unsigned long long) stored_total);
+	return 0;
+}
@@ -0,0 +1,437 @@
+// cooks a png or jpeg into an .sbt, a block compressed mip chain the engine uploads without decoding
+// mips are box filtered in linear light, each block is fit along the principal axis of its colors
+// usage: sbtex <input image> <output.sbt> [--bc1|--bc3|--bc7], bc1 for opaque images and bc3 otherwise by default
+
+#include "sb_texture_file.h"
+#include "sb_image.h"
+#include "sb_common.h"
+#include "sb_math.h"
+#include "sb_file.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	uint32_t width;
+	uint32_t height;
+	uint8_t *pixels; // rgba8, srgb color and linear alpha
+} image;
+
+static float srgb_to_linear_table[256];
+
+static uint8_t linear_to_srgb(float value)
+{
+	value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t) sb_clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+static image downsample(sb_arena *arena, const image *src)
+{
+	image dst = {.width = SB_MAX(src->width / 2, 1), .height = SB_MAX(src->height / 2, 1)};
+	dst.pixels = sb_arena_push(arena, uint8_t, dst.width * dst.height * 4);
+
+	for(uint32_t y = 0; y < dst.height; y++)
+	{
+		uint32_t rows[2] = {SB_MIN(y * 2, src->height - 1), SB_MIN(y * 2 + 1, src->height - 1)};
+		for(uint32_t x = 0; x < dst.width; x++)
+		{
+			uint32_t columns[2] = {SB_MIN(x * 2, src->width - 1), SB_MIN(x * 2 + 1, src->width - 1)};
+			const uint8_t *taps[4] = {
+				&src->pixels[(rows[0] * src->width + columns[0]) * 4],
+				&src->pixels[(rows[0] * src->width + columns[1]) * 4],
+				&src->pixels[(rows[1] * src->width + columns[0]) * 4],
+				&src->pixels[(rows[1] * src->width + columns[1]) * 4],
+			};
+
+			uint8_t *out = &dst.pixels[(y * dst.width + x) * 4];
+			for(uint32_t c = 0; c < 3; c++)
+			{
+				float sum = 0.0f;
+				for(uint32_t t = 0; t < 4; t++) sum += srgb_to_linear_table[taps[t][c]];
+				out[c] = linear_to_srgb(sum * 0.25f);
+			}
+			out[3] = (uint8_t) ((taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+		}
+	}
+
+	return dst;
+}
+
+// blocks hanging off the right or bottom edge repeat the last row and column
+static void fetch_block(const image *img, uint32_t block_x, uint32_t block_y, uint8_t out[16][4])
+{
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		uint32_t x = SB_MIN(block_x * 4 + i % 4, img->width - 1);
+		uint32_t y = SB_MIN(block_y * 4 + i / 4, img->height - 1);
+		memcpy(out[i], &img->pixels[(y * img->width + x) * 4], 4);
+	}
+}
+
+// endpoints are the block's extremes along its principal axis, found by power iteration on the covariance
+static void fit_endpoints(const uint8_t block[16][4], uint32_t channels, float out_lo[4], float out_hi[4])
+{
+	float mean[4] = {0};
+	for(uint32_t i = 0; i < 16; i++)
+		for(uint32_t c = 0; c < channels; c++) mean[c] += block[i][c] / 16.0f;
+
+	float covariance[4][4] = {0};
+	for(uint32_t i = 0; i < 16; i++)
+		for(uint32_t a = 0; a < channels; a++)
+			for(uint32_t b = 0; b < channels; b++)
+				covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+
+	float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+	for(uint32_t iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {0};
+		float largest = 0.0f;
+		for(uint32_t a = 0; a < channels; a++)
+		{
+			for(uint32_t b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+			largest = SB_MAX(largest, fabsf(next[a]));
+		}
+
+		if(largest == 0.0f) break;
+		for(uint32_t c = 0; c < channels; c++) axis[c] = next[c] / largest;
+	}
+
+	float axis_length_squared = 0.0f;
+	for(uint32_t c = 0; c < channels; c++) axis_length_squared += axis[c] * axis[c];
+
+	float min_t = 0.0f, max_t = 0.0f;
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for(uint32_t c = 0; c < channels; c++) t += (block[i][c] - mean[c]) * axis[c];
+		t /= axis_length_squared;
+		min_t = SB_MIN(min_t, t);
+		max_t = SB_MAX(max_t, t);
+	}
+
+	for(uint32_t c = 0; c < channels; c++)
+	{
+		out_lo[c] = sb_clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+		out_hi[c] = sb_clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+	}
+}
+
+static uint32_t nearest_entry(const uint8_t pixel[4], const float (*palette)[4], uint32_t entry_count, uint32_t channels)
+{
+	uint32_t best = 0;
+	float best_distance = INFINITY;
+	for(uint32_t e = 0; e < entry_count; e++)
+	{
+		float distance = 0.0f;
+		for(uint32_t c = 0; c < channels; c++)
+			distance += (pixel[c] - palette[e][c]) * (pixel[c] - palette[e][c]);
+
+		if(distance < best_distance)
+		{
+			best_distance = distance;
+			best = e;
+		}
+	}
+	return best;
+}
+
+static uint16_t pack_565(const float color[4])
+{
+	uint16_t r = (uint16_t) (color[0] * 31.0f / 255.0f + 0.5f);
+	uint16_t g = (uint16_t) (color[1] * 63.0f / 255.0f + 0.5f);
+	uint16_t b = (uint16_t) (color[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t) (r << 11 | g << 5 | b);
+}
+
+static void unpack_565(uint16_t packed, float out[4])
+{
+	uint32_t r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+	out[0] = (float) (r << 3 | r >> 2);
+	out[1] = (float) (g << 2 | g >> 4);
+	out[2] = (float) (b << 3 | b >> 2);
+	out[3] = 255.0f;
+}
+
+// always the four color mode, which is also the only one bc3 color blocks have
+static void encode_bc1(const uint8_t block[16][4], uint8_t out[8])
+{
+	float lo[4], hi[4];
+	fit_endpoints(block, 3, lo, hi);
+
+	uint16_t color0 = pack_565(hi);
+	uint16_t color1 = pack_565(lo);
+	if(color0 < color1)
+	{
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	uint32_t indices = 0;
+	if(color0 != color1)
+	{
+		float palette[4][4];
+		unpack_565(color0, palette[0]);
+		unpack_565(color1, palette[1]);
+		for(uint32_t c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+
+		for(uint32_t i = 0; i < 16; i++)
+			indices |= nearest_entry(block[i], palette, 4, 3) << (i * 2);
+	}
+
+	memcpy(&out[0], &color0, 2);
+	memcpy(&out[2], &color1, 2);
+	memcpy(&out[4], &indices, 4);
+}
+
+static void encode_bc3_alpha(const uint8_t block[16][4], uint8_t out[8])
+{
+	uint8_t alpha0 = 0, alpha1 = 255;
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		alpha0 = SB_MAX(alpha0, block[i][3]);
+		alpha1 = SB_MIN(alpha1, block[i][3]);
+	}
+
+	uint64_t indices = 0;
+	if(alpha0 > alpha1)
+	{
+		float palette[8] = {alpha0, alpha1};
+		for(uint32_t e = 2; e < 8; e++)
+			palette[e] = ((8 - e) * alpha0 + (e - 1) * alpha1) / 7.0f;
+
+		for(uint32_t i = 0; i < 16; i++)
+		{
+			uint64_t best = 0;
+			for(uint32_t e = 1; e < 8; e++)
+				if(fabsf(block[i][3] - palette[e]) < fabsf(block[i][3] - palette[best])) best = e;
+			indices |= best << (i * 3);
+		}
+	}
+
+	out[0] = alpha0;
+	out[1] = alpha1;
+	for(uint32_t b = 0; b < 6; b++) out[2 + b] = (uint8_t) (indices >> (b * 8));
+}
+
+static void encode_bc3(const uint8_t block[16][4], uint8_t out[16])
+{
+	encode_bc3_alpha(block, out);
+	encode_bc1(block, out + 8);
+}
+
+static void put_bits(uint8_t out[16], uint32_t *cursor, uint32_t value, uint32_t count)
+{
+	for(uint32_t i = 0; i < count; i++, (*cursor)++)
+		if(value >> i & 1) out[*cursor >> 3] |= (uint8_t) (1 << (*cursor & 7));
+}
+
+// 7 bits per channel plus a shared p bit as the low bit, whichever p bit lands closer wins
+static void quantize_bc7_endpoint(const float endpoint[4], uint8_t out_quantized[4], uint8_t *out_p)
+{
+	float best_error = INFINITY;
+	for(uint8_t p = 0; p < 2; p++)
+	{
+		uint8_t quantized[4];
+		float error = 0.0f;
+		for(uint32_t c = 0; c < 4; c++)
+		{
+			quantized[c] = (uint8_t) sb_clamp(roundf((endpoint[c] - p) / 2.0f), 0.0f, 127.0f);
+			float value = (float) (quantized[c] << 1 | p);
+			error += (value - endpoint[c]) * (value - endpoint[c]);
+		}
+
+		if(error < best_error)
+		{
+			best_error = error;
+			memcpy(out_quantized, quantized, 4);
+			*out_p = p;
+		}
+	}
+}
+
+// mode 6 only, a single rgba subset with 4 bit indices which suits smooth material textures
+static void encode_bc7(const uint8_t block[16][4], uint8_t out[16])
+{
+	static const uint32_t weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	float lo[4], hi[4];
+	fit_endpoints(block, 4, lo, hi);
+
+	uint8_t quantized[2][4], p[2];
+	quantize_bc7_endpoint(lo, quantized[0], &p[0]);
+	quantize_bc7_endpoint(hi, quantized[1], &p[1]);
+
+	float palette[16][4];
+	for(uint32_t e = 0; e < 16; e++)
+		for(uint32_t c = 0; c < 4; c++)
+		{
+			uint32_t endpoint0 = quantized[0][c] << 1 | p[0];
+			uint32_t endpoint1 = quantized[1][c] << 1 | p[1];
+			palette[e][c] = (float) (((64 - weights[e]) * endpoint0 + weights[e] * endpoint1 + 32) >> 6);
+		}
+
+	uint8_t indices[16];
+	for(uint32_t i = 0; i < 16; i++)
+		indices[i] = (uint8_t) nearest_entry(block[i], palette, 16, 4);
+
+	// the anchor index is stored with 3 bits, so its top bit has to be clear
+	if(indices[0] & 8)
+	{
+		for(uint32_t c = 0; c < 4; c++)
+		{
+			uint8_t swap = quantized[0][c];
+			quantized[0][c] = quantized[1][c];
+			quantized[1][c] = swap;
+		}
+
+		uint8_t swap = p[0];
+		p[0] = p[1];
+		p[1] = swap;
+
+		for(uint32_t i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+	}
+
+	memset(out, 0, 16);
+	uint32_t cursor = 0;
+	put_bits(out, &cursor, 1 << 6, 7);
+	for(uint32_t c = 0; c < 4; c++)
+	{
+		put_bits(out, &cursor, quantized[0][c], 7);
+		put_bits(out, &cursor, quantized[1][c], 7);
+	}
+	put_bits(out, &cursor, p[0], 1);
+	put_bits(out, &cursor, p[1], 1);
+	put_bits(out, &cursor, indices[0], 3);
+	for(uint32_t i = 1; i < 16; i++) put_bits(out, &cursor, indices[i], 4);
+	assert(cursor == 128);
+}
+
+static uint64_t encode_level(const image *img, sb_texture_file_format format, uint8_t *out)
+{
+	uint32_t blocks_x = (img->width + 3) / 4;
+	uint32_t blocks_y = (img->height + 3) / 4;
+	uint32_t block_size = sb_texture_file_block_size(format);
+
+	for(uint32_t by = 0; by < blocks_y; by++)
+		for(uint32_t bx = 0; bx < blocks_x; bx++)
+		{
+			uint8_t block[16][4];
+			fetch_block(img, bx, by, block);
+
+			uint8_t *dst = out + (by * blocks_x + bx) * block_size;
+			switch(format)
+			{
+				case SB_TEXTURE_FILE_FORMAT_BC1: encode_bc1(block, dst); break;
+				case SB_TEXTURE_FILE_FORMAT_BC3: encode_bc3(block, dst); break;
+				case SB_TEXTURE_FILE_FORMAT_BC7: encode_bc7(block, dst); break;
+				case SB_TEXTURE_FILE_FORMAT_RGBA8: assert(!"sbtex only writes block compressed formats"); break;
+			}
+		}
+
+	return (uint64_t) blocks_x * blocks_y * block_size;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "usage: sbtex <input image> <output.sbt> [--bc1|--bc3|--bc7]\n");
+		return 1;
+	}
+
+	for(uint32_t i = 0; i < 256; i++)
+	{
+		float value = i / 255.0f;
+		srgb_to_linear_table[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	sb_arena *arena = sb_arena_alloc();
+
+	uint64_t encoded_size = 0;
+	const void *encoded = sb_read_file_binary(arena, argv[1], &encoded_size);
+	sb_image_info image_info = {0};
+	if(!sb_get_image_info(encoded, encoded_size, &image_info)) SB_PANIC("couldn't decode the input image");
+
+	int width = (int) image_info.width;
+	int height = (int) image_info.height;
+	size_t pixels_size = (size_t) width * height * 4;
+	uint8_t *pixels = sb_arena_push(arena, uint8_t, pixels_size);
+	if(!sb_decode_image(encoded, encoded_size, pixels, pixels_size)) SB_PANIC("couldn't decode the input image");
+
+	sb_texture_file_format format = SB_TEXTURE_FILE_FORMAT_BC1;
+	for(int i = 0; i < width * height; i++)
+		if(pixels[i * 4 + 3] != 255)
+		{
+			format = SB_TEXTURE_FILE_FORMAT_BC3;
+			break;
+		}
+
+	if(argc > 3 && strcmp(argv[3], "--bc1") == 0) format = SB_TEXTURE_FILE_FORMAT_BC1;
+	if(argc > 3 && strcmp(argv[3], "--bc3") == 0) format = SB_TEXTURE_FILE_FORMAT_BC3;
+	if(argc > 3 && strcmp(argv[3], "--bc7") == 0) format = SB_TEXTURE_FILE_FORMAT_BC7;
+
+	sb_texture_file_header header = {0};
+	header.magic = SB_TEXTURE_FILE_MAGIC;
+	header.version = SB_TEXTURE_FILE_VERSION;
+	header.format = format;
+	header.width = (uint32_t) width;
+	header.height = (uint32_t) height;
+
+	uint32_t largest = SB_MAX(header.width, header.height);
+	header.mip_count = 1;
+	while(largest > 1 && header.mip_count < SB_TEXTURE_FILE_MAX_LEVELS)
+	{
+		largest >>= 1;
+		header.mip_count++;
+	}
+
+	uint32_t block_size = sb_texture_file_block_size(format);
+	uint64_t uncompressed_size = 0;
+	uint64_t data_capacity = 0;
+	for(uint32_t level = 0; level < header.mip_count; level++)
+	{
+		uint64_t level_width = SB_MAX(header.width >> level, 1);
+		uint64_t level_height = SB_MAX(header.height >> level, 1);
+		uncompressed_size += level_width * level_height * 4;
+		data_capacity += sb_round_up(((level_width + 3) / 4) * ((level_height + 3) / 4) * block_size, SB_TEXTURE_FILE_ALIGNMENT);
+	}
+
+	uint64_t data_offset = sb_round_up(sizeof(header) + header.mip_count * sizeof(sb_texture_file_level), SB_TEXTURE_FILE_ALIGNMENT);
+	uint8_t *data = sb_arena_push_aligned(arena, data_capacity, SB_TEXTURE_FILE_ALIGNMENT);
+	sb_texture_file_level levels[SB_TEXTURE_FILE_MAX_LEVELS] = {0};
+
+	image level_image = {header.width, header.height, pixels};
+	uint64_t data_size = 0;
+	for(uint32_t level = 0; level < header.mip_count; level++)
+	{
+		if(level > 0) level_image = downsample(arena, &level_image);
+
+		data_size = sb_round_up(data_size, SB_TEXTURE_FILE_ALIGNMENT);
+		levels[level].offset = data_offset + data_size;
+		levels[level].size = encode_level(&level_image, format, data + data_size);
+		data_size += levels[level].size;
+	}
+
+	FILE *out = sb_fopen(argv[2], "wb");
+	static const uint8_t zeros[SB_TEXTURE_FILE_ALIGNMENT] = {0};
+	uint64_t table_end = sizeof(header) + header.mip_count * sizeof(sb_texture_file_level);
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(levels, sizeof(sb_texture_file_level), header.mip_count, out);
+	fwrite(zeros, 1, data_offset - table_end, out);
+	fwrite(data, 1, data_size, out);
+	fclose(out);
+
+	static const char *format_names[] = {"", "bc1", "bc3", "bc7"};
+	printf("%s: %dx%d, %u levels, %s, %llu bytes (%.1fx smaller than the rgba8 chain)\n",
+		argv[2], width, height, header.mip_count, format_names[format],
+		(unsigned long long) (data_offset + data_size), (double) uncompressed_size / (double) (data_offset + data_size));
+
+	return 0;
+}